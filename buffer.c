@@ -75,9 +75,9 @@ ox_buffer_adjustto_head(struct buffer_s* self)
 void 
 ox_buffer_init(struct buffer_s* self)
 {
+    /*  不清零数据: 缓冲区会在请求间复用, 每次清零整个缓冲区的开销与其容量成正比    */
     self->read_pos = 0;
     self->write_pos = 0;
-    memset(self->data, 0, self->data_len);
 }
 
 int 
@@ -4,6 +4,8 @@
 #include <map>
 
 #include "ssdb_client.h"
+#include "ssdb_command.h"
+#include "ssdb_coroutine.h"
 
 using namespace std;
 
@@ -211,6 +213,377 @@ void test_exists(SSDBClient &client)
 	std::cout << "exist = " << exist << ", code = " << s.code() << std::endl;
 }
 
+void test_hash_family(SSDBClient &client)
+{
+	string name("test_hash_family");
+	client.hclear(name);
+	std::map<std::string, std::string> kvs;
+	kvs.insert(std::make_pair("f1", "v1"));
+	kvs.insert(std::make_pair("f2", "v2"));
+	kvs.insert(std::make_pair("f3", "v3"));
+	Status s = client.multi_hset(name, kvs);
+	if (!s.ok())
+	{
+		std::cout << "multi hset request fail" << std::endl;
+		return;
+	}
+
+	std::map<std::string, std::string> visited;
+	s = client.hgetall(name, [&visited](const char* key, int keyLen, const char* value, int valueLen) {
+		visited[std::string(key, keyLen)] = std::string(value, valueLen);
+	});
+	if (!s.ok() || visited != kvs)
+	{
+		std::cout << "hgetall visitor fail" << std::endl;
+		return;
+	}
+	std::vector<std::string> scanned;
+	s = client.hscan(name, "f1", "", 10, [&scanned](const char* key, int keyLen, const char*, int) {
+		scanned.push_back(std::string(key, keyLen));
+	});
+	if (!s.ok() || scanned.size() != 2 || scanned[0] != "f2" || scanned[1] != "f3")
+	{
+		std::cout << "hscan visitor fail" << std::endl;
+		return;
+	}
+
+	int64_t value = 0;
+	s = client.hincr(name, "counter", 5, &value);
+	if (!s.ok() || value != 5)
+	{
+		std::cout << "hincr fail, value=" << value << std::endl;
+		return;
+	}
+	s = client.hincr(name, "counter", -2, &value);
+	if (!s.ok() || value != 3)
+	{
+		std::cout << "hincr by negative fail, value=" << value << std::endl;
+		return;
+	}
+
+	s = client.hdel(name, "f1");
+	string expectValue;
+	if (!s.ok() || !client.hget(name, "f1", &expectValue).not_found())
+	{
+		std::cout << "hdel fail" << std::endl;
+		return;
+	}
+	int64_t size = 0;
+	s = client.hsize(name, &size);
+	if (!s.ok() || size != 3)
+	{
+		std::cout << "hsize fail, size=" << size << std::endl;
+		return;
+	}
+	s = client.hclear(name);
+	if (!s.ok() || !client.hsize(name, &size).ok() || size != 0)
+	{
+		std::cout << "hclear fail, size=" << size << std::endl;
+	}
+}
+
+void test_queue(SSDBClient &client)
+{
+	string name("test_queue");
+	client.qclear(name);
+	std::vector<std::string> items;
+	for (int i = 0; i < 10; i++)
+	{
+		items.push_back("item" + std::to_string(i));
+	}
+	int64_t size = 0;
+	Status s = client.qpush(name, items, &size);
+	if (!s.ok() || size != 10)
+	{
+		std::cout << "batch qpush fail, size=" << size << std::endl;
+		return;
+	}
+	s = client.qsize(name, &size);
+	if (!s.ok() || size != 10)
+	{
+		std::cout << "qsize fail, size=" << size << std::endl;
+		return;
+	}
+	std::vector<std::string> popped;
+	s = client.qpop(name, 4, &popped);
+	if (!s.ok() || popped.size() != 4 || popped[0] != "item0" || popped[3] != "item3")
+	{
+		std::cout << "batch qpop fail" << std::endl;
+		return;
+	}
+	s = client.qpop(name, 100, &popped);
+	if (!s.ok() || popped.size() != 10 || popped[9] != "item9")
+	{
+		std::cout << "batch qpop rest fail" << std::endl;
+		return;
+	}
+	s = client.qpop(name, 1, &popped);
+	if (!s.ok() || popped.size() != 10)
+	{
+		std::cout << "qpop on empty queue fail" << std::endl;
+		return;
+	}
+	s = client.qsize(name, &size);
+	if (!s.ok() || size != 0)
+	{
+		std::cout << "qsize after qpop fail, size=" << size << std::endl;
+	}
+}
+
+void test_zset_range(SSDBClient &client)
+{
+	string name("test_zset_range");
+	client.zclear(name);
+	std::map<std::string, int64_t> kss;
+	kss.insert(std::make_pair("a", 1));
+	kss.insert(std::make_pair("b", 2));
+	kss.insert(std::make_pair("c", 3));
+	kss.insert(std::make_pair("d", 4));
+	Status s = client.multi_zset(name, kss);
+	if (!s.ok())
+	{
+		std::cout << "multi zset fail" << std::endl;
+		return;
+	}
+
+	SSDBZsetResult result;
+	s = client.zscan(name, "", 0, 100, 10, &result);
+	if (!s.ok() || result.size() != 4 || result.memberStr(0) != "a" || result.scores[3] != 4)
+	{
+		std::cout << "typed zscan fail" << std::endl;
+		return;
+	}
+	s = client.zrscan(name, "", 100, 0, 2, &result);
+	if (!s.ok() || result.size() != 2 || result.memberStr(0) != "d" || result.scores[1] != 3)
+	{
+		std::cout << "typed zrscan fail" << std::endl;
+		return;
+	}
+	s = client.zrange(name, 1, 2, &result);
+	if (!s.ok() || result.size() != 2 || result.memberStr(0) != "b" || result.memberStr(1) != "c" || result.scores[1] != 3)
+	{
+		std::cout << "typed zrange fail" << std::endl;
+		return;
+	}
+	s = client.zrrange(name, 0, 1, &result);
+	if (!s.ok() || result.size() != 1 || result.memberStr(0) != "d" || result.scores[0] != 4)
+	{
+		std::cout << "typed zrrange fail" << std::endl;
+		return;
+	}
+
+	std::vector<std::string> keys;
+	keys.push_back("c");
+	keys.push_back("key_not_exist");
+	keys.push_back("a");
+	s = client.multi_zget(name, keys, &result);
+	if (!s.ok() || result.size() != 2 || result.memberStr(0) != "c" || result.scores[0] != 3 || result.memberStr(1) != "a" || result.scores[1] != 1)
+	{
+		std::cout << "typed multi_zget fail" << std::endl;
+		return;
+	}
+	int64_t rank = -1;
+	s = client.zrank(name, "c", &rank);
+	if (!s.ok() || rank != 2)
+	{
+		std::cout << "zrank fail, rank=" << rank << std::endl;
+	}
+	client.zclear(name);
+}
+
+void test_command(SSDBClient &client)
+{
+	string key("test_command");
+	SSDBCommandReply reply = client.command("set", key, "hello command");
+	if (!reply.ok())
+	{
+		std::cout << "command set fail" << std::endl;
+		return;
+	}
+	string value;
+	Status s = client.command("get", key).get(&value);
+	if (!s.ok() || value != "hello command")
+	{
+		std::cout << "command get fail" << std::endl;
+		return;
+	}
+	reply = client.command("get", key);
+	if (reply.size() != 1 || string(reply.item(0).buffer, reply.item(0).len) != "hello command")
+	{
+		std::cout << "command item fail" << std::endl;
+		return;
+	}
+
+	static const SSDBCommandName<5> INCR("incr");
+	string counter("test_command_counter");
+	client.del(counter);
+	int64_t number = 0;
+	s = client.command(INCR, counter, 7).get(&number);
+	if (!s.ok() || number != 7)
+	{
+		std::cout << "command incr fail, value=" << number << std::endl;
+		return;
+	}
+
+	std::vector<std::string> keys;
+	keys.push_back(key);
+	keys.push_back(counter);
+	std::map<std::string, std::string> values;
+	s = client.command("multi_get", keys).get(&values);
+	if (!s.ok() || values.size() != 2 || values[key] != "hello command" || values[counter] != "7")
+	{
+		std::cout << "command multi_get fail" << std::endl;
+		return;
+	}
+	client.command("multi_del", keys);
+	if (!client.command("get", key).status().not_found())
+	{
+		std::cout << "command multi_del fail" << std::endl;
+	}
+}
+
+void test_compression(SSDBClient &client)
+{
+	SSDBCompressionOptions options;
+	options.threshold = 64;
+	client.setCompression(options);
+
+	string key("test_compression");
+	string value;
+	for (int i = 0; i < 512; i++)
+	{
+		value += "compressible ";
+	}
+	Status s = client.set(key, value);
+	string expectValue;
+	if (!s.ok() || !client.get(key, &expectValue).ok() || expectValue != value)
+	{
+		std::cout << "compressed get value not the same" << std::endl;
+		return;
+	}
+
+	/*	value itself starts with a valid header and must come back unchanged	*/
+	string header("\0SC\0\3\0\0\0abc", 11);
+	std::map<std::string, std::string> kvs;
+	kvs.insert(std::make_pair("test_compression_1", value));
+	kvs.insert(std::make_pair("test_compression_2", "short"));
+	kvs.insert(std::make_pair("test_compression_3", header));
+	s = client.multi_set(kvs);
+	std::vector<std::string> keys;
+	for (std::map<std::string, std::string>::iterator iter = kvs.begin(); iter != kvs.end(); ++iter)
+	{
+		keys.push_back(iter->first);
+	}
+	std::map<std::string, std::string> values;
+	if (!s.ok() || !client.multi_get(keys, &values).ok() || values != kvs)
+	{
+		std::cout << "compressed multi_get value not the same" << std::endl;
+		return;
+	}
+
+	string streamed;
+	int64_t size = 0;
+	s = client.get_stream(key, [&streamed](const char* data, int len) {
+		streamed.append(data, len);
+		return true;
+	}, &size);
+	if (!s.ok() || streamed != value || size != (int64_t)value.size())
+	{
+		std::cout << "compressed get_stream value not the same" << std::endl;
+		return;
+	}
+	s = client.command("get", "test_compression_3").get(&expectValue);
+	if (!s.ok() || expectValue != header)
+	{
+		std::cout << "command get of escaped value not the same" << std::endl;
+		return;
+	}
+	keys.push_back(key);
+	client.multi_del(keys);
+
+	options.enabled = false;
+	client.setCompression(options);
+}
+
+void test_compressed_hash(SSDBClient &client)
+{
+	SSDBCompressionOptions options;
+	options.threshold = 64;
+	client.setCompression(options);
+
+	string name("test_compressed_hash");
+	string value(4096, 'c');
+	client.hclear(name);
+	Status s = client.hset(name, "big", value);
+	if (!s.ok())
+	{
+		std::cout << "compressed hset fail" << std::endl;
+		return;
+	}
+	client.hset(name, "small", "tiny");
+
+	std::map<std::string, std::string> values;
+	s = client.hgetall(name, &values);
+	if (!s.ok() || values.size() != 2 || values["big"] != value || values["small"] != "tiny")
+	{
+		std::cout << "compressed hgetall value not the same" << std::endl;
+		return;
+	}
+
+	string visited;
+	s = client.hscan(name, "", "", 10, [&visited](const char* key, int keyLen, const char* data, int len) {
+		visited.append(key, keyLen).append(data, len);
+	});
+	if (!s.ok() || visited != "big" + value + "smalltiny")
+	{
+		std::cout << "compressed hscan value not the same" << std::endl;
+		return;
+	}
+
+	string streamed;
+	s = client.hget_stream(name, "big", [&streamed](const char* data, int len) {
+		streamed.append(data, len);
+		return true;
+	});
+	if (!s.ok() || streamed != value)
+	{
+		std::cout << "compressed hget_stream value not the same" << std::endl;
+		return;
+	}
+	client.hclear(name);
+
+	options.enabled = false;
+	client.setCompression(options);
+}
+
+#if defined(__cpp_impl_coroutine)
+SSDBTask test_coroutine(SSDBCoroClient &client)
+{
+	string key("test_coroutine");
+	Status s = co_await client.set(key, "hello coroutine");
+	if (!s.ok())
+	{
+		std::cout << "coroutine set fail" << std::endl;
+		co_return;
+	}
+	SSDBReply<std::string> r = co_await client.get(key);
+	if (!r.status.ok() || r.value != "hello coroutine")
+	{
+		std::cout << "coroutine get fail" << std::endl;
+		co_return;
+	}
+	std::vector<std::string> keys;
+	keys.push_back(key);
+	SSDBReply<std::map<std::string, std::string> > values = co_await client.multi_get(keys);
+	if (!values.status.ok() || values.value[key] != r.value)
+	{
+		std::cout << "coroutine multi_get fail" << std::endl;
+		co_return;
+	}
+	co_await client.del(key);
+}
+#endif
+
 int main()
 {	
 	SSDBClient client;
@@ -228,5 +601,24 @@ int main()
 	test_setnx(client);
 	test_exists(client);
 
+	test_hash_family(client);
+	test_queue(client);
+	test_zset_range(client);
+	test_command(client);
+	test_compression(client);
+	test_compressed_hash(client);
+
+#if defined(__cpp_impl_coroutine)
+	SSDBAsyncConnection connection;
+	if (connection.connect("203.116.50.232", 8888))
+	{
+		SSDBEventLoop loop;
+		loop.add(&connection);
+		SSDBCoroClient coroClient(&connection);
+		test_coroutine(coroClient);
+		loop.run();
+	}
+#endif
+
     return 0;
 }
\ No newline at end of file
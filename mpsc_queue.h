@@ -0,0 +1,87 @@
+#ifndef _MPSC_QUEUE_H_INCLUDED_
+#define _MPSC_QUEUE_H_INCLUDED_
+
+#include <atomic>
+#include <stddef.h>
+
+/*  无锁多生产者单消费者侵入式队列(Dmitry Vyukov算法)
+    T需要继承MpscNode. push可以在任意线程调用, pop只能在唯一的消费者线程调用.
+    节点内存由调用方管理, 队列本身不分配内存.   */
+
+struct MpscNode
+{
+    std::atomic<MpscNode*>  mpscNext;
+};
+
+template<typename T>
+class MpscQueue
+{
+public:
+    MpscQueue()
+    {
+        m_stub.mpscNext.store(NULL, std::memory_order_relaxed);
+        m_head.store(&m_stub, std::memory_order_relaxed);
+        m_tail = &m_stub;
+    }
+
+    void push(T* node)
+    {
+        pushNode(node);
+    }
+
+    /*  队列为空或生产者正在push中途时返回NULL  */
+    T* pop()
+    {
+        MpscNode* tail = m_tail;
+        MpscNode* next = tail->mpscNext.load(std::memory_order_acquire);
+        if (tail == &m_stub)
+        {
+            if (next == NULL)
+            {
+                return NULL;
+            }
+            m_tail = next;
+            tail = next;
+            next = next->mpscNext.load(std::memory_order_acquire);
+        }
+
+        if (next != NULL)
+        {
+            m_tail = next;
+            return static_cast<T*>(tail);
+        }
+
+        MpscNode* head = m_head.load(std::memory_order_acquire);
+        if (tail != head)
+        {
+            return NULL;
+        }
+
+        pushNode(&m_stub);
+        next = tail->mpscNext.load(std::memory_order_acquire);
+        if (next != NULL)
+        {
+            m_tail = next;
+            return static_cast<T*>(tail);
+        }
+        return NULL;
+    }
+
+private:
+    MpscQueue(const MpscQueue&);
+    void operator=(const MpscQueue&);
+
+    void pushNode(MpscNode* node)
+    {
+        node->mpscNext.store(NULL, std::memory_order_relaxed);
+        MpscNode* prev = m_head.exchange(node, std::memory_order_acq_rel);
+        prev->mpscNext.store(node, std::memory_order_release);
+    }
+
+private:
+    std::atomic<MpscNode*>  m_head;
+    MpscNode*               m_tail;
+    MpscNode                m_stub;
+};
+
+#endif
@@ -0,0 +1,808 @@
+#include "socketlibfunction.h"
+
+#ifdef PLATFORM_WINDOWS
+#include <MSTcpIP.h>
+#pragma comment(lib,"ws2_32.lib")
+#else
+#include <netinet/tcp.h>
+#include <string.h>
+#include <sys/uio.h>
+#endif
+
+#if defined __linux__
+#include <linux/errqueue.h>
+#endif
+
+#include <string>
+#include <vector>
+#include <map>
+#include <mutex>
+#include <chrono>
+
+#if defined MSG_CMSG_CLOEXEC
+#define OX_RECV_FD_FLAGS MSG_CMSG_CLOEXEC
+#else
+#define OX_RECV_FD_FLAGS 0
+#endif
+
+void
+ox_socket_init(void)
+{
+#if defined PLATFORM_WINDOWS
+    static WSADATA g_WSAData;
+    WSAStartup(MAKEWORD(2,2), &g_WSAData);
+#endif
+}
+
+bool ox_socket_keepalive(sock socket, unsigned int timeout, unsigned int interval, unsigned int probes)
+{
+#ifdef PLATFORM_WINDOWS
+	tcp_keepalive tcpKeepAlive;
+	tcpKeepAlive.onoff = 1;
+	tcpKeepAlive.keepalivetime = timeout * 1000;
+	tcpKeepAlive.keepaliveinterval = interval * 1000;
+	DWORD dwBytesRet = 0; 
+	int result = WSAIoctl(
+		socket,
+		SIO_KEEPALIVE_VALS,
+		&tcpKeepAlive,
+		sizeof(tcpKeepAlive),
+		NULL,
+		0,
+		&dwBytesRet,
+		NULL,
+		NULL
+		);
+	if(result != 0)
+	{
+		return false;
+	}
+#else
+	int hSocket = (int)socket;
+	int enable = 1;
+	if(setsockopt(hSocket, SOL_SOCKET, SO_KEEPALIVE, (void *)&enable, sizeof(enable)) != 0)
+	{
+		return false;
+	}
+	setsockopt(hSocket, SOL_TCP, TCP_KEEPIDLE, (void *)&timeout, sizeof(timeout));
+	setsockopt(hSocket, SOL_TCP, TCP_KEEPINTVL, (void *)&interval, sizeof(interval));
+	setsockopt(hSocket, SOL_TCP, TCP_KEEPCNT, (void *)&probes, sizeof(probes));
+#endif
+	return true;
+}
+
+bool ox_socket_set_block(sock socket, bool block)
+{
+#ifdef _WIN32
+	u_long nonblock = block ? 0 : 1;
+	return ioctlsocket(socket, FIONBIO, &nonblock) == 0;
+#else
+	int flag = fcntl(socket, F_GETFL, 0);
+	if(block)
+	{
+		flag &= (~O_NONBLOCK);
+		flag &= (~O_NDELAY);
+	}
+	else
+	{
+		flag |= O_NONBLOCK;
+		flag |= O_NDELAY;
+	}
+	return fcntl(socket, F_SETFL, flag) != -1;
+#endif
+}
+
+bool ox_socket_set_timeout(sock socket, unsigned int timeoutSec)
+{
+#ifdef _WIN32
+	int timeout = timeoutSec * 1000;
+#else
+	timeval timeout = { timeoutSec, 0 };
+#endif
+	if(setsockopt(socket, SOL_SOCKET, SO_SNDTIMEO, (const char *)&timeout, sizeof(timeout)) == SOCKET_ERROR)
+	{
+		return false;
+	}
+	if(setsockopt(socket, SOL_SOCKET, SO_RCVTIMEO, (const char *)&timeout, sizeof(timeout)) == SOCKET_ERROR)
+	{
+		return false;
+	}
+	return true;
+}
+
+int ox_get_last_error()
+{
+#ifdef _WIN32
+	return WSAGetLastError();
+#else
+	return errno;
+#endif
+}
+
+void
+ox_socket_close(sock fd)
+{
+#if defined PLATFORM_WINDOWS
+    closesocket(fd);
+#else
+    close(fd);
+#endif
+}
+
+/*  happy eyeballs(RFC 8305): 一个地址在此时间内没有连上就并行尝试下一个地址 */
+static const int64_t CONNECT_ATTEMPT_DELAY_MS = 250;
+/*  DNS解析结果的缓存时间   */
+static const int64_t DNS_CACHE_TTL_MS = 30 * 1000;
+/*  ox_socket_setup_async设置的keepalive  */
+static const unsigned int KEEP_ALIVE_TIMEOUT = 30;
+static const unsigned int KEEP_ALIVE_INTERVAL = 3;
+static const unsigned int KEEP_ALIVE_PROBES = 10;
+
+struct ox_resolved_addr
+{
+    struct sockaddr_storage addr;
+    socklen_t               len;
+};
+
+struct ox_dns_entry
+{
+    std::vector<ox_resolved_addr>   addrs;
+    int64_t                         expire;
+};
+
+static std::mutex g_dnsLock;
+static std::map<std::string, ox_dns_entry> g_dnsCache;
+
+int64_t ox_now_ms()
+{
+    return std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+/*  解析host的所有TCP地址, 按地址族交替排列(第一个地址族优先), 结果缓存DNS_CACHE_TTL_MS  */
+static bool ox_socket_resolve(const char* host, int port, std::vector<ox_resolved_addr>& addrs)
+{
+    addrs.clear();
+    {
+        std::lock_guard<std::mutex> guard(g_dnsLock);
+        std::map<std::string, ox_dns_entry>::iterator it = g_dnsCache.find(host);
+        if (it != g_dnsCache.end() && it->second.expire > ox_now_ms())
+        {
+            addrs = it->second.addrs;
+        }
+    }
+
+    if (addrs.empty())
+    {
+        struct addrinfo hints;
+        memset(&hints, 0, sizeof(hints));
+        hints.ai_family = AF_UNSPEC;
+        hints.ai_socktype = SOCK_STREAM;
+        hints.ai_protocol = IPPROTO_TCP;
+        hints.ai_flags = AI_ADDRCONFIG;
+
+        struct addrinfo* result = NULL;
+        if (getaddrinfo(host, NULL, &hints, &result) != 0 || result == NULL)
+        {
+            return false;
+        }
+
+        /*  getaddrinfo已按RFC 6724排序, 这里只做两个地址族的交替   */
+        std::vector<ox_resolved_addr> primary;
+        std::vector<ox_resolved_addr> secondary;
+        for (struct addrinfo* ai = result; ai != NULL; ai = ai->ai_next)
+        {
+            if ((ai->ai_family != AF_INET && ai->ai_family != AF_INET6) || ai->ai_addrlen > sizeof(struct sockaddr_storage))
+            {
+                continue;
+            }
+            ox_resolved_addr addr;
+            memset(&addr, 0, sizeof(addr));
+            memcpy(&addr.addr, ai->ai_addr, ai->ai_addrlen);
+            addr.len = (socklen_t)ai->ai_addrlen;
+            if (primary.empty() || primary[0].addr.ss_family == ai->ai_family)
+            {
+                primary.push_back(addr);
+            }
+            else
+            {
+                secondary.push_back(addr);
+            }
+        }
+        freeaddrinfo(result);
+
+        for (size_t i = 0; i < primary.size() || i < secondary.size(); ++i)
+        {
+            if (i < primary.size())
+            {
+                addrs.push_back(primary[i]);
+            }
+            if (i < secondary.size())
+            {
+                addrs.push_back(secondary[i]);
+            }
+        }
+        if (addrs.empty())
+        {
+            return false;
+        }
+
+        std::lock_guard<std::mutex> guard(g_dnsLock);
+        ox_dns_entry& entry = g_dnsCache[host];
+        entry.addrs = addrs;
+        entry.expire = ox_now_ms() + DNS_CACHE_TTL_MS;
+    }
+
+    for (size_t i = 0; i < addrs.size(); ++i)
+    {
+        if (addrs[i].addr.ss_family == AF_INET)
+        {
+            ((struct sockaddr_in*)&addrs[i].addr)->sin_port = htons(port);
+        }
+        else
+        {
+            ((struct sockaddr_in6*)&addrs[i].addr)->sin6_port = htons(port);
+        }
+    }
+    return true;
+}
+
+static void ox_socket_forget(const char* host)
+{
+    std::lock_guard<std::mutex> guard(g_dnsLock);
+    g_dnsCache.erase(host);
+}
+
+struct ox_connect_attempt
+{
+    int     slot;
+    sock    fd;
+};
+
+/*  发起一次非阻塞连接, 返回0表示正在连接, 1表示已连接, -1表示失败  */
+static int ox_socket_start_connect(const ox_resolved_addr& addr, sock* fd)
+{
+    *fd = socket(addr.addr.ss_family, SOCK_STREAM, 0);
+    if (*fd == SOCKET_ERROR)
+    {
+        return -1;
+    }
+    if (!ox_socket_set_block(*fd, false))
+    {
+        ox_socket_close(*fd);
+        *fd = SOCKET_ERROR;
+        return -1;
+    }
+
+    if (connect(*fd, (const struct sockaddr*)&addr.addr, addr.len) == 0)
+    {
+        return 1;
+    }
+
+    int error = ox_get_last_error();
+#ifdef PLATFORM_WINDOWS
+    if (error == WSAEWOULDBLOCK)
+#else
+    if (error == EINPROGRESS)
+#endif
+    {
+        return 0;
+    }
+
+    ox_socket_close(*fd);
+    *fd = SOCKET_ERROR;
+    return -1;
+}
+
+#if !defined PLATFORM_WINDOWS
+static sock ox_socket_connect_unix_ms(const char* path, int64_t connectTimeoutMs, unsigned int timeoutSec);
+#endif
+
+/*  connectTimeoutMs为连接阶段的超时, 连接成功后的socket以timeoutSec设置收发超时   */
+static int
+ox_socket_connect_slots(const char* host, int port, int count, sock* fds, int64_t connectTimeoutMs, unsigned int timeoutSec)
+{
+    ox_socket_init();
+
+    for (int i = 0; i < count; ++i)
+    {
+        fds[i] = SOCKET_ERROR;
+    }
+
+    int connected = 0;
+#if !defined PLATFORM_WINDOWS
+    if (host[0] == '/')
+    {
+        for (int i = 0; i < count; ++i)
+        {
+            fds[i] = ox_socket_connect_unix_ms(host, connectTimeoutMs, timeoutSec);
+            connected += fds[i] != SOCKET_ERROR ? 1 : 0;
+        }
+        return connected;
+    }
+#endif
+
+    std::vector<ox_resolved_addr> addrs;
+    if (count <= 0 || !ox_socket_resolve(host, port, addrs))
+    {
+        return 0;
+    }
+
+    /*  每个连接(slot)依次尝试各个地址, 上一个地址CONNECT_ATTEMPT_DELAY_MS内未完成或失败时开始下一个,
+        所有slot同时进行, 某个slot的任一尝试成功后关闭其余尝试 */
+    std::vector<size_t> nextAddr(count, 0);
+    std::vector<int64_t> lastStart(count, 0);
+    std::vector<int> inflight(count, 0);
+    std::vector<ox_connect_attempt> attempts;
+    std::vector<struct pollfd> pfds;
+    int64_t deadline = ox_now_ms() + connectTimeoutMs;
+
+    while (true)
+    {
+        int64_t now = ox_now_ms();
+        int64_t wait = deadline - now;
+        int pending = 0;
+        for (int slot = 0; slot < count; ++slot)
+        {
+            while (fds[slot] == SOCKET_ERROR && nextAddr[slot] < addrs.size() &&
+                (inflight[slot] == 0 || now - lastStart[slot] >= CONNECT_ATTEMPT_DELAY_MS))
+            {
+                ox_connect_attempt attempt;
+                attempt.slot = slot;
+                int ret = ox_socket_start_connect(addrs[nextAddr[slot]++], &attempt.fd);
+                lastStart[slot] = now;
+                if (ret == 1)
+                {
+                    fds[slot] = attempt.fd;
+                    ++connected;
+                }
+                else if (ret == 0)
+                {
+                    attempts.push_back(attempt);
+                    ++inflight[slot];
+                }
+            }
+
+            if (fds[slot] == SOCKET_ERROR && inflight[slot] > 0)
+            {
+                ++pending;
+                if (nextAddr[slot] < addrs.size() && lastStart[slot] + CONNECT_ATTEMPT_DELAY_MS - now < wait)
+                {
+                    wait = lastStart[slot] + CONNECT_ATTEMPT_DELAY_MS - now;
+                }
+            }
+        }
+
+        /*  关闭已完成slot的其余尝试    */
+        for (size_t i = 0; i < attempts.size();)
+        {
+            if (fds[attempts[i].slot] != SOCKET_ERROR)
+            {
+                ox_socket_close(attempts[i].fd);
+                --inflight[attempts[i].slot];
+                attempts[i] = attempts.back();
+                attempts.pop_back();
+            }
+            else
+            {
+                ++i;
+            }
+        }
+
+        if (pending == 0 || now >= deadline)
+        {
+            break;
+        }
+
+        pfds.resize(attempts.size());
+        for (size_t i = 0; i < attempts.size(); ++i)
+        {
+            pfds[i].fd = attempts[i].fd;
+            pfds[i].events = POLLOUT;
+            pfds[i].revents = 0;
+        }
+#if defined PLATFORM_WINDOWS
+        int ret = WSAPoll(&pfds[0], (ULONG)pfds.size(), (int)(wait > 0 ? wait : 0));
+#else
+        int ret = poll(&pfds[0], pfds.size(), (int)(wait > 0 ? wait : 0));
+#endif
+        if (ret <= 0)
+        {
+            continue;
+        }
+
+        for (size_t i = pfds.size(); i-- > 0;)
+        {
+            if (pfds[i].revents == 0)
+            {
+                continue;
+            }
+
+            ox_connect_attempt attempt = attempts[i];
+            int error = 0;
+#ifdef PLATFORM_WINDOWS
+            int errorLength = sizeof(error);
+#else
+            socklen_t errorLength = sizeof(error);
+#endif
+            if (getsockopt(attempt.fd, SOL_SOCKET, SO_ERROR, (char *)&error, &errorLength) == SOCKET_ERROR)
+            {
+                error = -1;
+            }
+            attempts[i] = attempts.back();
+            attempts.pop_back();
+            --inflight[attempt.slot];
+
+            if (error == 0 && fds[attempt.slot] == SOCKET_ERROR)
+            {
+                fds[attempt.slot] = attempt.fd;
+                ++connected;
+            }
+            else
+            {
+                ox_socket_close(attempt.fd);
+            }
+        }
+    }
+
+    for (size_t i = 0; i < attempts.size(); ++i)
+    {
+        ox_socket_close(attempts[i].fd);
+    }
+
+    /*  与之前一致: 返回阻塞socket并设置收发超时  */
+    for (int i = 0; i < count; ++i)
+    {
+        if (fds[i] != SOCKET_ERROR && (!ox_socket_set_block(fds[i], true) || !ox_socket_set_timeout(fds[i], timeoutSec)))
+        {
+            ox_socket_close(fds[i]);
+            fds[i] = SOCKET_ERROR;
+            --connected;
+        }
+    }
+
+    if (connected == 0)
+    {
+        /*  地址可能已经变化, 下次重新解析  */
+        ox_socket_forget(host);
+    }
+    return connected;
+}
+
+int
+ox_socket_connect_all(const char* host, int port, int count, sock* fds, unsigned int timeoutSec)
+{
+    return ox_socket_connect_slots(host, port, count, fds, (int64_t)timeoutSec * 1000, timeoutSec);
+}
+
+sock
+ox_socket_connect(const char* server_ip, int port, unsigned int timeoutSec)
+{
+    sock fd = SOCKET_ERROR;
+    ox_socket_connect_slots(server_ip, port, 1, &fd, (int64_t)timeoutSec * 1000, timeoutSec);
+    return fd;
+}
+
+int
+ox_socket_connect_nonblock(const char* server_ip, int port, sock* fd)
+{
+    ox_socket_init();
+    *fd = SOCKET_ERROR;
+
+#if !defined PLATFORM_WINDOWS
+    if (server_ip[0] == '/')
+    {
+        /*  unix socket的connect不会等待网络, 服务端accept队列满时直接失败 */
+        struct sockaddr_un server_addr;
+        if (strlen(server_ip) >= sizeof(server_addr.sun_path))
+        {
+            return -1;
+        }
+        memset(&server_addr, 0, sizeof(server_addr));
+        server_addr.sun_family = AF_UNIX;
+        strcpy(server_addr.sun_path, server_ip);
+
+        *fd = socket(AF_UNIX, SOCK_STREAM, 0);
+        if (*fd == SOCKET_ERROR)
+        {
+            return -1;
+        }
+        if (ox_socket_set_block(*fd, false) && connect(*fd, (struct sockaddr*)&server_addr, sizeof(server_addr)) == 0)
+        {
+            return 1;
+        }
+        ox_socket_close(*fd);
+        *fd = SOCKET_ERROR;
+        return -1;
+    }
+#endif
+
+    std::vector<ox_resolved_addr> addrs;
+    if (!ox_socket_resolve(server_ip, port, addrs))
+    {
+        return -1;
+    }
+    int ret = ox_socket_start_connect(addrs[0], fd);
+    if (ret < 0)
+    {
+        ox_socket_forget(server_ip);
+    }
+    return ret;
+}
+
+int
+ox_socket_connect_error(sock fd)
+{
+    int error = 0;
+#ifdef PLATFORM_WINDOWS
+    int errorLength = sizeof(error);
+#else
+    socklen_t errorLength = sizeof(error);
+#endif
+    if (getsockopt(fd, SOL_SOCKET, SO_ERROR, (char *)&error, &errorLength) == SOCKET_ERROR)
+    {
+        return -1;
+    }
+    return error;
+}
+
+sock
+ox_socket_connect_ms(const char* server_ip, int port, int64_t connectTimeoutMs, unsigned int timeoutSec)
+{
+    sock fd = SOCKET_ERROR;
+    ox_socket_connect_slots(server_ip, port, 1, &fd, connectTimeoutMs > 0 ? connectTimeoutMs : 1, timeoutSec);
+    return fd;
+}
+
+int
+ox_socket_nodelay(sock fd)
+{
+    int flag = 1;
+    return setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, (char *)&flag, sizeof(flag));
+}
+
+bool
+ox_socket_setup_async(sock fd)
+{
+    if (!ox_socket_set_block(fd, false))
+    {
+        return false;
+    }
+    ox_socket_nodelay(fd);
+    ox_socket_keepalive(fd, KEEP_ALIVE_TIMEOUT, KEEP_ALIVE_INTERVAL, KEEP_ALIVE_PROBES);
+    return true;
+}
+
+bool
+ox_socket_set_buffer_size(sock fd, int sendSize, int recvSize)
+{
+    bool ok = true;
+    if (sendSize > 0)
+    {
+        ok = setsockopt(fd, SOL_SOCKET, SO_SNDBUF, (char *)&sendSize, sizeof(sendSize)) == 0 && ok;
+    }
+    if (recvSize > 0)
+    {
+        ok = setsockopt(fd, SOL_SOCKET, SO_RCVBUF, (char *)&recvSize, sizeof(recvSize)) == 0 && ok;
+    }
+    return ok;
+}
+
+#if defined __linux__
+
+bool
+ox_socket_busy_poll(sock fd, int us)
+{
+#if defined SO_BUSY_POLL
+    return setsockopt(fd, SOL_SOCKET, SO_BUSY_POLL, &us, sizeof(us)) == 0;
+#else
+    return false;
+#endif
+}
+
+bool
+ox_socket_quickack(sock fd)
+{
+    int flag = 1;
+    return setsockopt(fd, IPPROTO_TCP, TCP_QUICKACK, &flag, sizeof(flag)) == 0;
+}
+
+bool
+ox_socket_incoming_cpu(sock fd, int cpu)
+{
+#if defined SO_INCOMING_CPU
+    return setsockopt(fd, SOL_SOCKET, SO_INCOMING_CPU, &cpu, sizeof(cpu)) == 0;
+#else
+    return false;
+#endif
+}
+
+bool
+ox_socket_enable_zerocopy(sock fd)
+{
+#if defined SO_ZEROCOPY && defined MSG_ZEROCOPY
+    int flag = 1;
+    return setsockopt(fd, SOL_SOCKET, SO_ZEROCOPY, &flag, sizeof(flag)) == 0;
+#else
+    return false;
+#endif
+}
+
+int
+ox_socket_drain_zerocopy(sock fd, bool* copied)
+{
+    int completed = 0;
+#if defined SO_EE_ORIGIN_ZEROCOPY
+    for (;;)
+    {
+        char control[128];
+        struct msghdr msg;
+        memset(&msg, 0, sizeof(msg));
+        msg.msg_control = control;
+        msg.msg_controllen = sizeof(control);
+
+        if (recvmsg(fd, &msg, MSG_ERRQUEUE | MSG_DONTWAIT) < 0)
+        {
+            if (sErrno == S_EINTR)
+            {
+                continue;
+            }
+            break;
+        }
+
+        for (struct cmsghdr* cmsg = CMSG_FIRSTHDR(&msg); cmsg != NULL; cmsg = CMSG_NXTHDR(&msg, cmsg))
+        {
+            struct sock_extended_err err;
+            memcpy(&err, CMSG_DATA(cmsg), sizeof(err));
+            if (err.ee_errno != 0 || err.ee_origin != SO_EE_ORIGIN_ZEROCOPY)
+            {
+                continue;
+            }
+
+            /*  一个通知覆盖[ee_info, ee_data]范围内的发送  */
+            completed += (int)(err.ee_data - err.ee_info + 1);
+            if (copied != NULL && (err.ee_code & SO_EE_CODE_ZEROCOPY_COPIED))
+            {
+                *copied = true;
+            }
+        }
+    }
+#endif
+    return completed;
+}
+
+#endif
+
+#if !defined PLATFORM_WINDOWS
+
+sock
+ox_socket_connect_unix(const char* path, unsigned int timeoutSec)
+{
+    return ox_socket_connect_unix_ms(path, (int64_t)timeoutSec * 1000, timeoutSec);
+}
+
+static sock
+ox_socket_connect_unix_ms(const char* path, int64_t connectTimeoutMs, unsigned int timeoutSec)
+{
+    struct sockaddr_un server_addr;
+    if (strlen(path) >= sizeof(server_addr.sun_path))
+    {
+        return SOCKET_ERROR;
+    }
+
+    sock clientfd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (clientfd == SOCKET_ERROR)
+    {
+        return clientfd;
+    }
+
+    /*  unix socket的阻塞connect以SO_SNDTIMEO为超时(等待服务端accept队列)   */
+    struct timeval connectTimeout = { (time_t)(connectTimeoutMs / 1000), (suseconds_t)(connectTimeoutMs % 1000 * 1000) };
+    if (setsockopt(clientfd, SOL_SOCKET, SO_SNDTIMEO, (const char *)&connectTimeout, sizeof(connectTimeout)) == SOCKET_ERROR)
+    {
+        ox_socket_close(clientfd);
+        return SOCKET_ERROR;
+    }
+
+    memset(&server_addr, 0, sizeof(server_addr));
+    server_addr.sun_family = AF_UNIX;
+    strcpy(server_addr.sun_path, path);
+
+    int ret = SOCKET_ERROR;
+    do
+    {
+        ret = connect(clientfd, (struct sockaddr*)&server_addr, sizeof(server_addr));
+    } while (ret == SOCKET_ERROR && sErrno == S_EINTR);
+
+    if (ret == SOCKET_ERROR || !ox_socket_set_timeout(clientfd, timeoutSec))
+    {
+        ox_socket_close(clientfd);
+        return SOCKET_ERROR;
+    }
+
+    return clientfd;
+}
+
+bool
+ox_socket_send_fd(sock channel, sock fd)
+{
+    char data = 0;
+    struct iovec iov;
+    iov.iov_base = &data;
+    iov.iov_len = sizeof(data);
+
+    union
+    {
+        struct cmsghdr  header;
+        char            space[CMSG_SPACE(sizeof(int))];
+    } control;
+    memset(&control, 0, sizeof(control));
+
+    struct msghdr msg;
+    memset(&msg, 0, sizeof(msg));
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = control.space;
+    msg.msg_controllen = sizeof(control.space);
+
+    struct cmsghdr* cmsg = CMSG_FIRSTHDR(&msg);
+    cmsg->cmsg_level = SOL_SOCKET;
+    cmsg->cmsg_type = SCM_RIGHTS;
+    cmsg->cmsg_len = CMSG_LEN(sizeof(int));
+    memcpy(CMSG_DATA(cmsg), &fd, sizeof(int));
+
+    int ret = SOCKET_ERROR;
+    do
+    {
+        ret = (int)sendmsg(channel, &msg, MSG_NOSIGNAL);
+    } while (ret == SOCKET_ERROR && sErrno == S_EINTR);
+
+    return ret == sizeof(data);
+}
+
+sock
+ox_socket_recv_fd(sock channel)
+{
+    char data = 0;
+    struct iovec iov;
+    iov.iov_base = &data;
+    iov.iov_len = sizeof(data);
+
+    union
+    {
+        struct cmsghdr  header;
+        char            space[CMSG_SPACE(sizeof(int))];
+    } control;
+    memset(&control, 0, sizeof(control));
+
+    struct msghdr msg;
+    memset(&msg, 0, sizeof(msg));
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = control.space;
+    msg.msg_controllen = sizeof(control.space);
+
+    int ret = SOCKET_ERROR;
+    do
+    {
+        ret = (int)recvmsg(channel, &msg, OX_RECV_FD_FLAGS);
+    } while (ret == SOCKET_ERROR && sErrno == S_EINTR);
+
+    if (ret <= 0)
+    {
+        return SOCKET_ERROR;
+    }
+
+    for (struct cmsghdr* cmsg = CMSG_FIRSTHDR(&msg); cmsg != NULL; cmsg = CMSG_NXTHDR(&msg, cmsg))
+    {
+        if (cmsg->cmsg_level == SOL_SOCKET && cmsg->cmsg_type == SCM_RIGHTS && cmsg->cmsg_len == CMSG_LEN(sizeof(int)))
+        {
+            sock fd = SOCKET_ERROR;
+            memcpy(&fd, CMSG_DATA(cmsg), sizeof(int));
+            return fd;
+        }
+    }
+
+    return SOCKET_ERROR;
+}
+
+#endif
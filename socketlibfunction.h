@@ -0,0 +1,58 @@
+#ifndef _SOCKETLIBFUNCTION_H_INCLUDED_
+#define _SOCKETLIBFUNCTION_H_INCLUDED_
+
+#include "socketlibtypes.h"
+
+void    ox_socket_init(void);
+bool    ox_socket_keepalive(sock socket, unsigned int timeout, unsigned int interval, unsigned int probes);
+bool    ox_socket_set_block(sock socket, bool block);
+bool    ox_socket_set_timeout(sock socket, unsigned int timeoutSec);
+int     ox_get_last_error();
+void    ox_socket_close(sock fd);
+/*  阻塞连接, 失败返回SOCKET_ERROR. 返回的socket为阻塞模式并设置了收发超时.
+    server_ip可以是主机名, IPv4或IPv6地址(解析结果缓存30秒), 多个地址时按happy eyeballs并行尝试;
+    以'/'开头时作为unix domain socket路径, 忽略port    */
+sock    ox_socket_connect(const char* server_ip, int port, unsigned int timeoutSec = 10);
+/*  同ox_socket_connect, 但连接阶段最多等待connectTimeoutMs毫秒, 连接后的收发超时仍为timeoutSec秒  */
+sock    ox_socket_connect_ms(const char* server_ip, int port, int64_t connectTimeoutMs, unsigned int timeoutSec = 10);
+/*  发起非阻塞连接, 不等待完成(用于reactor等I/O线程): server_ip同ox_socket_connect, 多个地址时只尝试第一个.
+    返回1已连接, 0正在连接(fd可写后以ox_socket_connect_error检查结果), -1失败. *fd为非阻塞socket.
+    主机名没有未过期的解析缓存时getaddrinfo仍会阻塞   */
+int     ox_socket_connect_nonblock(const char* server_ip, int port, sock* fd);
+/*  非阻塞连接的结果(SO_ERROR), 0表示成功  */
+int     ox_socket_connect_error(sock fd);
+/*  同时建立count个连接(所有连接的尝试一起poll), fds中失败的为SOCKET_ERROR, 返回成功的个数   */
+int     ox_socket_connect_all(const char* server_ip, int port, int count, sock* fds, unsigned int timeoutSec = 10);
+int     ox_socket_nodelay(sock fd);
+/*  事件驱动连接(reactor, io_uring, SSDBAsyncConnection)的通用设置: 非阻塞, TCP_NODELAY,
+    keepalive(空闲30秒后每3秒探测, 10次无响应断开). 失败返回false, 不关闭fd   */
+bool    ox_socket_setup_async(sock fd);
+/*  steady clock毫秒, 用于计算间隔与超时    */
+int64_t ox_now_ms();
+/*  设置收发缓冲区大小, <=0的一项保持系统默认  */
+bool    ox_socket_set_buffer_size(sock fd, int sendSize, int recvSize);
+
+#if defined __linux__
+/*  以下选项在内核不支持或权限不足时返回false, socket不受影响   */
+/*  阻塞读时在驱动队列上忙等us微秒(SO_BUSY_POLL, 超过net.core.busy_read需要CAP_NET_ADMIN)   */
+bool    ox_socket_busy_poll(sock fd, int us);
+/*  立即回复ACK而不是延迟确认, 不是持久选项, 每次recv之后需要重新设置    */
+bool    ox_socket_quickack(sock fd);
+bool    ox_socket_incoming_cpu(sock fd, int cpu);
+/*  打开SO_ZEROCOPY, 之后send可以使用MSG_ZEROCOPY   */
+bool    ox_socket_enable_zerocopy(sock fd);
+/*  非阻塞地读取错误队列中的MSG_ZEROCOPY完成通知, 返回已完成的send次数;
+    内核实际回退为拷贝时(例如loopback)把*copied置为true    */
+int     ox_socket_drain_zerocopy(sock fd, bool* copied);
+#endif
+
+#if !defined PLATFORM_WINDOWS
+/*  连接unix domain socket, 连接完成后与ox_socket_connect相同为阻塞模式并设置收发超时  */
+sock    ox_socket_connect_unix(const char* path, unsigned int timeoutSec = 10);
+/*  通过unix domain socket channel把已连接的fd传给另一个进程(SCM_RIGHTS), fd仍由调用方关闭 */
+bool    ox_socket_send_fd(sock channel, sock fd);
+/*  从channel接收一个fd(阻塞), 失败返回SOCKET_ERROR    */
+sock    ox_socket_recv_fd(sock channel);
+#endif
+
+#endif
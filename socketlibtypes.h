@@ -20,6 +20,7 @@
 #include <poll.h>
 #include <netdb.h>
 #include <arpa/inet.h>
+#include <sys/un.h>
 #include <errno.h>
 #include <fcntl.h>
 #include <sys/ioctl.h>
@@ -0,0 +1,337 @@
+#include <string.h>
+#include <algorithm>
+
+#include "buffer.h"
+#include "socketlibtypes.h"
+#include "socketlibfunction.h"
+
+#include "ssdb_protocol.h"
+#include "ssdb_async_connection.h"
+
+#if defined PLATFORM_WINDOWS
+#define poll WSAPoll
+#endif
+
+SSDBAsyncConnection::SSDBAsyncConnection()
+{
+    ox_socket_init();
+    m_socket = SOCKET_ERROR;
+    m_request = new SSDBProtocolRequest;
+    m_reponse = new SSDBProtocolResponse;
+    m_recvBuffer = ox_buffer_new(DEFAULT_SSDBPROTOCOL_LEN);
+    m_head = NULL;
+    m_tail = NULL;
+}
+
+SSDBAsyncConnection::~SSDBAsyncConnection()
+{
+    disconnect();
+    delete m_request;
+    m_request = NULL;
+    delete m_reponse;
+    m_reponse = NULL;
+    ox_buffer_delete(m_recvBuffer);
+    m_recvBuffer = NULL;
+}
+
+bool SSDBAsyncConnection::connect(const char* ip, int port, uint32_t timeoutSec)
+{
+    if (m_socket != SOCKET_ERROR)
+    {
+        return true;
+    }
+
+    sock fd = ox_socket_connect(ip, port, timeoutSec);
+    if (fd == SOCKET_ERROR)
+    {
+        return false;
+    }
+    if (!ox_socket_setup_async(fd))
+    {
+        ox_socket_close(fd);
+        return false;
+    }
+
+    m_socket = (int)fd;
+    m_request->init();
+    ox_buffer_init(m_recvBuffer);
+    return true;
+}
+
+void SSDBAsyncConnection::disconnect()
+{
+    closeSocket();
+    m_request->init();
+    failAll();
+}
+
+void SSDBAsyncConnection::closeSocket()
+{
+    if (m_socket != SOCKET_ERROR)
+    {
+        ox_socket_close(m_socket);
+        m_socket = SOCKET_ERROR;
+    }
+}
+
+bool SSDBAsyncConnection::isconnected() const
+{
+    return m_socket != SOCKET_ERROR;
+}
+
+SSDBProtocolRequest* SSDBAsyncConnection::request()
+{
+    return m_request;
+}
+
+bool SSDBAsyncConnection::submit(SSDBAsyncOp* op)
+{
+    /*  先尽量立即发送再排队, 剩余部分等待可写事件. 失败时op不入队也不回调:
+        调用方(如协程的await_suspend)可能还在提交过程中, 回调会在其中恢复甚至销毁调用方   */
+    if (m_socket == SOCKET_ERROR || !trySend())
+    {
+        closeSocket();
+        m_request->init();
+        return false;
+    }
+
+    op->m_next = NULL;
+    if (m_tail != NULL)
+    {
+        m_tail->m_next = op;
+    }
+    else
+    {
+        m_head = op;
+    }
+    m_tail = op;
+    return true;
+}
+
+bool SSDBAsyncConnection::busy() const
+{
+    return m_head != NULL;
+}
+
+int SSDBAsyncConnection::fd() const
+{
+    return m_socket;
+}
+
+bool SSDBAsyncConnection::wantWrite() const
+{
+    return m_request->getResultLen() > 0;
+}
+
+void SSDBAsyncConnection::onWritable()
+{
+    flush();
+}
+
+void SSDBAsyncConnection::flush()
+{
+    if (!trySend())
+    {
+        disconnect();
+    }
+}
+
+bool SSDBAsyncConnection::trySend()
+{
+    while (m_socket != SOCKET_ERROR && m_request->getResultLen() > 0)
+    {
+        int sendret = ::send(m_socket, m_request->getResult(), m_request->getResultLen(), 0);
+        if (sendret < 0)
+        {
+            if (sErrno == S_EWOULDBLOCK)
+            {
+                break;
+            }
+            if (sErrno != S_EINTR)
+            {
+                return false;
+            }
+        }
+        else
+        {
+            m_request->consume(sendret);
+        }
+    }
+    return true;
+}
+
+void SSDBAsyncConnection::onReadable()
+{
+    while (m_socket != SOCKET_ERROR)
+    {
+        if (ox_buffer_getwritevalidcount(m_recvBuffer) < 128)
+        {
+            ox_buffer_adjustto_head(m_recvBuffer);
+        }
+        if (ox_buffer_getwritevalidcount(m_recvBuffer) < 128)
+        {
+            /*  扩大缓冲区   */
+            buffer_s* temp = ox_buffer_new(ox_buffer_getsize(m_recvBuffer) * 2);
+            memcpy(ox_buffer_getwriteptr(temp), ox_buffer_getreadptr(m_recvBuffer), ox_buffer_getreadvalidcount(m_recvBuffer));
+            ox_buffer_addwritepos(temp, ox_buffer_getreadvalidcount(m_recvBuffer));
+            ox_buffer_delete(m_recvBuffer);
+            m_recvBuffer = temp;
+        }
+
+        int len = ::recv(m_socket, ox_buffer_getwriteptr(m_recvBuffer), ox_buffer_getwritevalidcount(m_recvBuffer), 0);
+        if (len < 0 && sErrno == S_EWOULDBLOCK)
+        {
+            break;
+        }
+        if ((len < 0 && sErrno != S_EINTR) || len == 0)
+        {
+            disconnect();
+            break;
+        }
+        if (len < 0)
+        {
+            continue;
+        }
+
+        ox_buffer_addwritepos(m_recvBuffer, len);
+
+        int packetLen = 0;
+        while (m_socket != SOCKET_ERROR &&
+            (packetLen = SSDBProtocolResponse::check_ssdb_packet(ox_buffer_getreadptr(m_recvBuffer), ox_buffer_getreadvalidcount(m_recvBuffer))) > 0)
+        {
+            SSDBAsyncOp* op = m_head;
+            if (op == NULL)
+            {
+                /*  没有对应请求的response, 协议已错乱  */
+                disconnect();
+                break;
+            }
+            m_head = op->m_next;
+            if (m_head == NULL)
+            {
+                m_tail = NULL;
+            }
+
+            m_reponse->init();
+            m_reponse->parse(ox_buffer_getreadptr(m_recvBuffer), packetLen);
+            ox_buffer_addreadpos(m_recvBuffer, packetLen);
+
+            /*  回调中可能提交新的请求(追加到发送缓冲区)或断开连接   */
+            op->complete(m_reponse);
+        }
+    }
+}
+
+void SSDBAsyncConnection::failAll()
+{
+    while (m_head != NULL)
+    {
+        SSDBAsyncOp* op = m_head;
+        m_head = op->m_next;
+        if (m_head == NULL)
+        {
+            m_tail = NULL;
+        }
+        op->complete(NULL);
+    }
+}
+
+void SSDBEventLoop::add(SSDBAsyncConnection* connection)
+{
+    if (std::find(m_connections.begin(), m_connections.end(), connection) == m_connections.end())
+    {
+        m_connections.push_back(connection);
+    }
+}
+
+void SSDBEventLoop::remove(SSDBAsyncConnection* connection)
+{
+    m_connections.erase(std::remove(m_connections.begin(), m_connections.end(), connection), m_connections.end());
+}
+
+int SSDBEventLoop::runOnce(int timeoutMs)
+{
+    std::vector<struct pollfd> fds;
+    std::vector<SSDBAsyncConnection*> ready;
+    std::vector<SSDBAsyncConnection*> failed;
+    for (size_t i = 0; i < m_connections.size(); ++i)
+    {
+        SSDBAsyncConnection* connection = m_connections[i];
+        if (!connection->isconnected())
+        {
+            if (connection->busy())
+            {
+                failed.push_back(connection);
+            }
+            continue;
+        }
+        struct pollfd pfd;
+        pfd.fd = connection->fd();
+        pfd.events = POLLIN;
+        if (connection->wantWrite())
+        {
+            pfd.events |= POLLOUT;
+        }
+        pfd.revents = 0;
+        fds.push_back(pfd);
+        ready.push_back(connection);
+    }
+
+    /*  submit中发送失败而断开的连接, 剩余的请求在这里失败  */
+    for (size_t i = 0; i < failed.size(); ++i)
+    {
+        failed[i]->disconnect();
+    }
+
+    if (fds.empty())
+    {
+        return (int)failed.size();
+    }
+
+    int ret = poll(&fds[0], (int)fds.size(), timeoutMs);
+    if (ret <= 0)
+    {
+        return (int)failed.size();
+    }
+
+    int handled = (int)failed.size();
+    for (size_t i = 0; i < fds.size(); ++i)
+    {
+        if (fds[i].revents == 0)
+        {
+            continue;
+        }
+        ++handled;
+        if (fds[i].revents & POLLOUT)
+        {
+            ready[i]->onWritable();
+        }
+        if (fds[i].revents & (POLLIN | POLLERR | POLLHUP))
+        {
+            ready[i]->onReadable();
+        }
+    }
+
+    return handled;
+}
+
+void SSDBEventLoop::run()
+{
+    while (true)
+    {
+        bool busy = false;
+        for (size_t i = 0; i < m_connections.size(); ++i)
+        {
+            if (m_connections[i]->busy())
+            {
+                busy = true;
+                break;
+            }
+        }
+        if (!busy)
+        {
+            break;
+        }
+        runOnce(100);
+    }
+}
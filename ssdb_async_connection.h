@@ -0,0 +1,102 @@
+#ifndef __SSDB_ASYNC_CONNECTION_H__
+#define __SSDB_ASYNC_CONNECTION_H__
+
+#include <string>
+#include <vector>
+
+#include "ssdb_client.h"
+
+/*  非阻塞ssdb连接与事件循环, 为协程等异步接口提供底层支持
+    请求按发送顺序排队, response按FIFO顺序匹配到对应的SSDBAsyncOp.
+    SSDBAsyncOp由调用方持有(如协程帧/栈上对象), 连接内部不为每个请求分配内存.
+    所有接口非线程安全, 只能在事件循环所在线程调用.   */
+
+class SSDBProtocolRequest;
+class SSDBProtocolResponse;
+class SSDBEventLoop;
+
+struct buffer_s;
+
+class SSDBAsyncOp
+{
+public:
+    SSDBAsyncOp() : m_next(NULL)
+    {
+    }
+    virtual ~SSDBAsyncOp()
+    {
+    }
+
+    /*  收到对应的response时回调, 连接断开时response为NULL.
+        response只在回调期间有效  */
+    virtual void            complete(SSDBProtocolResponse* response) = 0;
+
+private:
+    friend class SSDBAsyncConnection;
+    SSDBAsyncOp*            m_next;
+};
+
+class SSDBAsyncConnection
+{
+public:
+    SSDBAsyncConnection();
+    ~SSDBAsyncConnection();
+
+    /*  (阻塞)连接, 成功后切换为非阻塞模式  */
+    bool                    connect(const char* ip, int port, uint32_t timeoutSec=5);
+    /*  断开连接, 所有未完成的请求以NULL response完成 */
+    void                    disconnect();
+    bool                    isconnected() const;
+
+    /*  编码缓冲区: 先向其中append一个完整请求, 再调用submit提交对应的op.
+        连接已断开或立即发送失败时返回false, op不会被回调, 由调用方直接处理失败;
+        此时已排队的其他请求在下一次事件循环中以NULL response完成, 不在submit中回调   */
+    SSDBProtocolRequest*    request();
+    bool                    submit(SSDBAsyncOp* op);
+
+    /*  是否有未完成的请求   */
+    bool                    busy() const;
+
+    int                     fd() const;
+    bool                    wantWrite() const;
+    void                    onReadable();
+    void                    onWritable();
+
+private:
+    SSDBAsyncConnection(const SSDBAsyncConnection&);
+    void operator=(const SSDBAsyncConnection&);
+
+    void                    flush();
+    /*  发送编码缓冲区中的数据, 出错时返回false(不断开连接)   */
+    bool                    trySend();
+    void                    closeSocket();
+    void                    failAll();
+
+private:
+    int                     m_socket;
+    SSDBProtocolRequest*    m_request;
+    SSDBProtocolResponse*   m_reponse;
+    buffer_s*               m_recvBuffer;
+
+    /*  已提交但未收到response的请求队列    */
+    SSDBAsyncOp*            m_head;
+    SSDBAsyncOp*            m_tail;
+};
+
+/*  基于poll的单线程事件循环  */
+class SSDBEventLoop
+{
+public:
+    void                    add(SSDBAsyncConnection* connection);
+    void                    remove(SSDBAsyncConnection* connection);
+
+    /*  等待最多timeoutMs毫秒并处理就绪的连接, 返回处理的连接数   */
+    int                     runOnce(int timeoutMs);
+    /*  循环处理直到所有连接都没有未完成的请求 */
+    void                    run();
+
+private:
+    std::vector<SSDBAsyncConnection*>   m_connections;
+};
+
+#endif
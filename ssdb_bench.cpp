@@ -0,0 +1,299 @@
+#include <string>
+#include <vector>
+#include <map>
+#include <chrono>
+#include <stdio.h>
+#include <string.h>
+
+#include "buffer.h"
+#include "ssdb_protocol.h"
+
+/*  编解码层以及buffer的micro benchmark
+    输出为csv: name,iterations,ns_per_op,bytes_per_op,mb_per_sec
+    用法: ssdb_bench [过滤子串]    */
+
+using namespace std;
+
+typedef std::chrono::steady_clock BenchClock;
+
+static volatile int64_t g_sink = 0;
+static const char* g_filter = NULL;
+
+struct BenchResult
+{
+    int64_t iterations;
+    double  ns;
+};
+
+/*  自适应迭代次数: 直到单轮耗时超过minMs毫秒   */
+template<typename F>
+static void run_bench(const char* name, int64_t bytesPerOp, F func, int minMs = 200)
+{
+    if (g_filter != NULL && strstr(name, g_filter) == NULL)
+    {
+        return;
+    }
+
+    BenchResult result = { 0, 0 };
+    int64_t iterations = 1;
+    while (true)
+    {
+        BenchClock::time_point start = BenchClock::now();
+        for (int64_t i = 0; i < iterations; ++i)
+        {
+            func();
+        }
+        double ns = (double)std::chrono::duration_cast<std::chrono::nanoseconds>(BenchClock::now() - start).count();
+        if (ns >= minMs * 1000000.0 || iterations >= (int64_t(1) << 30))
+        {
+            result.iterations = iterations;
+            result.ns = ns;
+            break;
+        }
+        iterations *= (ns < minMs * 100000.0) ? 10 : 2;
+    }
+
+    double nsPerOp = result.ns / result.iterations;
+    double mbPerSec = nsPerOp > 0 ? (bytesPerOp / nsPerOp) * 1e9 / (1024 * 1024) : 0;
+    printf("%s,%lld,%.2f,%lld,%.2f\n", name, (long long)result.iterations, nsPerOp, (long long)bytesPerOp, mbPerSec);
+    fflush(stdout);
+}
+
+/*  构造服务器response, 第一个为状态   */
+static std::string make_reply(const std::vector<std::string>& items)
+{
+    SSDBProtocolRequest encoder;
+    for (size_t i = 0; i < items.size(); ++i)
+    {
+        encoder.appendStr(items[i]);
+    }
+    encoder.endl();
+    return std::string(encoder.getResult(), encoder.getResultLen());
+}
+
+static void bench_request()
+{
+    std::string smallKey("user:1000001");
+    std::string smallValue("hello_ssdb");
+    std::string bigValue(1024 * 1024, 'v');
+
+    {
+        SSDBProtocolRequest request;
+        request.appendStr("get");
+        request.appendStr(smallKey);
+        request.endl();
+        int64_t bytes = request.getResultLen();
+        run_bench("request_get_small", bytes, [&]() {
+            request.init();
+            request.appendStr("get");
+            request.appendStr(smallKey);
+            request.endl();
+            g_sink += request.getResultLen();
+        });
+    }
+
+    {
+        SSDBProtocolRequest request;
+        request.appendStr("set");
+        request.appendStr(smallKey);
+        request.appendStr(smallValue);
+        request.endl();
+        int64_t bytes = request.getResultLen();
+        run_bench("request_set_small", bytes, [&]() {
+            request.init();
+            request.appendStr("set");
+            request.appendStr(smallKey);
+            request.appendStr(smallValue);
+            request.endl();
+            g_sink += request.getResultLen();
+        });
+    }
+
+    /*  每次新建encoder, 包含从默认大小扩容的开销    */
+    {
+        int64_t bytes = 0;
+        {
+            SSDBProtocolRequest request;
+            request.appendStr("set");
+            request.appendStr(smallKey);
+            request.appendStr(bigValue);
+            request.endl();
+            bytes = request.getResultLen();
+        }
+        run_bench("request_set_1mb_fresh", bytes, [&]() {
+            SSDBProtocolRequest request;
+            request.appendStr("set");
+            request.appendStr(smallKey);
+            request.appendStr(bigValue);
+            request.endl();
+            g_sink += request.getResultLen();
+        });
+    }
+
+    {
+        std::vector<std::string> keys;
+        for (int i = 0; i < 10000; ++i)
+        {
+            char key[32];
+            snprintf(key, sizeof(key), "multi_key_%d", i);
+            keys.push_back(key);
+        }
+
+        int64_t bytes = 0;
+        {
+            SSDBProtocolRequest request;
+            request.appendStr("multi_set");
+            for (size_t i = 0; i < keys.size(); ++i)
+            {
+                request.appendStr(keys[i]);
+                request.appendStr(smallValue);
+            }
+            request.endl();
+            bytes = request.getResultLen();
+        }
+        run_bench("request_multi_set_10k_fresh", bytes, [&]() {
+            SSDBProtocolRequest request;
+            request.appendStr("multi_set");
+            for (size_t i = 0; i < keys.size(); ++i)
+            {
+                request.appendStr(keys[i]);
+                request.appendStr(smallValue);
+            }
+            request.endl();
+            g_sink += request.getResultLen();
+        });
+    }
+
+    {
+        const char* block = "0123456789abcdef";
+        SSDBProtocolRequest request;
+        run_bench("request_append_block_16b", 16, [&]() {
+            if (request.getResultLen() > 64 * 1024)
+            {
+                request.init();
+            }
+            request.appendBlock(block, 16);
+        });
+    }
+}
+
+static void bench_response(const char* name, const std::string& reply)
+{
+    const char* data = reply.c_str();
+    int len = (int)reply.size();
+    std::string checkName = std::string("check_packet_") + name;
+    std::string parseName = std::string("parse_") + name;
+
+    run_bench(checkName.c_str(), len, [&]() {
+        g_sink += SSDBProtocolResponse::check_ssdb_packet(data, len);
+    });
+
+    SSDBProtocolResponse response;
+    run_bench(parseName.c_str(), len, [&]() {
+        response.init();
+        response.parse(data, len);
+        g_sink += response.getBuffersLen();
+    });
+}
+
+static void bench_codec()
+{
+    std::vector<std::string> items;
+
+    items.push_back("ok");
+    std::string statusReply = make_reply(items);
+    bench_response("status", statusReply);
+
+    items.push_back(std::string(1024 * 1024, 'v'));
+    std::string bigReply = make_reply(items);
+    bench_response("value_1mb", bigReply);
+
+    items.clear();
+    items.push_back("ok");
+    for (int i = 0; i < 10000; ++i)
+    {
+        char item[32];
+        snprintf(item, sizeof(item), "list_item_%d", i);
+        items.push_back(item);
+    }
+    std::string listReply = make_reply(items);
+    bench_response("list_10k", listReply);
+
+    SSDBProtocolResponse response;
+    response.parse(listReply.c_str(), (int)listReply.size());
+    run_bench("read_list_10k", (int64_t)listReply.size(), [&]() {
+        std::vector<std::string> ret;
+        read_list(&response, &ret);
+        g_sink += ret.size();
+    });
+    run_bench("read_map_5k", (int64_t)listReply.size(), [&]() {
+        std::map<std::string, std::string> ret;
+        read_map(&response, &ret);
+        g_sink += ret.size();
+    });
+
+    response.init();
+    response.parse(bigReply.c_str(), (int)bigReply.size());
+    run_bench("read_str_1mb", (int64_t)bigReply.size(), [&]() {
+        std::string ret;
+        read_str(&response, &ret);
+        g_sink += ret.size();
+    });
+}
+
+static void bench_buffer()
+{
+    const char* data = "0123456789abcdef0123456789abcdef0123456789abcdef0123456789abcdef";
+
+    {
+        buffer_s* buffer = ox_buffer_new(64 * 1024);
+        run_bench("buffer_write_64b", 64, [&]() {
+            if (ox_buffer_write(buffer, data, 64) == 0)
+            {
+                ox_buffer_init(buffer);
+            }
+        });
+        ox_buffer_delete(buffer);
+    }
+
+    /*  模拟recv: 写满后消费大部分数据, 残留4k尾部搬移到头部  */
+    {
+        const int size = 64 * 1024;
+        const int tail = 4096;
+        buffer_s* buffer = ox_buffer_new(size);
+        std::string block(size, 'x');
+        ox_buffer_write(buffer, block.c_str(), tail);
+        run_bench("buffer_recv_adjustto_head_4k_tail", size - tail, [&]() {
+            ox_buffer_write(buffer, block.c_str(), size - tail);
+            ox_buffer_addreadpos(buffer, size - tail);
+            ox_buffer_adjustto_head(buffer);
+            g_sink += ox_buffer_getreadvalidcount(buffer);
+        });
+        ox_buffer_delete(buffer);
+    }
+
+    {
+        buffer_s* buffer = ox_buffer_new(1024 * 1024 + 1024);
+        std::string block(1024 * 1024, 'x');
+        run_bench("buffer_write_1mb", (int64_t)block.size(), [&]() {
+            ox_buffer_init(buffer);
+            g_sink += ox_buffer_write(buffer, block.c_str(), (int)block.size());
+        });
+        ox_buffer_delete(buffer);
+    }
+}
+
+int main(int argc, char** argv)
+{
+    if (argc > 1)
+    {
+        g_filter = argv[1];
+    }
+
+    printf("name,iterations,ns_per_op,bytes_per_op,mb_per_sec\n");
+    bench_request();
+    bench_codec();
+    bench_buffer();
+
+    return 0;
+}
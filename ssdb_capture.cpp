@@ -0,0 +1,128 @@
+#include <string.h>
+#include <errno.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+
+#include "platform.h"
+#include "ssdb_capture.h"
+
+#if defined PLATFORM_WINDOWS
+#include <io.h>
+#include <windows.h>
+#else
+#include <unistd.h>
+#include <sys/time.h>
+#endif
+
+SSDBTrafficLog::SSDBTrafficLog()
+{
+    m_fd = -1;
+}
+
+SSDBTrafficLog::~SSDBTrafficLog()
+{
+    close();
+}
+
+bool SSDBTrafficLog::open(const char* path)
+{
+    close();
+
+#if defined PLATFORM_WINDOWS
+    m_fd = _open(path, _O_RDWR | _O_CREAT | _O_APPEND | _O_BINARY, _S_IREAD | _S_IWRITE);
+#else
+    m_fd = ::open(path, O_RDWR | O_CREAT | O_APPEND, 0644);
+#endif
+    if (m_fd < 0)
+    {
+        return false;
+    }
+
+    /*  新文件写入文件头    */
+    struct stat st;
+    if (fstat(m_fd, &st) == 0 && st.st_size == 0)
+    {
+        if (!append(SSDB_CAPTURE_MAGIC, SSDB_CAPTURE_MAGIC_LEN))
+        {
+            close();
+            return false;
+        }
+    }
+    else
+    {
+        /*  不同格式的记录不能混在同一个文件中   */
+        char magic[SSDB_CAPTURE_MAGIC_LEN];
+#if defined PLATFORM_WINDOWS
+        int len = _read(m_fd, magic, SSDB_CAPTURE_MAGIC_LEN);
+#else
+        int len = (int)::read(m_fd, magic, SSDB_CAPTURE_MAGIC_LEN);
+#endif
+        if (len != SSDB_CAPTURE_MAGIC_LEN || memcmp(magic, SSDB_CAPTURE_MAGIC, SSDB_CAPTURE_MAGIC_LEN) != 0)
+        {
+            close();
+            return false;
+        }
+    }
+
+    return true;
+}
+
+void SSDBTrafficLog::close()
+{
+    if (m_fd >= 0)
+    {
+#if defined PLATFORM_WINDOWS
+        _close(m_fd);
+#else
+        ::close(m_fd);
+#endif
+        m_fd = -1;
+    }
+}
+
+bool SSDBTrafficLog::isopen() const
+{
+    return m_fd >= 0;
+}
+
+bool SSDBTrafficLog::append(const char* data, int len)
+{
+    /*  O_APPEND保证每次write整块追加到文件末尾, 不需要加锁   */
+    int left_len = len;
+    while (m_fd >= 0 && left_len > 0)
+    {
+#if defined PLATFORM_WINDOWS
+        int ret = _write(m_fd, data + (len - left_len), left_len);
+#else
+        int ret = (int)::write(m_fd, data + (len - left_len), left_len);
+#endif
+        if (ret < 0)
+        {
+            if (errno != EINTR)
+            {
+                break;
+            }
+        }
+        else
+        {
+            left_len -= ret;
+        }
+    }
+
+    return left_len == 0;
+}
+
+int64_t SSDBTrafficLog::now()
+{
+#if defined PLATFORM_WINDOWS
+    FILETIME ft;
+    GetSystemTimeAsFileTime(&ft);
+    int64_t t = ((int64_t)ft.dwHighDateTime << 32) | ft.dwLowDateTime;
+    return (t - 116444736000000000LL) / 10;
+#else
+    struct timeval tv;
+    gettimeofday(&tv, NULL);
+    return (int64_t)tv.tv_sec * 1000000 + tv.tv_usec;
+#endif
+}
@@ -0,0 +1,49 @@
+#ifndef __SSDB_CAPTURE_H__
+#define __SSDB_CAPTURE_H__
+
+#include <string>
+#include "ssdb_client.h"
+
+/*  流量录制日志
+    文件格式(主机字节序):
+        文件头: "SSDBCAP2" 8字节
+        记录:   int64 时间戳(微秒,unix时间) + int32 请求长度 + int32 命令个数 + 请求数据(SSDBProtocolRequest::getResult())
+        一次pipeline发送的多个命令为一条记录, 回放时按命令个数接收response.
+        旧格式"SSDBCAP1"的记录没有命令个数(每条记录一个命令), 回放工具仍可读取, 但不能追加录制
+
+    多个SSDBClient(各自线程)可共享同一个SSDBTrafficLog: 每个client在自己的录制缓冲区中无锁追加记录,
+    缓冲区满或停止录制时以一次O_APPEND write整块写入, 不同client的记录块之间时间戳可能交错,
+    回放时按时间戳排序即可.   */
+
+#define SSDB_CAPTURE_MAGIC "SSDBCAP2"
+#define SSDB_CAPTURE_MAGIC_V1 "SSDBCAP1"
+#define SSDB_CAPTURE_MAGIC_LEN 8
+#define SSDB_CAPTURE_RECORD_HEAD_LEN 16
+#define SSDB_CAPTURE_RECORD_HEAD_LEN_V1 12
+
+class SSDBTrafficLog
+{
+public:
+    SSDBTrafficLog();
+    ~SSDBTrafficLog();
+
+    /*  以追加方式打开(不存在则创建)日志文件, 已有的文件不是当前格式时失败  */
+    bool                    open(const char* path);
+    void                    close();
+    bool                    isopen() const;
+
+    /*  整块追加已编码好的记录, 线程安全   */
+    bool                    append(const char* data, int len);
+
+    /*  当前unix时间, 微秒   */
+    static int64_t          now();
+
+private:
+    SSDBTrafficLog(const SSDBTrafficLog&);
+    void operator=(const SSDBTrafficLog&);
+
+private:
+    int                     m_fd;
+};
+
+#endif
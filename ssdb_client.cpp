@@ -2,578 +2,383 @@
 #include <string.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <chrono>
 
 #include "buffer.h"
 #include "socketlibtypes.h"
+#include "socketlibfunction.h"
 
 #include "ssdb_client.h"
+#include "ssdb_protocol.h"
+#include "ssdb_capture.h"
+#include "ssdb_codec.h"
 
-#ifdef PLATFORM_WINDOWS
-#include <MSTcpIP.h>
-#pragma comment(lib,"ws2_32.lib")
-#else
-#include <netinet/tcp.h>
-#endif
+#include <sys/stat.h>
 
 #if defined PLATFORM_WINDOWS
-#define snprintf _snprintf 
+#include <io.h>
+#else
+#include <sys/uio.h>
+#endif
+#if defined __linux__
+#include <sys/sendfile.h>
 #endif
 
-#define DEFAULT_SSDBPROTOCOL_LEN 1024
-
-static const uint KEEP_ALIVE_TIMEOUT = 30;
-static const uint KEEP_ALIVE_INTERVAL = 3;
-static const uint KEEP_ALIVE_PROBES = 10;
+static const int CAPTURE_BUFFER_LEN = 64 * 1024;
+/*  流式读取value时每次交给sink的最大长度, 以及splice使用的管道大小  */
+static const int STREAM_CHUNK_LEN = 64 * 1024;
+static const int SPLICE_PIPE_LEN = 1024 * 1024;
 
 using namespace std;
 
-static void
-ox_socket_init(void)
-{
-#if defined PLATFORM_WINDOWS
-    static WSADATA g_WSAData;
-    WSAStartup(MAKEWORD(2,2), &g_WSAData);
-#endif
-}
-
-static bool ox_socket_keepalive(sock socket, uint timeout, uint interval, uint probes)
-{
-#ifdef PLATFORM_WINDOWS
-	tcp_keepalive tcpKeepAlive;
-	tcpKeepAlive.onoff = 1;
-	tcpKeepAlive.keepalivetime = timeout * 1000;
-	tcpKeepAlive.keepaliveinterval = interval * 1000;
-	DWORD dwBytesRet = 0; 
-	int result = WSAIoctl(
-		socket,
-		SIO_KEEPALIVE_VALS,
-		&tcpKeepAlive,
-		sizeof(tcpKeepAlive),
-		NULL,
-		0,
-		&dwBytesRet,
-		NULL,
-		NULL
-		);
-	if(result != 0)
-	{
-		return false;
-	}
-#else
-	int hSocket = (int)socket;
-	int enable = 1;
-	if(setsockopt(hSocket, SOL_SOCKET, SO_KEEPALIVE, (void *)&enable, sizeof(enable)) != 0)
-	{
-		return false;
-	}
-	setsockopt(hSocket, SOL_TCP, TCP_KEEPIDLE, (void *)&timeout, sizeof(timeout));
-	setsockopt(hSocket, SOL_TCP, TCP_KEEPINTVL, (void *)&interval, sizeof(interval));
-	setsockopt(hSocket, SOL_TCP, TCP_KEEPCNT, (void *)&probes, sizeof(probes));
-#endif
-	return true;
-}
-
-static bool ox_socket_set_block(sock socket, bool block)
-{
-#ifdef _WIN32
-	u_long nonblock = block ? 0 : 1;
-	return ioctlsocket(socket, FIONBIO, &nonblock) == 0;
-#else
-	int flag = fcntl(socket, F_GETFL, 0);
-	if(block)
-	{
-		flag &= (~O_NONBLOCK);
-		flag &= (~O_NDELAY);
-	}
-	else
-	{
-		flag |= O_NONBLOCK;
-		flag |= O_NDELAY;
-	}
-	return fcntl(socket, F_SETFL, flag) != -1;
-#endif
-}
-
-static bool ox_socket_set_timeout(sock socket, uint timeoutSec)
-{
-#ifdef _WIN32
-	int timeout = timeoutSec * 1000;
-#else
-	timeval timeout = { timeoutSec, 0 };
-#endif
-	if(setsockopt(socket, SOL_SOCKET, SO_SNDTIMEO, (const char *)&timeout, sizeof(timeout)) == SOCKET_ERROR)
-	{
-		return false;
-	}
-	if(setsockopt(socket, SOL_SOCKET, SO_RCVTIMEO, (const char *)&timeout, sizeof(timeout)) == SOCKET_ERROR)
-	{
-		return false;
-	}
-	return true;
-}
-
-int ox_get_last_error()
-{
-#ifdef _WIN32
-	return WSAGetLastError();
-#else
-	return errno;
-#endif
-}
-
-static void
-ox_socket_close(sock fd)
+static int64_t now_us()
 {
-#if defined PLATFORM_WINDOWS
-    closesocket(fd);
-#else
-    close(fd);
-#endif
+    return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
 }
 
-static sock
-ox_socket_connect(const char* server_ip, int port, uint timeoutSec=10)
+void SSDBClient::request(const char* buffer, int len, bool idempotent)
 {
-    struct sockaddr_in server_addr;
-    sock clientfd = SOCKET_ERROR;
-
-    ox_socket_init();
-
-    clientfd = socket(AF_INET, SOCK_STREAM, 0);
-	if (clientfd == SOCKET_ERROR)
-	{
-		return clientfd;
-	}
-	if (!ox_socket_set_block(clientfd, false))
-	{
-		ox_socket_close(clientfd);
-		return SOCKET_ERROR;
-	}
-
-	server_addr.sin_family = AF_INET;
-	server_addr.sin_addr.s_addr = inet_addr(server_ip);
-	server_addr.sin_port = htons(port);
-
-	if (connect(clientfd, (struct sockaddr*)&server_addr, sizeof(struct sockaddr)) == SOCKET_ERROR)
-	{
-		int error = ox_get_last_error();
-#ifdef PLATFORM_WINDOWS
-		if (error != WSAEWOULDBLOCK)
-#else
-		if (error != EINPROGRESS)
-#endif
-		{
-			ox_socket_close(clientfd);
-			return SOCKET_ERROR;
-		}
-		fd_set fdsWrite;
-		FD_ZERO(&fdsWrite);
-		FD_SET(clientfd, &fdsWrite);
-		fd_set fdsExcept;
-		FD_ZERO(&fdsExcept);
-		FD_SET(clientfd, &fdsExcept);
-		timeval timeout = { timeoutSec, 0 };
-#ifdef PLATFORM_WINDOWS
-		int ret = select(0, NULL, &fdsWrite, &fdsExcept, &timeout);
-#else
-		int ret = select(clientfd + 1, NULL, &fdsWrite, &fdsExcept, &timeout);
-#endif
-		if(ret > 0)
-		{
-#ifdef PLATFORM_WINDOWS
-			int errorLength = sizeof(error);
-#else
-			socklen_t errorLength = sizeof(error);
-#endif
-			if(getsockopt(clientfd, SOL_SOCKET, SO_ERROR, (char *)&error, &errorLength) == SOCKET_ERROR)
-			{
-				ox_socket_close(clientfd);
-				return SOCKET_ERROR;
-			}
-			if(error != 0)
-			{
-				ox_socket_close(clientfd);
-				return SOCKET_ERROR;
-			}
-		}
-		else if(ret == 0)
-		{
-			ox_socket_close(clientfd);
-			return SOCKET_ERROR;
-		}
-		else
-		{
-			ox_socket_close(clientfd);
-			return SOCKET_ERROR;
-		}
-	}
-	if (!ox_socket_set_block(clientfd, true))
-	{
-		ox_socket_close(clientfd);
-		return SOCKET_ERROR;
-	}
-	if (!ox_socket_set_timeout(clientfd, timeoutSec))
-	{
-		ox_socket_close(clientfd);
-		return SOCKET_ERROR;
-	}
-
-    return clientfd;
-}
-
-static int
-ox_socket_nodelay(sock fd)
-{
-    int flag = 1;
-    return setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, (char *)&flag, sizeof(flag));
-}
-
-class SSDBProtocolRequest
-{
-public:
-    SSDBProtocolRequest()
-    {
-        m_request = ox_buffer_new(DEFAULT_SSDBPROTOCOL_LEN);
-    }
-
-    ~SSDBProtocolRequest()
-    {
-        ox_buffer_delete(m_request);
-        m_request = NULL;
-    }
-
-    void appendStr(const char* str)
+    bool retry = idempotent && m_reconnectPolicy.retryIdempotent;
+    if (m_transport != NULL)
     {
-        int len = (int)strlen(str);
-        char lenstr[16];
-        int num = snprintf(lenstr, sizeof(len), "%d\n", len);
-        appendBlock(lenstr, num);
-        appendBlock(str, len);
-        appendBlock("\n", 1);
+        m_reponse->init();
+        capture(buffer, len, 1);
+        if (transportRequest(buffer, len, 1, SSDBPipelineVisitor()) == 0 && retry)
+        {
+            m_reponse->init();
+            transportRequest(buffer, len, 1, SSDBPipelineVisitor());
+        }
+        m_request->init();
+        return;
     }
 
-    void appendInt64(int64_t val)
+    beginRequest();
+    m_reponse->init();
+    capture(buffer, len, 1);
+
+    for (int attempt = 0; ensureConnected(); ++attempt)
     {
-        char str[30];
-        snprintf(str, sizeof(str), "%lld", val);
-        appendStr(str);
-    }
+        int left_len = send(buffer, len, true);
 
-	void appendInt32(int val)
-	{
-		char str[16];
-		snprintf(str, sizeof(str), "%d", val);
-		appendStr(str);
-	}
+        /*  如果发送请求完毕，就进行接收response处理    */
+        if(len > 0 && left_len == 0)
+        {
+            recv();
+        }
 
-    void appendStr(const string& str)
-    {
-        char len[16];
-        int num = snprintf(len, sizeof(len), "%d\n", (int)str.size());
-        appendBlock(len, num);
-        appendBlock(str.c_str(), (int)str.length());
-        appendBlock("\n", 1);
+        /*  连接在请求过程中断开(而不是超时)且没有收到response: 幂等命令在新连接上重发一次   */
+        if (!retry || attempt > 0 || m_timedout || isconnected() || m_reponse->getBuffersLen() > 0)
+        {
+            break;
+        }
     }
 
-    void endl()
+    endRequest();
+    m_request->init();
+}
+
+int SSDBClient::send(const char* buffer, int len, bool zerocopy)
+{
+    int left_len = len;
+    zerocopy = zerocopy && m_zerocopy;
+    while(m_socket != SOCKET_ERROR && left_len > 0)
     {
-        appendBlock("\n", 1);
+        int flags = 0;
+#if defined __linux__ && defined MSG_ZEROCOPY
+        if(zerocopy && left_len >= m_socketOptions.zerocopyThreshold)
+        {
+            flags = MSG_ZEROCOPY;
+        }
+#endif
+        int sendret = ::send(m_socket, buffer+(len-left_len), left_len, flags);
+        if(sendret >= 0 && flags != 0)
+        {
+            ++m_zerocopyPending;
+        }
+        if(sendret < 0)
+        {
+            if(flags != 0 && sErrno == ENOBUFS)
+            {
+                /*  未完成的零拷贝通知超过optmem限制, 本次请求改为普通发送   */
+                drainZerocopy();
+                zerocopy = false;
+                continue;
+            }
+            if(sErrno != S_EINTR && sErrno != S_EWOULDBLOCK)
+            {
+                /*  链接断开    */
+                ox_socket_close(m_socket);
+                m_socket = SOCKET_ERROR;
+                break;
+            }
+            if(sErrno == S_EWOULDBLOCK && !waitSocket(true))
+            {
+                break;
+            }
+        }
+        else
+        {
+            left_len -= sendret;
+        }
     }
 
-    void appendBlock(const char* data, int len)
+    return left_len;
+}
+
+void SSDBClient::recv()
+{
+    /*  重置读缓冲区  */
+    ox_buffer_init(m_recvBuffer);
+    recvPackets(1, SSDBPipelineVisitor());
+}
+
+/*  写入fd(可以是非阻塞的), 全部写完返回true   */
+static bool write_fd(int fd, const char* data, int len)
+{
+    while (len > 0)
     {
-        if (ox_buffer_getwritevalidcount(m_request) < len)
+#if defined PLATFORM_WINDOWS
+        int ret = _write(fd, data, len);
+#else
+        int ret = (int)::write(fd, data, len);
+        if (ret < 0 && errno == EINTR)
         {
-            buffer_s* temp = ox_buffer_new(ox_buffer_getsize(m_request) + len);
-            memcpy(ox_buffer_getwriteptr(temp), ox_buffer_getreadptr(m_request), ox_buffer_getreadvalidcount(m_request));
-            ox_buffer_addwritepos(temp, ox_buffer_getreadvalidcount(m_request));
-            ox_buffer_delete(m_request);
-            m_request = temp;
+            continue;
         }
-
-        ox_buffer_write(m_request, data, len);
+        if (ret < 0 && errno == EAGAIN)
+        {
+            struct pollfd pfd;
+            pfd.fd = fd;
+            pfd.events = POLLOUT;
+            pfd.revents = 0;
+            poll(&pfd, 1, -1);
+            continue;
+        }
+#endif
+        if (ret <= 0)
+        {
+            return false;
+        }
+        data += ret;
+        len -= ret;
     }
+    return true;
+}
 
-    const char* getResult()
+static bool deliver_value(const char* data, int len, const SSDBValueSink& sink, int fd)
+{
+    if (len <= 0)
     {
-        return ox_buffer_getreadptr(m_request);
+        return true;
     }
-    int getResultLen()
+    return sink ? sink(data, len) : write_fd(fd, data, len);
+}
+
+/*  解析get/hget response的开头, 状态为ok且带有value时返回状态与value长度行的总长度,
+    数据不足返回0, 其他情况(如not_found)返回-1   */
+static int parse_stream_header(const char* data, int len, int64_t* valueLen)
+{
+    const char* end = data + len;
+    const char* line = (const char*)memchr(data, '\n', len);
+    if (line == NULL)
     {
-        return ox_buffer_getreadvalidcount(m_request);
+        return 0;
     }
 
-    void init()
+    long statusLen = strtol(data, NULL, 10);
+    const char* status = line + 1;
+    if (end - status < statusLen + 2)
     {
-        ox_buffer_init(m_request);
+        return 0;
     }
-private:
-    buffer_s*   m_request;
-};
-
-struct Bytes
-{
-    const char* buffer;
-    int len;
-};
-
-class SSDBProtocolResponse
-{
-public:
-    ~SSDBProtocolResponse()
+    if (statusLen != 2 || memcmp(status, "ok", 2) != 0)
     {
+        return -1;
     }
 
-    void init()
+    const char* next = status + statusLen + 1;
+    if (*next == '\n')
     {
-        mBuffers.clear();
+        return -1;
     }
-
-    void parse(const char* buffer, int len)
+    line = (const char*)memchr(next, '\n', end - next);
+    if (line == NULL)
     {
-        const char* current = buffer;
-        while (true)
-        {
-            char* temp;
-            int datasize = strtol(current, &temp, 10);
-            current = temp;
-            current += 1;
-            Bytes tmp = { current, datasize };
-            mBuffers.push_back(tmp);
-            current += datasize;
-
-            current += 1;
-
-            if (*current == '\n')
-            {
-                /*  收到完整消息,ok  */
-                current += 1;         /*  跳过\n    */
-                break;
-            }
-        }
+        return 0;
     }
+    *valueLen = strtoll(next, NULL, 10);
+    return (int)(line + 1 - data);
+}
 
-    Bytes* getByIndex(size_t index)
+/*  multi_*命令参数编码后的总长度   */
+static int64_t encoded_size(const std::vector<std::string>& keys)
+{
+    int64_t len = 0;
+    for (size_t i = 0; i < keys.size(); ++i)
     {
-        if(mBuffers.size() > index)
-        {
-            return &mBuffers[index];
-        }
-        else
-        {
-            const char* nullstr = "null";
-            static  Bytes nullbuffer = { nullstr, (int)strlen(nullstr)+1 };
-            return &nullbuffer;
-        }
+        len += SSDBProtocolRequest::encodedLen((int)keys[i].size());
     }
+    return len;
+}
 
-    size_t getBuffersLen() const
+static int64_t encoded_size(const std::map<std::string, std::string>& kvs)
+{
+    int64_t len = 0;
+    for (std::map<std::string, std::string>::const_iterator iter = kvs.begin(); iter != kvs.end(); ++iter)
     {
-        return mBuffers.size();
+        len += SSDBProtocolRequest::encodedLen((int)iter->first.size()) + SSDBProtocolRequest::encodedLen((int)iter->second.size());
     }
+    return len;
+}
 
-    Status getStatus()
+static int64_t encoded_size(const std::map<std::string, int64_t>& kss)
+{
+    int64_t len = 0;
+    for (std::map<std::string, int64_t>::const_iterator iter = kss.begin(); iter != kss.end(); ++iter)
     {
-        if(mBuffers.empty())
-        {
-            return Status("error");
-        }
-
-        return string(mBuffers[0].buffer, mBuffers[0].len);
+        len += SSDBProtocolRequest::encodedLen((int)iter->first.size()) + SSDBProtocolRequest::encodedLen(SSDBProtocolRequest::int64Len(iter->second));
     }
+    return len;
+}
 
-    static int check_ssdb_packet(const char* buffer, int len)
+/*  按块读取value交给consume, 读取或consume失败返回false  */
+static bool read_source(const SSDBValueSource& value, const std::function<bool(const char*, int)>& consume)
+{
+    if (value.data != NULL)
     {
-        const char* end = buffer + len; /*  无效内存地址  */
-        const char* current = buffer;   /*  当前解析位置*/
-
-        while (true)
+        for (int64_t pos = 0; pos < value.size;)
         {
-            char* temp;
-            int datasize = strtol(current, &temp, 10);
-            if (datasize == 0 && temp == current)
-            {
-                break;
-            }
-            current = temp;         /*  跳过datasize*/
-
-            if (current >= end || *current != '\n')
-            {
-                break;
-            }
-            current += 1;         /*  跳过\n    */
-            current += datasize;  /*  跳过data  */
-
-            if (current >= end || *current != '\n')
+            int len = value.size - pos < (1 << 30) ? (int)(value.size - pos) : (1 << 30);
+            if (!consume(value.data + pos, len))
             {
-                break;
+                return false;
             }
+            pos += len;
+        }
+        return true;
+    }
 
-            current += 1;         /*  跳过\n    */
-
-            if (current >= end)
+    std::vector<char> chunk(STREAM_CHUNK_LEN);
+    for (int64_t pos = 0; pos < value.size;)
+    {
+        int want = value.size - pos < STREAM_CHUNK_LEN ? (int)(value.size - pos) : STREAM_CHUNK_LEN;
+        int len = -1;
+        if (value.fd >= 0)
+        {
+#if defined PLATFORM_WINDOWS
+            len = _lseeki64(value.fd, value.offset + pos, SEEK_SET) < 0 ? -1 : _read(value.fd, &chunk[0], want);
+#else
+            len = (int)pread(value.fd, &chunk[0], want, (off_t)(value.offset + pos));
+            if (len < 0 && errno == ESPIPE)
             {
-                break;
+                /*  管道等不能定位的fd, 从当前位置顺序读取  */
+                len = (int)read(value.fd, &chunk[0], want);
             }
-            else if(*current == '\n')
+            if (len < 0 && errno == EINTR)
             {
-                /*  收到完整消息,ok  */
-                current += 1;         /*  跳过\n    */
-                return (int)(current - buffer);
+                continue;
             }
+#endif
+        }
+        else if (value.reader)
+        {
+            len = value.reader(&chunk[0], want);
         }
 
-        /*  非完整消息返回0  */
-        return 0;
-    }
-
-private:
-    vector<Bytes>   mBuffers;
-};
-
-static Status read_list(SSDBProtocolResponse *response, std::vector<std::string> *ret)
-{
-    Status status = response->getStatus();
-    if(status.ok())
-    {
-        for (size_t i = 1; i < response->getBuffersLen(); ++i)
+        if (len <= 0 || !consume(&chunk[0], len < want ? len : want))
         {
-            Bytes* buffer = response->getByIndex(i);
-			ret->push_back(std::string(buffer->buffer, buffer->len));
+            return false;
         }
+        pos += len < want ? len : want;
     }
-
-    return status;
-}
-
-static Status read_map(SSDBProtocolResponse *response, std::map<std::string, std::string> *ret)
-{
-	Status s = response->getStatus();
-	if (s.ok())
-	{
-		for (size_t i = 1; i < response->getBuffersLen(); i += 2)
-		{
-			Bytes *key = response->getByIndex(i);
-			Bytes *value = response->getByIndex(i+1);
-			ret->insert(std::make_pair(std::string(key->buffer, key->len), std::string(value->buffer, value->len)));
-		}
-	}
-	return s;
+    return true;
 }
 
-static Status read_int64(SSDBProtocolResponse *response, int64_t *ret)
+#if defined __linux__
+/*  把管道中的len字节转到fd, fd不支持splice时读出再写入  */
+static bool drain_pipe(int pipeFd, int fd, int len)
 {
-    Status status = response->getStatus();
-    if(status.ok())
+    while (len > 0)
     {
-        if(response->getBuffersLen() >= 2)
+        ssize_t ret = splice(pipeFd, NULL, fd, NULL, len, SPLICE_F_MOVE);
+        if (ret > 0)
         {
-            Bytes* buf = response->getByIndex(1);
-            string temp(buf->buffer, buf->len);
-            sscanf(temp.c_str(), "%lld",ret);
+            len -= (int)ret;
+            continue;
         }
-        else
+        if (ret < 0 && errno == EINTR)
         {
-            status = Status("server_error");
+            continue;
         }
-    }
-
-    return status;
-}
-
-static Status read_int(SSDBProtocolResponse *response, int *ret)
-{
-	Status s = response->getStatus();
-	if (s.ok())
-	{
-		if (response->getBuffersLen() >= 2)
-		{
-			Bytes* buf = response->getByIndex(1);
-			string temp(buf->buffer, buf->len);
-			sscanf(temp.c_str(), "%d", ret);
-		}
-		else
-		{
-			s = Status("server_error");
-		}
-	}
-	return s;
-}
-
-static Status read_str(SSDBProtocolResponse *response, std::string *ret)
-{
-    Status status = response->getStatus();
-    if(status.ok())
-    {
-        if(response->getBuffersLen() >= 2)
+        if (ret < 0 && errno == EAGAIN)
         {
-            Bytes* buf = response->getByIndex(1);
-            *ret = string(buf->buffer, buf->len);
+            struct pollfd pfd;
+            pfd.fd = fd;
+            pfd.events = POLLOUT;
+            pfd.revents = 0;
+            poll(&pfd, 1, -1);
+            continue;
         }
-        else
+        if (ret < 0 && errno == EINVAL)
         {
-            status = Status("server_error");
+            char chunk[16 * 1024];
+            while (len > 0)
+            {
+                ssize_t n = read(pipeFd, chunk, len < (int)sizeof(chunk) ? len : (int)sizeof(chunk));
+                if (n < 0 && errno == EINTR)
+                {
+                    continue;
+                }
+                if (n <= 0 || !write_fd(fd, chunk, (int)n))
+                {
+                    return false;
+                }
+                len -= (int)n;
+            }
+            return true;
         }
+        return false;
     }
-
-    return status;
-}
-
-void SSDBClient::request(const char* buffer, int len)
-{
-	if (!isconnected())
-	{
-		disconnect();
-		connect(m_ip.c_str(), m_port, m_timeout);
-	}
-    m_reponse->init();
-
-    int left_len = send(buffer, len);
-
-    /*  如果发送请求完毕，就进行接收response处理    */
-    if(len > 0 && left_len == 0)
-    {
-        recv();
-    }
-
-    m_request->init();
+    return true;
 }
+#endif
 
-int SSDBClient::send(const char* buffer, int len)
+int SSDBClient::recvPackets(int count, const SSDBPipelineVisitor& visitor)
 {
-    int left_len = len;
-    while(m_socket != SOCKET_ERROR && left_len > 0)
+    int done = 0;
+    while(done < count && recvMore())
     {
-        int sendret = ::send(m_socket, buffer+(len-left_len), left_len, 0);
-        if(sendret < 0)
+        /*  尝试解析,返回值大于0表示接受到完整的response消息包    */
+        int packetLen = 0;
+        while(done < count && (packetLen = SSDBProtocolResponse::check_ssdb_packet(ox_buffer_getreadptr(m_recvBuffer), ox_buffer_getreadvalidcount(m_recvBuffer))) > 0)
         {
-            if(sErrno != S_EINTR && sErrno != S_EWOULDBLOCK)
+            m_reponse->init();
+            m_reponse->parse(ox_buffer_getreadptr(m_recvBuffer), packetLen);
+            if(visitor)
             {
-                /*  链接断开    */
-                ox_socket_close(m_socket);
-                m_socket = SOCKET_ERROR;
-                break;
+                visitor(done, m_reponse);
             }
-        }
-        else
-        {
-            left_len -= sendret;
+            ox_buffer_addreadpos(m_recvBuffer, packetLen);
+            ++done;
         }
     }
 
-    return left_len;
+    return done;
 }
 
-void SSDBClient::recv()
+bool SSDBClient::recvMore()
 {
-    /*  重置读缓冲区  */
-    ox_buffer_init(m_recvBuffer);
     while(m_socket != SOCKET_ERROR)
     {
         if(ox_buffer_getwritevalidcount(m_recvBuffer) < 128)
         {
-            /*  扩大缓冲区   */
-            buffer_s* temp = ox_buffer_new(ox_buffer_getsize(m_recvBuffer) + 1024);
+            /*  先把未处理数据移动到头部, 空间仍不足再扩大缓冲区    */
+            ox_buffer_adjustto_head(m_recvBuffer);
+        }
+        if(ox_buffer_getwritevalidcount(m_recvBuffer) < 128)
+        {
+            /*  按倍数扩大缓冲区, 避免大response时反复拷贝   */
+            buffer_s* temp = ox_buffer_new(ox_buffer_getsize(m_recvBuffer) * 2);
             memcpy(ox_buffer_getwriteptr(temp), ox_buffer_getreadptr(m_recvBuffer), ox_buffer_getreadvalidcount(m_recvBuffer));
             ox_buffer_addwritepos(temp, ox_buffer_getreadvalidcount(m_recvBuffer));
             ox_buffer_delete(m_recvBuffer);
@@ -585,60 +390,611 @@ void SSDBClient::recv()
         {
             ox_socket_close(m_socket);
             m_socket = SOCKET_ERROR;
-            break;
+        }
+        else if(len == -1 && sErrno == S_EWOULDBLOCK)
+        {
+            if(!waitSocket(false))
+            {
+                return false;
+            }
         }
         else if(len > 0)
         {
             ox_buffer_addwritepos(m_recvBuffer, len);
-
-            /*  尝试解析,返回值大于0表示接受到完整的response消息包    */
-            if(SSDBProtocolResponse::check_ssdb_packet(ox_buffer_getreadptr(m_recvBuffer), ox_buffer_getreadvalidcount(m_recvBuffer)) > 0)
+#if defined __linux__
+            if(m_socketOptions.quickAck)
             {
-                m_reponse->parse(ox_buffer_getreadptr(m_recvBuffer), ox_buffer_getreadvalidcount(m_recvBuffer));
-                break;
+                ox_socket_quickack(m_socket);
             }
+#endif
+            return true;
         }
     }
+
+    return false;
 }
 
-SSDBClient::SSDBClient()
+Status SSDBClient::streamRequest(const SSDBValueSink& sink, int fd, int64_t *size)
 {
-    ox_socket_init();
-    m_reponse = new SSDBProtocolResponse;
-    m_request = new SSDBProtocolRequest;
-    m_socket = SOCKET_ERROR;
-    m_recvBuffer = ox_buffer_new(DEFAULT_SSDBPROTOCOL_LEN);
+    const char* buffer = m_request->getResult();
+    int len = m_request->getResultLen();
+    Status status("error");
+
+    if (m_transport != NULL)
+    {
+        request(buffer, len, true);
+        std::string value;
+        status = read_value(m_reponse, m_codec, &value);
+        if (status.ok())
+        {
+            if (size != NULL)
+            {
+                *size = (int64_t)value.size();
+            }
+            if (!deliver_value(value.c_str(), (int)value.size(), sink, fd))
+            {
+                status = Status("error");
+            }
+        }
+        return status;
+    }
+
+    beginRequest();
+    m_reponse->init();
+    capture(buffer, len, 1);
+    if (len > 0 && ensureConnected() && send(buffer, len) == 0)
+    {
+        status = recvStream(sink, fd, size);
+    }
+    endRequest();
+    m_request->init();
+
+    return requestStatus(status);
 }
 
-SSDBClient::~SSDBClient()
+Status SSDBClient::recvStream(const SSDBValueSink& sink, int fd, int64_t *size)
 {
-    if(m_socket != SOCKET_ERROR)
+    ox_buffer_init(m_recvBuffer);
+
+    int64_t valueLen = 0;
+    int header = 0;
+    while ((header = parse_stream_header(ox_buffer_getreadptr(m_recvBuffer), ox_buffer_getreadvalidcount(m_recvBuffer), &valueLen)) == 0)
     {
-        ox_socket_close(m_socket);
-        m_socket = SOCKET_ERROR;
+        if (!recvMore())
+        {
+            return Status("error");
+        }
     }
-    if(m_reponse != NULL)
+
+    if (header < 0)
     {
-        delete m_reponse;
-        m_reponse = NULL;
+        /*  not_found等没有value的response按普通方式解析   */
+        int packetLen = 0;
+        while ((packetLen = SSDBProtocolResponse::check_ssdb_packet(ox_buffer_getreadptr(m_recvBuffer), ox_buffer_getreadvalidcount(m_recvBuffer))) <= 0)
+        {
+            if (!recvMore())
+            {
+                return Status("error");
+            }
+        }
+        m_reponse->init();
+        m_reponse->parse(ox_buffer_getreadptr(m_recvBuffer), packetLen);
+        ox_buffer_addreadpos(m_recvBuffer, packetLen);
+        return m_reponse->getStatus();
     }
-    if (m_request != NULL)
+
+    if (valueLen < 0)
     {
-        delete m_request;
-        m_request = NULL;
+        disconnect();
+        return Status("error");
     }
-    if(m_recvBuffer != NULL)
+    if (size != NULL)
     {
-        ox_buffer_delete(m_recvBuffer);
-        m_recvBuffer = NULL;
+        *size = valueLen;
     }
 
-#if defined PLATFORM_WINDOWS
-    WSACleanup();
-#endif
-}
+    SSDBValueSink target = sink;
+    if (m_codec != NULL)
+    {
+        /*  解码后再交给sink/fd(不使用splice)   */
+        SSDBValueSink output = sink ? sink : SSDBValueSink([fd](const char* data, int len) {
+            return write_fd(fd, data, len);
+        });
+        m_codec->beginStream(valueLen);
+        target = [this, output](const char* data, int len) {
+            return m_codec->decodeStream(data, len, output);
+        };
+    }
 
-void SSDBClient::disconnect()
+    /*  已经收到的部分先交出, 其余直接从socket读取, 不再进入m_recvBuffer    */
+    ox_buffer_addreadpos(m_recvBuffer, header);
+    int buffered = ox_buffer_getreadvalidcount(m_recvBuffer);
+    buffered = buffered < valueLen ? buffered : (int)valueLen;
+    bool success = deliver_value(ox_buffer_getreadptr(m_recvBuffer), buffered, target, fd);
+    ox_buffer_addreadpos(m_recvBuffer, buffered);
+    if (success && valueLen > buffered)
+    {
+        success = recvValue(target, fd, valueLen - buffered);
+    }
+    if (!success)
+    {
+        /*  value没有读完, 连接不能继续使用  */
+        disconnect();
+        return Status("error");
+    }
+
+    /*  value之后是结束value的\n与结束response的空行  */
+    while (ox_buffer_getreadvalidcount(m_recvBuffer) < 2)
+    {
+        if (!recvMore())
+        {
+            return Status("error");
+        }
+    }
+    if (memcmp(ox_buffer_getreadptr(m_recvBuffer), "\n\n", 2) != 0)
+    {
+        disconnect();
+        return Status("error");
+    }
+    ox_buffer_addreadpos(m_recvBuffer, 2);
+
+    if (m_codec != NULL)
+    {
+        /*  value已完整读取, 连接仍可使用   */
+        int64_t decodedLen = m_codec->endStream();
+        if (decodedLen < 0)
+        {
+            return Status("error");
+        }
+        if (size != NULL)
+        {
+            *size = decodedLen;
+        }
+    }
+    return Status("ok");
+}
+
+bool SSDBClient::recvValue(const SSDBValueSink& sink, int fd, int64_t remaining)
+{
+#if defined __linux__
+    int pipeFd[2];
+    if (!sink && pipe2(pipeFd, O_CLOEXEC | O_NONBLOCK) == 0)
+    {
+        /*  socket -> 管道 -> fd, 数据不经过用户态  */
+        fcntl(pipeFd[1], F_SETPIPE_SZ, SPLICE_PIPE_LEN);
+        bool failed = false;
+        while (remaining > 0 && !failed)
+        {
+            size_t want = remaining < SPLICE_PIPE_LEN ? (size_t)remaining : (size_t)SPLICE_PIPE_LEN;
+            ssize_t len = splice(m_socket, NULL, pipeFd[1], NULL, want, SPLICE_F_MOVE | SPLICE_F_NONBLOCK);
+            if (len > 0)
+            {
+                remaining -= len;
+                failed = !drain_pipe(pipeFd[0], fd, (int)len);
+            }
+            else if (len < 0 && errno == EINTR)
+            {
+                continue;
+            }
+            else if (len < 0 && errno == EAGAIN)
+            {
+                failed = !waitSocket(false);
+            }
+            else if (len < 0 && (errno == EINVAL || errno == ENOSYS))
+            {
+                /*  不支持splice, 改为普通读写   */
+                break;
+            }
+            else
+            {
+                failed = true;
+            }
+        }
+        close(pipeFd[0]);
+        close(pipeFd[1]);
+        if (failed)
+        {
+            return false;
+        }
+    }
+#endif
+
+    std::vector<char> chunk(remaining > 0 ? STREAM_CHUNK_LEN : 0);
+    while (remaining > 0 && m_socket != SOCKET_ERROR)
+    {
+        int want = remaining < STREAM_CHUNK_LEN ? (int)remaining : STREAM_CHUNK_LEN;
+        int len = ::recv(m_socket, &chunk[0], want, 0);
+        if (len > 0)
+        {
+#if defined __linux__
+            if (m_socketOptions.quickAck)
+            {
+                ox_socket_quickack(m_socket);
+            }
+#endif
+            if (!deliver_value(&chunk[0], len, sink, fd))
+            {
+                return false;
+            }
+            remaining -= len;
+        }
+        else if (len == -1 && sErrno == S_EWOULDBLOCK)
+        {
+            if (!waitSocket(false))
+            {
+                return false;
+            }
+        }
+        else if (len == 0 || sErrno != S_EINTR)
+        {
+            return false;
+        }
+    }
+
+    return remaining == 0;
+}
+
+Status SSDBClient::streamUpload(const SSDBValueSource& value)
+{
+    char head[32];
+    int headLen = snprintf(head, sizeof(head), "%lld\n", (long long)value.size);
+    m_request->appendBlock(head, headLen);
+
+    if (m_transport != NULL)
+    {
+        /*  transport需要完整的请求 */
+        if (!read_source(value, [this](const char* data, int len) {
+            m_request->appendBlock(data, len);
+            return true;
+        }))
+        {
+            m_request->init();
+            return Status("error");
+        }
+        m_request->appendBlock("\n", 1);
+        m_request->endl();
+        request(m_request->getResult(), m_request->getResultLen());
+        return m_reponse->getStatus();
+    }
+
+    beginRequest();
+    m_reponse->init();
+    if (ensureConnected())
+    {
+        bool sent = false;
+#if !defined PLATFORM_WINDOWS
+        if (value.data != NULL)
+        {
+            /*  请求头, value与结尾一次writev发送, value不经过请求缓冲区 */
+            struct iovec iov[3];
+            iov[0].iov_base = (void*)m_request->getResult();
+            iov[0].iov_len = m_request->getResultLen();
+            iov[1].iov_base = (void*)value.data;
+            iov[1].iov_len = (size_t)value.size;
+            iov[2].iov_base = (void*)"\n\n";
+            iov[2].iov_len = 2;
+
+            int first = 0;
+            while (first < 3 && m_socket != SOCKET_ERROR)
+            {
+                ssize_t len = writev(m_socket, iov + first, 3 - first);
+                if (len < 0)
+                {
+                    if (errno == EAGAIN && !waitSocket(true))
+                    {
+                        break;
+                    }
+                    if (errno != EINTR && errno != EAGAIN)
+                    {
+                        break;
+                    }
+                    continue;
+                }
+                while (first < 3 && (size_t)len >= iov[first].iov_len)
+                {
+                    len -= iov[first].iov_len;
+                    ++first;
+                }
+                if (first < 3)
+                {
+                    iov[first].iov_base = (char*)iov[first].iov_base + len;
+                    iov[first].iov_len -= len;
+                }
+            }
+            sent = first == 3;
+        }
+        else
+#endif
+        {
+            sent = send(m_request->getResult(), m_request->getResultLen()) == 0 && sendValue(value) && send("\n\n", 2) == 0;
+        }
+
+        if (sent)
+        {
+            recv();
+        }
+        else
+        {
+            /*  请求只发送了一部分, 连接不能继续使用  */
+            disconnect();
+        }
+    }
+    endRequest();
+    m_request->init();
+
+    return requestStatus(m_reponse->getStatus());
+}
+
+bool SSDBClient::sendValue(const SSDBValueSource& value)
+{
+    SSDBValueSource rest = value;
+#if defined __linux__
+    if (value.data == NULL && value.fd >= 0)
+    {
+        /*  文件内容由内核直接发送  */
+        off_t offset = (off_t)value.offset;
+        int64_t remaining = value.size;
+        bool fallback = false;
+        while (remaining > 0 && m_socket != SOCKET_ERROR && !fallback)
+        {
+            ssize_t len = sendfile(m_socket, value.fd, &offset, remaining < (1 << 30) ? (size_t)remaining : (size_t)(1 << 30));
+            if (len > 0)
+            {
+                remaining -= len;
+            }
+            else if (len < 0 && errno == EAGAIN)
+            {
+                if (!waitSocket(true))
+                {
+                    return false;
+                }
+            }
+            else if (len < 0 && (errno == EINVAL || errno == ENOSYS || errno == ESPIPE))
+            {
+                /*  fd不支持sendfile(例如管道), 改为读出再发送    */
+                fallback = true;
+            }
+            else if (len == 0 || errno != EINTR)
+            {
+                disconnect();
+                return false;
+            }
+        }
+        if (!fallback)
+        {
+            return remaining == 0 && m_socket != SOCKET_ERROR;
+        }
+        rest.offset = offset;
+        rest.size = remaining;
+    }
+#endif
+
+    /*  分块缓冲区在下一块读取时被覆盖, 不能以MSG_ZEROCOPY发送   */
+    if (!read_source(rest, [this](const char* data, int len) {
+        return send(data, len, false) == 0;
+    }))
+    {
+        disconnect();
+        return false;
+    }
+    return true;
+}
+
+int SSDBClient::pipeline(const char* buffer, int len, int count, const SSDBPipelineVisitor& visitor)
+{
+    if (m_transport != NULL)
+    {
+        m_reponse->init();
+        capture(buffer, len, count);
+        int done = transportRequest(buffer, len, count, visitor);
+        m_request->init();
+        return done;
+    }
+
+    beginRequest();
+    m_reponse->init();
+    capture(buffer, len, count);
+
+    int done = 0;
+    if(len > 0 && ensureConnected() && send(buffer, len, true) == 0)
+    {
+        ox_buffer_init(m_recvBuffer);
+        done = recvPackets(count, visitor);
+    }
+
+    endRequest();
+    m_request->init();
+    return done;
+}
+
+int SSDBClient::transportRequest(const char* buffer, int len, int count, const SSDBPipelineVisitor& visitor)
+{
+    /*  上一次的response缓冲区被transport替换为共享的缓冲区时, 其他线程可能仍在读取, 重新分配  */
+    if (!m_transportReply || m_transportReplyShared)
+    {
+        m_transportReply = std::make_shared<std::string>();
+    }
+    m_transportReply->clear();
+
+    std::string* own = m_transportReply.get();
+    bool success = len > 0 && m_transport->request(buffer, len, count, m_transportReply);
+    m_transportReplyShared = m_transportReply.get() != own;
+    if (!success)
+    {
+        return 0;
+    }
+
+    const char* current = m_transportReply->c_str();
+    int left = (int)m_transportReply->size();
+    int done = 0;
+    int packetLen = 0;
+    while (done < count && (packetLen = SSDBProtocolResponse::check_ssdb_packet(current, left)) > 0)
+    {
+        m_reponse->init();
+        m_reponse->parse(current, packetLen);
+        if (visitor)
+        {
+            visitor(done, m_reponse);
+        }
+        current += packetLen;
+        left -= packetLen;
+        ++done;
+    }
+
+    return done;
+}
+
+void SSDBClient::startCapture(SSDBTrafficLog* log)
+{
+    flushCapture();
+    m_captureLog = log;
+    if(m_captureLog != NULL && m_captureBuffer == NULL)
+    {
+        m_captureBuffer = ox_buffer_new(CAPTURE_BUFFER_LEN);
+    }
+}
+
+void SSDBClient::stopCapture()
+{
+    flushCapture();
+    m_captureLog = NULL;
+}
+
+void SSDBClient::capture(const char* buffer, int len, int count)
+{
+    if(m_captureLog == NULL || len <= 0)
+    {
+        return;
+    }
+
+    /*  记录: 时间戳 + 长度 + 命令个数 + 请求数据, 先写入本client的缓冲区   */
+    char head[SSDB_CAPTURE_RECORD_HEAD_LEN];
+    int64_t now = SSDBTrafficLog::now();
+    memcpy(head, &now, sizeof(now));
+    memcpy(head + sizeof(now), &len, sizeof(len));
+    memcpy(head + sizeof(now) + sizeof(len), &count, sizeof(count));
+
+    if(ox_buffer_getwritevalidcount(m_captureBuffer) < SSDB_CAPTURE_RECORD_HEAD_LEN + len)
+    {
+        flushCapture();
+    }
+    if(ox_buffer_getwritevalidcount(m_captureBuffer) < SSDB_CAPTURE_RECORD_HEAD_LEN + len)
+    {
+        /*  超大请求直接写入日志   */
+        std::string record(head, SSDB_CAPTURE_RECORD_HEAD_LEN);
+        record.append(buffer, len);
+        m_captureLog->append(record.c_str(), (int)record.size());
+        return;
+    }
+
+    ox_buffer_write(m_captureBuffer, head, SSDB_CAPTURE_RECORD_HEAD_LEN);
+    ox_buffer_write(m_captureBuffer, buffer, len);
+}
+
+void SSDBClient::flushCapture()
+{
+    if(m_captureLog != NULL && m_captureBuffer != NULL && ox_buffer_getreadvalidcount(m_captureBuffer) > 0)
+    {
+        m_captureLog->append(ox_buffer_getreadptr(m_captureBuffer), ox_buffer_getreadvalidcount(m_captureBuffer));
+        ox_buffer_init(m_captureBuffer);
+    }
+}
+
+SSDBClient::SSDBClient()
+{
+    init();
+}
+
+SSDBClient::SSDBClient(SSDBTransport* transport)
+{
+    init();
+    m_transport = transport;
+}
+
+void SSDBClient::init()
+{
+    ox_socket_init();
+    m_reponse = new SSDBProtocolResponse;
+    m_request = new SSDBProtocolRequest;
+    m_socket = SOCKET_ERROR;
+    m_recvBuffer = ox_buffer_new(DEFAULT_SSDBPROTOCOL_LEN);
+    m_port = 0;
+    m_timeout = 5;
+    m_transport = NULL;
+    m_transportReplyShared = false;
+    m_captureLog = NULL;
+    m_captureBuffer = NULL;
+    m_requestTimeout = 0;
+    m_deadline = 0;
+    m_timedout = false;
+    m_connectFailures = 0;
+    m_retryAt = 0;
+    m_random = (uint64_t)now_us() ^ (uint64_t)(uintptr_t)this;
+    m_random = m_random != 0 ? m_random : 1;
+    m_unavailable = false;
+    m_zerocopy = false;
+    m_zerocopyPending = 0;
+    m_codec = NULL;
+    setChunkPolicy(SSDBChunkPolicy());
+}
+
+SSDBSocketOptions SSDBSocketOptions::throughput()
+{
+    SSDBSocketOptions options;
+    options.sendBufferSize = 4 * 1024 * 1024;
+    options.recvBufferSize = 4 * 1024 * 1024;
+    options.zerocopyThreshold = 64 * 1024;
+    return options;
+}
+
+SSDBSocketOptions SSDBSocketOptions::lowLatency()
+{
+    SSDBSocketOptions options;
+    options.busyPollUs = 50;
+    options.quickAck = true;
+    return options;
+}
+
+SSDBClient::~SSDBClient()
+{
+    stopCapture();
+    if(m_captureBuffer != NULL)
+    {
+        ox_buffer_delete(m_captureBuffer);
+        m_captureBuffer = NULL;
+    }
+    if(m_socket != SOCKET_ERROR)
+    {
+        ox_socket_close(m_socket);
+        m_socket = SOCKET_ERROR;
+    }
+    if(m_reponse != NULL)
+    {
+        delete m_reponse;
+        m_reponse = NULL;
+    }
+    if (m_request != NULL)
+    {
+        delete m_request;
+        m_request = NULL;
+    }
+    if (m_codec != NULL)
+    {
+        delete m_codec;
+        m_codec = NULL;
+    }
+    if(m_recvBuffer != NULL)
+    {
+        ox_buffer_delete(m_recvBuffer);
+        m_recvBuffer = NULL;
+    }
+
+#if defined PLATFORM_WINDOWS
+    WSACleanup();
+#endif
+}
+
+void SSDBClient::disconnect()
 {
     if (m_socket != SOCKET_ERROR)
     {
@@ -649,24 +1005,452 @@ void SSDBClient::disconnect()
 
 void SSDBClient::connect(const char* ip, int port, uint32_t timeoutSec)
 {
-    if(m_socket == SOCKET_ERROR)
+    if(m_socket == SOCKET_ERROR)
+    {
+        setupSocket((int)ox_socket_connect(ip, port, timeoutSec));
+        onConnectResult(m_socket != SOCKET_ERROR);
+
+        m_ip = ip;
+        m_port = port;
+		m_timeout = timeoutSec;
+    }
+}
+
+int SSDBClient::connectAll(SSDBClient** clients, int count, const char* ip, int port, uint32_t timeoutSec)
+{
+    std::vector<SSDBClient*> pending;
+    for (int i = 0; i < count; ++i)
+    {
+        clients[i]->m_ip = ip;
+        clients[i]->m_port = port;
+        clients[i]->m_timeout = timeoutSec;
+        if (clients[i]->m_socket == SOCKET_ERROR)
+        {
+            pending.push_back(clients[i]);
+        }
+    }
+    if (pending.empty())
+    {
+        return count;
+    }
+
+    std::vector<sock> fds(pending.size(), SOCKET_ERROR);
+    ox_socket_connect_all(ip, port, (int)fds.size(), &fds[0], timeoutSec);
+    for (size_t i = 0; i < pending.size(); ++i)
+    {
+        pending[i]->setupSocket((int)fds[i]);
+        pending[i]->onConnectResult(fds[i] != SOCKET_ERROR);
+    }
+
+    int connected = 0;
+    for (int i = 0; i < count; ++i)
+    {
+        connected += clients[i]->m_socket != SOCKET_ERROR ? 1 : 0;
+    }
+    return connected;
+}
+
+void SSDBClient::setupSocket(int fd)
+{
+    m_socket = fd;
+    m_zerocopy = false;
+    m_zerocopyPending = 0;
+    if(m_socket != SOCKET_ERROR)
+    {
+        applySocketOptions();
+        /*  收发使用非阻塞socket + poll, 以支持请求级别的超时    */
+        ox_socket_set_block(m_socket, false);
+    }
+}
+
+void SSDBClient::applySocketOptions()
+{
+    const SSDBSocketOptions& options = m_socketOptions;
+    if (options.noDelay)
+    {
+        ox_socket_nodelay(m_socket);
+    }
+    if (options.keepAliveIdle > 0)
+    {
+        ox_socket_keepalive(m_socket, options.keepAliveIdle, options.keepAliveInterval, options.keepAliveProbes);
+    }
+    ox_socket_set_buffer_size(m_socket, options.sendBufferSize, options.recvBufferSize);
+#if defined __linux__
+    if (options.busyPollUs > 0)
+    {
+        ox_socket_busy_poll(m_socket, options.busyPollUs);
+    }
+    if (options.incomingCpu >= 0)
+    {
+        ox_socket_incoming_cpu(m_socket, options.incomingCpu);
+    }
+    m_zerocopy = options.zerocopyThreshold > 0 && ox_socket_enable_zerocopy(m_socket);
+#endif
+}
+
+int SSDBClient::drainZerocopy()
+{
+    int completed = 0;
+#if defined __linux__
+    bool copied = false;
+    completed = ox_socket_drain_zerocopy(m_socket, &copied);
+    m_zerocopyPending -= completed < m_zerocopyPending ? completed : m_zerocopyPending;
+    if (copied)
+    {
+        /*  内核仍然做了拷贝, 零拷贝只会额外增加通知开销    */
+        m_zerocopy = false;
+    }
+#endif
+    return completed;
+}
+
+bool SSDBClient::attach(int fd, uint32_t timeoutSec)
+{
+    disconnect();
+    if (fd == SOCKET_ERROR || !ox_socket_set_timeout(fd, timeoutSec))
+    {
+        return false;
+    }
+
+    setupSocket(fd);
+    m_ip.clear();
+    m_port = 0;
+    m_timeout = timeoutSec;
+    return true;
+}
+
+bool SSDBClient::isconnected() const
+{
+    if (m_transport != NULL)
+    {
+        return m_transport->isconnected();
+    }
+    return m_socket != SOCKET_ERROR;
+}
+
+void SSDBClient::setRequestTimeout(int64_t timeoutUs)
+{
+    m_requestTimeout = timeoutUs > 0 ? timeoutUs : 0;
+}
+
+void SSDBClient::setReconnectPolicy(const SSDBReconnectPolicy& policy)
+{
+    m_reconnectPolicy = policy;
+}
+
+bool SSDBClient::ensureConnected()
+{
+    if (isconnected())
+    {
+        return true;
+    }
+    if (m_ip.empty())
+    {
+        return false;
+    }
+    if (m_connectFailures > 0 && now_us() < m_retryAt)
+    {
+        m_unavailable = true;
+        return false;
+    }
+
+    /*  重连同样受本次请求的deadline限制   */
+    int64_t timeoutMs = (int64_t)m_timeout * 1000;
+    if (m_deadline > 0)
+    {
+        int64_t left = m_deadline - now_us();
+        if (left <= 0)
+        {
+            m_timedout = true;
+            return false;
+        }
+        timeoutMs = (left + 999) / 1000 < timeoutMs ? (left + 999) / 1000 : timeoutMs;
+    }
+
+    setupSocket((int)ox_socket_connect_ms(m_ip.c_str(), m_port, timeoutMs, m_timeout));
+    if (m_socket == SOCKET_ERROR && m_deadline > 0 && now_us() >= m_deadline)
+    {
+        /*  请求的剩余时间内没有连上, 不计入连接失败(不触发退避)   */
+        m_timedout = true;
+        return false;
+    }
+    onConnectResult(m_socket != SOCKET_ERROR);
+    return isconnected();
+}
+
+void SSDBClient::onConnectResult(bool connected)
+{
+    if (connected)
+    {
+        m_connectFailures = 0;
+        m_retryAt = 0;
+        return;
+    }
+
+    ++m_connectFailures;
+    int shift = m_connectFailures - 1 < 20 ? m_connectFailures - 1 : 20;
+    int64_t backoff = m_reconnectPolicy.minBackoffMs << shift;
+    if (backoff > m_reconnectPolicy.maxBackoffMs || backoff <= 0)
+    {
+        backoff = m_reconnectPolicy.maxBackoffMs;
+    }
+
+    /*  xorshift, 在[backoff/2, backoff]之间随机   */
+    m_random ^= m_random << 13;
+    m_random ^= m_random >> 7;
+    m_random ^= m_random << 17;
+    int64_t half = backoff / 2;
+    int64_t delayMs = half + (int64_t)(m_random % (uint64_t)(half + 1));
+    m_retryAt = now_us() + delayMs * 1000;
+}
+
+void SSDBClient::setSocketOptions(const SSDBSocketOptions& options)
+{
+    m_socketOptions = options;
+    if (m_socket != SOCKET_ERROR)
+    {
+        applySocketOptions();
+    }
+}
+
+void SSDBClient::beginRequest()
+{
+    m_timedout = false;
+    m_unavailable = false;
+    m_deadline = m_requestTimeout > 0 ? now_us() + m_requestTimeout : 0;
+}
+
+Status SSDBClient::requestStatus(const Status& status) const
+{
+    if (m_timedout)
+    {
+        return Status("timeout");
+    }
+    if (m_unavailable)
+    {
+        return Status("unavailable");
+    }
+    return status;
+}
+
+void SSDBClient::endRequest()
+{
+    if (m_timedout)
+    {
+        m_reponse->setError("timeout");
+    }
+    else if (m_unavailable)
+    {
+        m_reponse->setError("unavailable");
+    }
+    if (m_zerocopyPending > 0 && m_socket != SOCKET_ERROR)
+    {
+        drainZerocopy();
+    }
+    m_deadline = 0;
+}
+
+bool SSDBClient::waitSocket(bool write)
+{
+    while (m_socket != SOCKET_ERROR)
+    {
+        int64_t left = -1;
+        if (m_deadline > 0)
+        {
+            left = m_deadline - now_us();
+            if (left <= 0)
+            {
+                /*  超时请求的response可能稍后到达, 连接不能继续使用  */
+                m_timedout = true;
+                disconnect();
+                return false;
+            }
+        }
+
+        struct pollfd pfd;
+        pfd.fd = m_socket;
+        pfd.events = write ? POLLOUT : POLLIN;
+        pfd.revents = 0;
+#if defined PLATFORM_WINDOWS
+        int ret = WSAPoll(&pfd, 1, left < 0 ? -1 : (int)((left + 999) / 1000));
+#elif defined __linux__
+        struct timespec ts;
+        ts.tv_sec = left / 1000000;
+        ts.tv_nsec = (left % 1000000) * 1000;
+        int ret = ppoll(&pfd, 1, left < 0 ? NULL : &ts, NULL);
+#else
+        int ret = poll(&pfd, 1, left < 0 ? -1 : (int)((left + 999) / 1000));
+#endif
+        if (ret > 0)
+        {
+            /*  错误队列中的零拷贝完成通知同样使poll返回POLLERR  */
+            if ((pfd.revents & POLLERR) && m_zerocopyPending > 0 && drainZerocopy() > 0 && (pfd.revents & pfd.events) == 0)
+            {
+                continue;
+            }
+            return true;
+        }
+        if (ret < 0 && sErrno != S_EINTR)
+        {
+            disconnect();
+            return false;
+        }
+    }
+
+    return false;
+}
+
+SSDBValueSource SSDBValueSource::memory(const char* data, int64_t size)
+{
+    SSDBValueSource source;
+    source.data = data;
+    source.size = size;
+    return source;
+}
+
+SSDBValueSource SSDBValueSource::file(int fd, int64_t offset, int64_t size)
+{
+    SSDBValueSource source;
+    source.fd = fd;
+    source.offset = offset;
+    source.size = size;
+    if (size < 0)
+    {
+#if defined PLATFORM_WINDOWS
+        struct _stati64 st;
+        source.size = _fstati64(fd, &st) == 0 ? st.st_size - offset : 0;
+#else
+        struct stat st;
+        source.size = fstat(fd, &st) == 0 ? st.st_size - offset : 0;
+#endif
+        source.size = source.size > 0 ? source.size : 0;
+    }
+    return source;
+}
+
+SSDBValueSource SSDBValueSource::callback(int64_t size, const Reader& reader)
+{
+    SSDBValueSource source;
+    source.size = size;
+    source.reader = reader;
+    return source;
+}
+
+void SSDBClient::setChunkPolicy(const SSDBChunkPolicy& policy)
+{
+    m_chunkPolicy = policy;
+    m_chunkKeys = policy.initialKeys;
+    m_chunkKeys = m_chunkKeys < policy.minKeys ? policy.minKeys : m_chunkKeys;
+    m_chunkKeys = m_chunkKeys > policy.maxKeys ? policy.maxKeys : m_chunkKeys;
+    m_chunkKeys = m_chunkKeys > 0 ? m_chunkKeys : 1;
+}
+
+void SSDBClient::setCompression(const SSDBCompressionOptions& options)
+{
+    if (m_codec == NULL)
+    {
+        m_codec = new SSDBValueCodec;
+    }
+    m_codec->setOptions(options);
+}
+
+int SSDBClient::appendValue(const std::string& val)
+{
+    const char* data = val.data();
+    int len = (int)val.size();
+    if (m_codec != NULL)
+    {
+        m_codec->encode(data, len, &data, &len);
+    }
+    m_request->append(data, len);
+    return len;
+}
+
+Status SSDBClient::multiRequest(const char* cmd, const std::string* name, size_t count, int64_t encodedBytes,
+                                const std::function<int()>& appendNext, const SSDBPipelineVisitor& visitor)
+{
+    /*  每块的命令头长度    */
+    int headLen = SSDBProtocolRequest::encodedLen((int)strlen(cmd)) + (name != NULL ? SSDBProtocolRequest::encodedLen((int)name->size()) : 0) + 1;
+    int64_t window = (int64_t)m_chunkPolicy.pipelineDepth * m_chunkPolicy.maxBytes;
+
+    Status result("ok");
+    size_t next = 0;
+    do
     {
-        m_socket = (int)ox_socket_connect(ip, port, timeoutSec);
-        if(m_socket != SOCKET_ERROR)
+        /*  按剩余元素的编码长度预留整个窗口, 编码过程中不再扩容    */
+        int64_t reserved = encodedBytes < window ? encodedBytes : window;
+        m_request->reserve((int)reserved + headLen * m_chunkPolicy.pipelineDepth);
+        int startLen = m_request->getResultLen();
+
+        /*  编码一个窗口(最多pipelineDepth块)  */
+        int chunks = 0;
+        bool keyBound = false;
+        while (chunks < m_chunkPolicy.pipelineDepth || chunks == 0)
         {
-            ox_socket_nodelay(m_socket);
-			ox_socket_keepalive(m_socket, KEEP_ALIVE_TIMEOUT, KEEP_ALIVE_INTERVAL, KEEP_ALIVE_PROBES);
+            m_request->appendStr(cmd);
+            if (name != NULL)
+            {
+                m_request->appendStr(*name);
+            }
+            int keys = 0;
+            int bytes = 0;
+            while (next < count && keys < m_chunkKeys && bytes < m_chunkPolicy.maxBytes)
+            {
+                bytes += appendNext();
+                ++keys;
+                ++next;
+            }
+            m_request->endl();
+            keyBound = keyBound || keys == m_chunkKeys;
+            ++chunks;
+
+            if (next >= count)
+            {
+                break;
+            }
         }
 
-        m_ip = ip;
-        m_port = port;
-		m_timeout = timeoutSec;
-    }
-}
+        encodedBytes -= m_request->getResultLen() - startLen;
 
-bool SSDBClient::isconnected() const
-{
-    return m_socket != SOCKET_ERROR;
+        /*  整个窗口以chunks个命令的pipeline发送, 录制时为一条带命令个数的记录, 回放时按块数接收response    */
+        bool failed = false;
+        int64_t start = now_us();
+        int done = pipeline(m_request->getResult(), m_request->getResultLen(), chunks, [&](int index, SSDBProtocolResponse* response) {
+            Status status = response->getStatus();
+            if (!status.ok() && !failed)
+            {
+                result = status;
+                failed = true;
+            }
+            if (visitor)
+            {
+                visitor(index, response);
+            }
+        });
+        if (done < chunks)
+        {
+            return requestStatus(Status("error"));
+        }
+        if (failed)
+        {
+            return result;
+        }
+
+        /*  按单块耗时调整块大小    */
+        int64_t perChunk = (now_us() - start) / chunks;
+        if (perChunk > m_chunkPolicy.targetLatencyUs)
+        {
+            m_chunkKeys = m_chunkKeys / 2 > m_chunkPolicy.minKeys ? m_chunkKeys / 2 : m_chunkPolicy.minKeys;
+        }
+        else if (keyBound && perChunk < m_chunkPolicy.targetLatencyUs / 2)
+        {
+            int grown = m_chunkKeys + (m_chunkKeys + 3) / 4;
+            m_chunkKeys = grown < m_chunkPolicy.maxKeys ? grown : m_chunkPolicy.maxKeys;
+        }
+        m_chunkKeys = m_chunkKeys > 0 ? m_chunkKeys : 1;
+    } while (next < count);
+
+    return result;
 }
 
 void SSDBClient::execute(const char* str, int len)
@@ -674,22 +1458,35 @@ void SSDBClient::execute(const char* str, int len)
     request(str, len);
 }
 
+SSDBProtocolResponse* SSDBClient::commandRequest()
+{
+    request(m_request->getResult(), m_request->getResultLen());
+    return m_reponse;
+}
+
 Status SSDBClient::set(const std::string& key, const std::string& val)
 {
     m_request->appendStr("set");
     m_request->appendStr(key);
-    m_request->appendStr(val);
+    appendValue(val);
     m_request->endl();
 
-    request(m_request->getResult(), m_request->getResultLen());
+    request(m_request->getResult(), m_request->getResultLen(), true);
     return m_reponse->getStatus();
 }
 
+Status SSDBClient::set(const std::string& key, const SSDBValueSource& val)
+{
+    m_request->appendStr("set");
+    m_request->appendStr(key);
+    return streamUpload(val);
+}
+
 Status SSDBClient::setx(const std::string& key, const std::string& val, int ttl)
 {
 	m_request->appendStr("setx");
 	m_request->appendStr(key);
-	m_request->appendStr(val);
+	appendValue(val);
 	m_request->appendInt32(ttl);
 	m_request->endl();
 
@@ -701,7 +1498,7 @@ Status SSDBClient::setnx(const std::string& key, const std::string& val, int *re
 {
 	m_request->appendStr("setnx");
 	m_request->appendStr(key);
-	m_request->appendStr(val);
+	appendValue(val);
 	m_request->endl();
 	request(m_request->getResult(), m_request->getResultLen());
 	return read_int(m_reponse, reply);
@@ -713,9 +1510,27 @@ Status SSDBClient::get(const std::string& key, std::string *val)
     m_request->appendStr(key);
     m_request->endl();
 
-    request(m_request->getResult(), m_request->getResultLen());
+    request(m_request->getResult(), m_request->getResultLen(), true);
+
+    return read_value(m_reponse, m_codec, val);
+}
+
+Status SSDBClient::get_stream(const std::string& key, const SSDBValueSink& sink, int64_t *size)
+{
+    m_request->appendStr("get");
+    m_request->appendStr(key);
+    m_request->endl();
+
+    return streamRequest(sink, -1, size);
+}
+
+Status SSDBClient::get_to_fd(const std::string& key, int fd, int64_t *size)
+{
+    m_request->appendStr("get");
+    m_request->appendStr(key);
+    m_request->endl();
 
-    return read_str(m_reponse, val);
+    return streamRequest(SSDBValueSink(), fd, size);
 }
 
 Status SSDBClient::del(const std::string& key)
@@ -731,39 +1546,39 @@ Status SSDBClient::del(const std::string& key)
 
 Status SSDBClient::multi_get(const std::vector<std::string>& keys, std::map<std::string, std::string> *ret)
 {
-	m_request->appendStr("multi_get");
-	for (size_t i = 0; i < keys.size(); i++)
-	{
-		m_request->appendStr(keys[i]);
-	}
-	m_request->endl();
-	request(m_request->getResult(), m_request->getResultLen());
-	return read_map(m_reponse, ret);
+    size_t next = 0;
+    Status decoded("ok");
+    Status status = multiRequest("multi_get", NULL, keys.size(), encoded_size(keys), [&]() {
+        m_request->appendStr(keys[next]);
+        return (int)keys[next++].size();
+    }, [this, ret, &decoded](int, SSDBProtocolResponse* response) {
+        Status status = read_values(response, m_codec, ret);
+        if (!status.ok())
+        {
+            decoded = status;
+        }
+    });
+    return status.ok() ? decoded : status;
 }
 
 Status SSDBClient::multi_set(const std::map<std::string, std::string>& kvs)
 {
-	m_request->appendStr("multi_set");
-	for (std::map<std::string, std::string>::const_iterator iter = kvs.begin(); iter != kvs.end(); ++iter)
-	{
-		m_request->appendStr(iter->first);
-		m_request->appendStr(iter->second);
-	}
-	m_request->endl();
-	request(m_request->getResult(), m_request->getResultLen());
-	return m_reponse->getStatus();
+    std::map<std::string, std::string>::const_iterator iter = kvs.begin();
+    return multiRequest("multi_set", NULL, kvs.size(), encoded_size(kvs), [&]() {
+        m_request->appendStr(iter->first);
+        int len = (int)iter->first.size() + appendValue(iter->second);
+        ++iter;
+        return len;
+    }, SSDBPipelineVisitor());
 }
 
 Status SSDBClient::multi_del(const std::vector<std::string>& keys)
 {
-	m_request->appendStr("multi_del");
-	for (size_t i = 0; i < keys.size(); i++)
-	{
-		m_request->appendStr(keys[i]);
-	}
-	m_request->endl();
-	request(m_request->getResult(), m_request->getResultLen());
-	return m_reponse->getStatus();
+    size_t next = 0;
+    return multiRequest("multi_del", NULL, keys.size(), encoded_size(keys), [&]() {
+        m_request->appendStr(keys[next]);
+        return (int)keys[next++].size();
+    }, SSDBPipelineVisitor());
 }
 
 Status SSDBClient::expire(const std::string& key, int ttl)
@@ -780,16 +1595,29 @@ Status SSDBClient::exists(const std::string& key, int *ret)
 	m_request->appendStr("exists");
 	m_request->appendStr(key);
 	m_request->endl();
-	request(m_request->getResult(), m_request->getResultLen());
+	request(m_request->getResult(), m_request->getResultLen(), true);
 	return read_int(m_reponse, ret);
 }
 
-Status SSDBClient::hset(const std::string& name, const std::string& key, std::string val)
+Status SSDBClient::incr(const std::string& key, int64_t by, int64_t *newVal)
+{
+    m_request->appendStr("incr");
+    m_request->appendStr(key);
+    m_request->appendInt64(by);
+    m_request->endl();
+
+    request(m_request->getResult(), m_request->getResultLen());
+
+    int64_t val = 0;
+    return read_int64(m_reponse, newVal != NULL ? newVal : &val);
+}
+
+Status SSDBClient::hset(const std::string& name, const std::string& key, const std::string& val)
 {
     m_request->appendStr("hset");
     m_request->appendStr(name);
     m_request->appendStr(key);
-    m_request->appendStr(val);
+    appendValue(val);
     m_request->endl();
 
     request(m_request->getResult(), m_request->getResultLen());
@@ -797,47 +1625,197 @@ Status SSDBClient::hset(const std::string& name, const std::string& key, std::st
     return m_reponse->getStatus();
 }
 
-Status SSDBClient::multi_hset(const std::string& name, const std::map<std::string, std::string> &kvs)
+Status SSDBClient::hset(const std::string& name, const std::string& key, const SSDBValueSource& val)
 {
-    m_request->appendStr("multi_hset");
+    m_request->appendStr("hset");
     m_request->appendStr(name);
-	for (std::map<std::string, std::string>::const_iterator iter = kvs.begin(); iter != kvs.end(); ++iter)
-    {
+    m_request->appendStr(key);
+    return streamUpload(val);
+}
+
+Status SSDBClient::multi_hset(const std::string& name, const std::map<std::string, std::string> &kvs)
+{
+    std::map<std::string, std::string>::const_iterator iter = kvs.begin();
+    return multiRequest("multi_hset", &name, kvs.size(), encoded_size(kvs), [&]() {
         m_request->appendStr(iter->first);
-        m_request->appendStr(iter->second);
-    }
+        int len = (int)iter->first.size() + appendValue(iter->second);
+        ++iter;
+        return len;
+    }, SSDBPipelineVisitor());
+}
+
+Status SSDBClient::hget(const std::string& name, const std::string& key, std::string *val)
+{
+    m_request->appendStr("hget");
+    m_request->appendStr(name);
+    m_request->appendStr(key);
     m_request->endl();
 
-    request(m_request->getResult(), m_request->getResultLen());
+    request(m_request->getResult(), m_request->getResultLen(), true);
 
-    return m_reponse->getStatus();
+    return read_value(m_reponse, m_codec, val);
 }
 
-Status SSDBClient::hget(const std::string& name, const std::string& key, std::string *val)
+Status SSDBClient::hget_stream(const std::string& name, const std::string& key, const SSDBValueSink& sink, int64_t *size)
 {
     m_request->appendStr("hget");
     m_request->appendStr(name);
     m_request->appendStr(key);
     m_request->endl();
 
+    return streamRequest(sink, -1, size);
+}
+
+Status SSDBClient::hget_to_fd(const std::string& name, const std::string& key, int fd, int64_t *size)
+{
+    m_request->appendStr("hget");
+    m_request->appendStr(name);
+    m_request->appendStr(key);
+    m_request->endl();
+
+    return streamRequest(SSDBValueSink(), fd, size);
+}
+
+Status SSDBClient::hincr(const std::string& name, const std::string& key, int64_t by, int64_t *newVal)
+{
+    m_request->appendStr("hincr");
+    m_request->appendStr(name);
+    m_request->appendStr(key);
+    m_request->appendInt64(by);
+    m_request->endl();
+
     request(m_request->getResult(), m_request->getResultLen());
 
-    return read_str(m_reponse, val);
+    int64_t val = 0;
+    return read_int64(m_reponse, newVal != NULL ? newVal : &val);
 }
 
 Status SSDBClient::multi_hget(const std::string& name, const std::vector<std::string> &keys, std::map<std::string, std::string> *ret)
 {
-    m_request->appendStr("multi_hget");
+    size_t next = 0;
+    Status decoded("ok");
+    Status status = multiRequest("multi_hget", &name, keys.size(), encoded_size(keys), [&]() {
+        m_request->appendStr(keys[next]);
+        return (int)keys[next++].size();
+    }, [this, ret, &decoded](int, SSDBProtocolResponse* response) {
+        Status status = read_values(response, m_codec, ret);
+        if (!status.ok())
+        {
+            decoded = status;
+        }
+    });
+    return status.ok() ? decoded : status;
+}
+
+Status SSDBClient::hdel(const std::string& name, const std::string& key)
+{
+    m_request->appendStr("hdel");
+    m_request->appendStr(name);
+    m_request->appendStr(key);
+    m_request->endl();
+
+    request(m_request->getResult(), m_request->getResultLen(), true);
+    return m_reponse->getStatus();
+}
+
+Status SSDBClient::multi_hdel(const std::string& name, const std::vector<std::string>& keys)
+{
+    size_t next = 0;
+    return multiRequest("multi_hdel", &name, keys.size(), encoded_size(keys), [&]() {
+        m_request->appendStr(keys[next]);
+        return (int)keys[next++].size();
+    }, SSDBPipelineVisitor());
+}
+
+Status SSDBClient::hsize(const std::string& name, int64_t *size)
+{
+    m_request->appendStr("hsize");
+    m_request->appendStr(name);
+    m_request->endl();
+
+    request(m_request->getResult(), m_request->getResultLen(), true);
+
+    return read_int64(m_reponse, size);
+}
+
+Status SSDBClient::hclear(const std::string& name)
+{
+    m_request->appendStr("hclear");
     m_request->appendStr(name);
-    for (size_t i = 0; i < keys.size(); i++)
-    {
-        m_request->appendStr(keys[i]);
-    }
     m_request->endl();
 
     request(m_request->getResult(), m_request->getResultLen());
+    return m_reponse->getStatus();
+}
+
+void SSDBClient::hrangeRequest(const char* cmd, const std::string& name, const std::string& key_start,
+    const std::string& key_end, uint64_t limit)
+{
+    m_request->appendStr(cmd);
+    m_request->appendStr(name);
+    m_request->appendStr(key_start);
+    m_request->appendStr(key_end);
+    m_request->appendUint64(limit);
+    m_request->endl();
+
+    request(m_request->getResult(), m_request->getResultLen(), true);
+}
+
+Status SSDBClient::hkeys(const std::string& name, const std::string& key_start, const std::string& key_end,
+    uint64_t limit, std::vector<std::string> *ret)
+{
+    hrangeRequest("hkeys", name, key_start, key_end, limit);
+    return read_list(m_reponse, ret);
+}
+
+Status SSDBClient::hgetall(const std::string& name, std::map<std::string, std::string> *ret)
+{
+    m_request->appendStr("hgetall");
+    m_request->appendStr(name);
+    m_request->endl();
+
+    request(m_request->getResult(), m_request->getResultLen(), true);
+
+    return read_values(m_reponse, m_codec, ret);
+}
+
+Status SSDBClient::hgetall(const std::string& name, const SSDBPairVisitor& visitor)
+{
+    m_request->appendStr("hgetall");
+    m_request->appendStr(name);
+    m_request->endl();
+
+    request(m_request->getResult(), m_request->getResultLen(), true);
+
+    return read_value_pairs(m_reponse, m_codec, visitor);
+}
+
+Status SSDBClient::hscan(const std::string& name, const std::string& key_start, const std::string& key_end,
+    uint64_t limit, std::map<std::string, std::string> *ret)
+{
+    hrangeRequest("hscan", name, key_start, key_end, limit);
+    return read_values(m_reponse, m_codec, ret);
+}
+
+Status SSDBClient::hscan(const std::string& name, const std::string& key_start, const std::string& key_end,
+    uint64_t limit, const SSDBPairVisitor& visitor)
+{
+    hrangeRequest("hscan", name, key_start, key_end, limit);
+    return read_value_pairs(m_reponse, m_codec, visitor);
+}
+
+Status SSDBClient::hrscan(const std::string& name, const std::string& key_start, const std::string& key_end,
+    uint64_t limit, std::map<std::string, std::string> *ret)
+{
+    hrangeRequest("hrscan", name, key_start, key_end, limit);
+    return read_values(m_reponse, m_codec, ret);
+}
 
-    return read_map(m_reponse, ret);
+Status SSDBClient::hrscan(const std::string& name, const std::string& key_start, const std::string& key_end,
+    uint64_t limit, const SSDBPairVisitor& visitor)
+{
+    hrangeRequest("hrscan", name, key_start, key_end, limit);
+    return read_value_pairs(m_reponse, m_codec, visitor);
 }
 
 Status SSDBClient::zset(const std::string& name, const std::string& key, int64_t score)
@@ -845,9 +1823,7 @@ Status SSDBClient::zset(const std::string& name, const std::string& key, int64_t
     m_request->appendStr("zset");
     m_request->appendStr(name);
     m_request->appendStr(key);
-    char s_str[30];
-    sprintf(s_str, "%lld", score);
-    m_request->appendStr(s_str);
+    m_request->appendInt64(score);
     m_request->endl();
 
     request(m_request->getResult(), m_request->getResultLen());
@@ -855,6 +1831,18 @@ Status SSDBClient::zset(const std::string& name, const std::string& key, int64_t
     return m_reponse->getStatus();
 }
 
+Status SSDBClient::multi_zset(const std::string& name, const std::map<std::string, int64_t>& kss)
+{
+    std::map<std::string, int64_t>::const_iterator iter = kss.begin();
+    return multiRequest("multi_zset", &name, kss.size(), encoded_size(kss), [&]() {
+        m_request->appendStr(iter->first);
+        m_request->appendInt64(iter->second);
+        int len = (int)iter->first.size() + 8;
+        ++iter;
+        return len;
+    }, SSDBPipelineVisitor());
+}
+
 Status SSDBClient::zget(const std::string& name, const std::string& key, int64_t *score)
 {
     m_request->appendStr("zget");
@@ -862,11 +1850,25 @@ Status SSDBClient::zget(const std::string& name, const std::string& key, int64_t
     m_request->appendStr(key);
     m_request->endl();
 
-    request(m_request->getResult(), m_request->getResultLen());
+    request(m_request->getResult(), m_request->getResultLen(), true);
 
     return read_int64(m_reponse, score);
 }
 
+Status SSDBClient::zincr(const std::string& name, const std::string& key, int64_t by, int64_t *newVal)
+{
+    m_request->appendStr("zincr");
+    m_request->appendStr(name);
+    m_request->appendStr(key);
+    m_request->appendInt64(by);
+    m_request->endl();
+
+    request(m_request->getResult(), m_request->getResultLen());
+
+    int64_t val = 0;
+    return read_int64(m_reponse, newVal != NULL ? newVal : &val);
+}
+
 Status SSDBClient::zsize(const std::string& name, int64_t *size)
 {
     m_request->appendStr("zsize");
@@ -887,9 +1889,7 @@ Status SSDBClient::zkeys(const std::string& name, const std::string& key_start,
     m_request->appendInt64(score_start);
     m_request->appendInt64(score_end);
 
-    char buf[30] = {0};
-    snprintf(buf, sizeof(buf), "%llu", limit);
-    m_request->appendStr(buf);
+    m_request->appendUint64(limit);
 
     m_request->endl();
 
@@ -907,9 +1907,7 @@ Status SSDBClient::zscan(const std::string& name, const std::string& key_start,
     m_request->appendInt64(score_start);
     m_request->appendInt64(score_end);
 
-    char buf[30] = {0};
-    snprintf(buf, sizeof(buf), "%llu", limit);
-    m_request->appendStr(buf);
+    m_request->appendUint64(limit);
 
     m_request->endl();
 
@@ -918,6 +1916,90 @@ Status SSDBClient::zscan(const std::string& name, const std::string& key_start,
     return read_list(m_reponse, ret);
 }
 
+Status SSDBClient::zsetRequest(const char* cmd, const std::string& name, const std::string& key_start,
+    int64_t score_start, int64_t score_end, uint64_t limit, SSDBZsetResult *ret)
+{
+    m_request->appendStr(cmd);
+    m_request->appendStr(name);
+    m_request->appendStr(key_start);
+    m_request->appendInt64(score_start);
+    m_request->appendInt64(score_end);
+    m_request->appendUint64(limit);
+    m_request->endl();
+
+    request(m_request->getResult(), m_request->getResultLen(), true);
+
+    ret->clear();
+    return read_zset(m_reponse, ret);
+}
+
+Status SSDBClient::zscan(const std::string& name, const std::string& key_start,
+    int64_t score_start, int64_t score_end, uint64_t limit, SSDBZsetResult *ret)
+{
+    return zsetRequest("zscan", name, key_start, score_start, score_end, limit, ret);
+}
+
+Status SSDBClient::zrscan(const std::string& name, const std::string& key_start,
+    int64_t score_start, int64_t score_end, uint64_t limit, SSDBZsetResult *ret)
+{
+    return zsetRequest("zrscan", name, key_start, score_start, score_end, limit, ret);
+}
+
+Status SSDBClient::zrangeRequest(const char* cmd, const std::string& name, uint64_t offset, uint64_t limit, SSDBZsetResult *ret)
+{
+    m_request->appendStr(cmd);
+    m_request->appendStr(name);
+    m_request->appendUint64(offset);
+    m_request->appendUint64(limit);
+    m_request->endl();
+
+    request(m_request->getResult(), m_request->getResultLen(), true);
+
+    ret->clear();
+    return read_zset(m_reponse, ret);
+}
+
+Status SSDBClient::zrange(const std::string& name, uint64_t offset, uint64_t limit, SSDBZsetResult *ret)
+{
+    return zrangeRequest("zrange", name, offset, limit, ret);
+}
+
+Status SSDBClient::zrrange(const std::string& name, uint64_t offset, uint64_t limit, SSDBZsetResult *ret)
+{
+    return zrangeRequest("zrrange", name, offset, limit, ret);
+}
+
+Status SSDBClient::zrank(const std::string& name, const std::string& key, int64_t *rank)
+{
+    m_request->appendStr("zrank");
+    m_request->appendStr(name);
+    m_request->appendStr(key);
+    m_request->endl();
+
+    request(m_request->getResult(), m_request->getResultLen(), true);
+
+    return read_int64(m_reponse, rank);
+}
+
+Status SSDBClient::multi_zget(const std::string& name, const std::vector<std::string>& keys, SSDBZsetResult *ret)
+{
+    ret->clear();
+
+    size_t next = 0;
+    Status parsed("ok");
+    Status status = multiRequest("multi_zget", &name, keys.size(), encoded_size(keys), [&]() {
+        m_request->appendStr(keys[next]);
+        return (int)keys[next++].size();
+    }, [&](int, SSDBProtocolResponse* response) {
+        Status current = read_zset(response, ret);
+        if (!current.ok() && parsed.ok())
+        {
+            parsed = current;
+        }
+    });
+    return status.ok() ? parsed : status;
+}
+
 Status SSDBClient::zclear(const std::string& name)
 {
     m_request->appendStr("zclear");
@@ -940,6 +2022,13 @@ Status SSDBClient::qpush(const std::string& name, const std::string& item)
     return m_reponse->getStatus();
 }
 
+Status SSDBClient::qpush(const std::string& name, const SSDBValueSource& item)
+{
+    m_request->appendStr("qpush");
+    m_request->appendStr(name);
+    return streamUpload(item);
+}
+
 Status SSDBClient::qpop(const std::string& name, std::string* item)
 {
     m_request->appendStr("qpop");
@@ -951,6 +2040,44 @@ Status SSDBClient::qpop(const std::string& name, std::string* item)
     return read_str(m_reponse, item);
 }
 
+Status SSDBClient::qpush(const std::string& name, const std::vector<std::string>& items, int64_t *size)
+{
+    size_t next = 0;
+    return multiRequest("qpush", &name, items.size(), encoded_size(items), [&]() {
+        m_request->appendStr(items[next]);
+        return (int)items[next++].size();
+    }, [size](int, SSDBProtocolResponse* response) {
+        /*  最后一块的response为最终长度  */
+        int64_t val = 0;
+        read_int64(response, size != NULL ? size : &val);
+    });
+}
+
+Status SSDBClient::qpop(const std::string& name, int64_t count, std::vector<std::string> *items)
+{
+    m_request->appendStr("qpop");
+    m_request->appendStr(name);
+    m_request->appendInt64(count);
+    m_request->endl();
+
+    request(m_request->getResult(), m_request->getResultLen());
+
+    /*  count为1且队列为空时服务端返回not_found   */
+    Status status = read_list(m_reponse, items);
+    return status.not_found() ? Status("ok") : status;
+}
+
+Status SSDBClient::qsize(const std::string& name, int64_t *size)
+{
+    m_request->appendStr("qsize");
+    m_request->appendStr(name);
+    m_request->endl();
+
+    request(m_request->getResult(), m_request->getResultLen(), true);
+
+    return read_int64(m_reponse, size);
+}
+
 Status SSDBClient::qslice(const std::string& name, int64_t begin, int64_t end, std::vector<std::string> *ret)
 {
     m_request->appendStr("qslice");
@@ -4,6 +4,9 @@
 #include <vector>
 #include <string>
 #include <map>
+#include <functional>
+
+#include "ssdb_transport.h"
 
 #if defined _MSC_VER || defined _WIN32 || defined __MINGW32__
 typedef char int8_t;
@@ -24,9 +27,20 @@ typedef unsigned long long int uint64_t;
 
 class SSDBProtocolResponse;
 class SSDBProtocolRequest;
+class SSDBTrafficLog;
+class SSDBCommandReply;
+template<size_t N> struct SSDBCommandName;
+class SSDBValueCodec;
 
 struct buffer_s;
 
+/*  pipeline中每收到一个完整response的回调: (请求序号, response)  */
+typedef std::function<void(int, SSDBProtocolResponse*)> SSDBPipelineVisitor;
+/*  流式读取时依次收到的value数据块, 返回false中止读取  */
+typedef std::function<bool(const char*, int)> SSDBValueSink;
+/*  逐个访问response中的(key, value)对: 指针指向接收缓冲区, 只在回调期间有效   */
+typedef std::function<void(const char*, int, const char*, int)> SSDBPairVisitor;
+
 class Status
 {
 public:
@@ -51,6 +65,18 @@ public:
         return mCode != "ok";
     }
 
+    /*  请求超过setRequestTimeout设置的时间未完成  */
+    int             timeout() const
+    {
+        return mCode == "timeout";
+    }
+
+    /*  连续连接失败后处于退避等待期间, 请求未发送直接失败   */
+    int             unavailable() const
+    {
+        return mCode == "unavailable";
+    }
+
     std::string     code() const
     {
         return mCode;
@@ -60,37 +86,276 @@ private:
     std::string     mCode;
 };
 
+/*  断线重连策略
+    连续第n次连接失败后, 在min(minBackoffMs * 2^(n-1), maxBackoffMs)的50%~100%(随机抖动, 避免大量client同时重连)内
+    不再尝试连接, 期间的请求直接返回Status("unavailable"), 不必每次等待connect超时(熔断).
+    等待结束后的下一个请求作为探测重新连接, 成功则恢复正常   */
+struct SSDBReconnectPolicy
+{
+    SSDBReconnectPolicy() : minBackoffMs(100), maxBackoffMs(10000), retryIdempotent(true)
+    {
+    }
+
+    int64_t                 minBackoffMs;
+    int64_t                 maxBackoffMs;
+    /*  连接在请求过程中断开时, 幂等命令(get/hget/exists/zget/set)在新连接上重试一次   */
+    bool                    retryIdempotent;
+};
+
+/*  连接的socket选项, 每次(重新)连接后设置. 值为0(或-1)的项保持系统默认
+    throughput()与lowLatency()为两种常用的预设, 可在其基础上修改    */
+struct SSDBSocketOptions
+{
+    SSDBSocketOptions() : noDelay(true), keepAliveIdle(30), keepAliveInterval(3), keepAliveProbes(10),
+        sendBufferSize(0), recvBufferSize(0), busyPollUs(0), quickAck(false), incomingCpu(-1), zerocopyThreshold(0)
+    {
+    }
+
+    /*  大批量读写: 4MB收发缓冲区, 64KB以上的请求使用MSG_ZEROCOPY发送 */
+    static SSDBSocketOptions    throughput();
+    /*  低延迟: 忙等50us接收, 收到response后立即ACK  */
+    static SSDBSocketOptions    lowLatency();
+
+    bool                    noDelay;
+    /*  keepAliveIdle为0时不开启keepalive    */
+    unsigned int            keepAliveIdle;
+    unsigned int            keepAliveInterval;
+    unsigned int            keepAliveProbes;
+    int                     sendBufferSize;
+    int                     recvBufferSize;
+
+    /*  以下仅Linux有效   */
+    int                     busyPollUs;
+    /*  每次收到数据后设置TCP_QUICKACK  */
+    bool                    quickAck;
+    /*  SO_INCOMING_CPU, 通常与处理此连接的线程所在的cpu一致   */
+    int                     incomingCpu;
+    /*  不小于此长度的请求以MSG_ZEROCOPY发送, 完成通知在请求结束时从错误队列读取;
+        内核回退为拷贝(例如loopback)时此连接不再使用MSG_ZEROCOPY  */
+    int                     zerocopyThreshold;
+};
+
+/*  multi_*命令的分块策略
+    键数量超过当前块大小或编码后超过maxBytes时拆分为多个命令, 每次pipeline发送pipelineDepth个, 结果合并后返回.
+    块大小(键个数)在[minKeys, maxKeys]之间按实测延迟调整: 单块耗时超过targetLatencyUs时减半, 低于一半时增加1/4  */
+struct SSDBChunkPolicy
+{
+    SSDBChunkPolicy() : initialKeys(256), minKeys(16), maxKeys(4096), maxBytes(1024 * 1024), pipelineDepth(4), targetLatencyUs(10000)
+    {
+    }
+
+    int                     initialKeys;
+    int                     minKeys;
+    int                     maxKeys;
+    int                     maxBytes;
+    int                     pipelineDepth;
+    int64_t                 targetLatencyUs;
+};
+
+/*  value压缩: enabled时set/setx/setnx/hset/multi_set/multi_hset把不小于threshold字节的value以zlib(level)压缩,
+    压缩后带8字节头部, 压缩收益不足1/8时原样写入. get/hget/multi_get/multi_hget识别头部自动解压,
+    没有头部的旧value原样返回; 本身以有效头部开始的value写入时加STORED头部转义.
+    hgetall/hscan/hrscan、流式读取(get_stream等)与command()的value同样解压.
+    enabled为false时只解压(与转义)不压缩. 未调用setCompression的client不做任何处理.
+    流式写入(SSDBValueSource)不压缩也不转义  */
+struct SSDBCompressionOptions
+{
+    SSDBCompressionOptions() : enabled(true), threshold(1024), level(1)
+    {
+    }
+
+    bool                    enabled;
+    int                     threshold;
+    int                     level;
+};
+
+/*  zset查询结果(struct-of-arrays): 所有member连续存放在members中, 第i个member为members[offsets[i], offsets[i+1]),
+    scores[i]为解析好的分数. 查询前会清空结果但保留已分配的内存, 重复使用同一个对象可避免分配   */
+struct SSDBZsetResult
+{
+    SSDBZsetResult() : offsets(1, 0)
+    {
+    }
+
+    size_t                  size() const
+    {
+        return scores.size();
+    }
+
+    const char*             member(size_t i) const
+    {
+        return members.data() + offsets[i];
+    }
+
+    size_t                  memberLen(size_t i) const
+    {
+        return offsets[i + 1] - offsets[i];
+    }
+
+    std::string             memberStr(size_t i) const
+    {
+        return std::string(member(i), memberLen(i));
+    }
+
+    void                    clear()
+    {
+        members.clear();
+        offsets.assign(1, 0);
+        scores.clear();
+    }
+
+    /*  为之后追加的count个member(共bytes字节)预留空间. 容量不足时至少翻倍,
+        multi_zget逐块追加时不会每块都重新分配并拷贝已有结果  */
+    void                    reserve(size_t count, size_t bytes)
+    {
+        grow(members, members.size() + bytes);
+        grow(offsets, offsets.size() + count);
+        grow(scores, scores.size() + count);
+    }
+
+    void                    append(const char* data, size_t len, int64_t score)
+    {
+        members.append(data, len);
+        offsets.push_back((uint32_t)members.size());
+        scores.push_back(score);
+    }
+
+    std::string             members;
+    std::vector<uint32_t>   offsets;
+    std::vector<int64_t>    scores;
+
+private:
+    template<typename T>
+    static void             grow(T& container, size_t needed)
+    {
+        if (container.capacity() < needed)
+        {
+            container.reserve(needed > 2 * container.capacity() ? needed : 2 * container.capacity());
+        }
+    }
+};
+
+/*  流式写入(set/hset/qpush)的value: 先发送长度, 再直接从内存(writev)、文件(sendfile)或回调分块发送,
+    不需要把整个value放进std::string再拷贝进请求缓冲区. 流式写入的请求不会被startCapture录制    */
+struct SSDBValueSource
+{
+    /*  向buffer填充最多len字节, 返回实际长度, <=0表示失败    */
+    typedef std::function<int(char*, int)> Reader;
+
+    SSDBValueSource() : data(NULL), fd(-1), offset(0), size(0)
+    {
+    }
+
+    /*  data在请求完成前须保持有效(例如mmap的文件)   */
+    static SSDBValueSource  memory(const char* data, int64_t size);
+    /*  从fd的offset处读取size字节, size<0表示到文件末尾   */
+    static SSDBValueSource  file(int fd, int64_t offset = 0, int64_t size = -1);
+    static SSDBValueSource  callback(int64_t size, const Reader& reader);
+
+    const char*             data;
+    int                     fd;
+    int64_t                 offset;
+    int64_t                 size;
+    Reader                  reader;
+};
+
 class SSDBClient
 {
 public:
     SSDBClient();
+    /*  使用transport收发请求(不使用自身的socket), transport需在client生命期内保持有效 */
+    explicit SSDBClient(SSDBTransport* transport);
     ~SSDBClient();
 
     void                    disconnect();
+    /*  ip以'/'开头时连接该路径的unix domain socket(忽略port), 适用于与ssdb部署在同一台机器  */
     void                    connect(const char* ip, int port, uint32_t timeoutSec=5);
+    /*  接管一个已连接的socket(例如ox_socket_recv_fd从其他进程收到的fd), 断开后不会自动重连 */
+    bool                    attach(int fd, uint32_t timeoutSec=5);
+    /*  并行为count个client各建立一个连接(冷启动时代替逐个connect), 返回连接成功的client个数   */
+    static int              connectAll(SSDBClient** clients, int count, const char* ip, int port, uint32_t timeoutSec=5);
     bool                    isconnected() const;
 
+    /*  每次请求(发送+接收整体)的超时时间(微秒), 0表示不限制(默认).
+        超时后断开连接(下次请求自动重连), 命令返回Status("timeout"). 使用transport时不生效   */
+    void                    setRequestTimeout(int64_t timeoutUs);
+    void                    setReconnectPolicy(const SSDBReconnectPolicy& policy);
+    /*  立即应用到当前连接, 之后的重连同样生效. 使用transport时不生效    */
+    void                    setSocketOptions(const SSDBSocketOptions& options);
+    void                    setChunkPolicy(const SSDBChunkPolicy& policy);
+    void                    setCompression(const SSDBCompressionOptions& options);
+
     void                    execute(const char* str, int len);
 
+    /*  通用命令: client.command("zrank", name, key).get(&rank), 可发送任意ssdb命令.
+        参数按类型编码(string、string_view、C字符串、整数、vector、list、set、map、pair).
+        返回的SSDBCommandReply引用client的response, 在此client的下一个请求之前有效.
+        定义在ssdb_command.h中, 使用时需包含该头文件   */
+    template<size_t N, typename... Args>
+    SSDBCommandReply        command(const char (&name)[N], const Args&... args);
+    template<size_t N, typename... Args>
+    SSDBCommandReply        command(const SSDBCommandName<N>& name, const Args&... args);
+
+    /*  pipeline: 一次发送buffer中已编码好的count个请求, 再依次接收count个response,
+        每收到一个完整response即调用visitor. 返回成功接收的response个数   */
+    int                     pipeline(const char* buffer, int len, int count, const SSDBPipelineVisitor& visitor = SSDBPipelineVisitor());
+
+    /*  录制此client发出的所有请求到log, 录制期间log须保持有效  */
+    void                    startCapture(SSDBTrafficLog* log);
+    void                    stopCapture();
+
     Status                  set(const std::string& key, const std::string& val);
+    Status                  set(const std::string& key, const SSDBValueSource& val);
 	Status					setx(const std::string& key, const std::string& val, int ttl);
 	Status					setnx(const std::string& key, const std::string& val, int *reply);
     Status                  get(const std::string& key, std::string *val);
 	Status					del(const std::string& key);
+    /*  流式读取value: 数据一到达就按块交给sink, 或直接写入fd(Linux上使用splice), 内存占用与value大小无关.
+        sink返回false或写fd失败时中止并断开连接. size(可为NULL)返回value长度.
+        设置了压缩选项时交出的是解压后的数据(不使用splice), size为解压后的长度.
+        使用transport时先完整接收再交给sink/fd    */
+    Status                  get_stream(const std::string& key, const SSDBValueSink& sink, int64_t *size = NULL);
+    Status                  get_to_fd(const std::string& key, int fd, int64_t *size = NULL);
 	Status					multi_get(const std::vector<std::string>& keys, std::map<std::string, std::string> *ret);
 	Status					multi_set(const std::map<std::string, std::string>& kvs);
 	Status					multi_del(const std::vector<std::string>& keys);
 	Status					expire(const std::string& key, int ttl);
 	Status					exists(const std::string& key, int *ret);
+    /*  incr/hincr/zincr: 增加by, newVal(可为NULL)返回增加后的值    */
+    Status                  incr(const std::string& key, int64_t by, int64_t *newVal);
 
-    Status                  hset(const std::string& name, const std::string& key, std::string val);
+    Status                  hset(const std::string& name, const std::string& key, const std::string& val);
+    Status                  hset(const std::string& name, const std::string& key, const SSDBValueSource& val);
 	Status                  multi_hset(const std::string& name, const std::map<std::string, std::string> &kvs);
     Status                  hget(const std::string& name, const std::string& key, std::string *val);
+    Status                  hget_stream(const std::string& name, const std::string& key, const SSDBValueSink& sink, int64_t *size = NULL);
+    Status                  hget_to_fd(const std::string& name, const std::string& key, int fd, int64_t *size = NULL);
+    Status                  hincr(const std::string& name, const std::string& key, int64_t by, int64_t *newVal);
 	Status                  multi_hget(const std::string& name, const std::vector<std::string> &keys, std::map<std::string, std::string> *ret);
+    Status                  hdel(const std::string& name, const std::string& key);
+    Status                  multi_hdel(const std::string& name, const std::vector<std::string>& keys);
+    Status                  hsize(const std::string& name, int64_t *size);
+    Status                  hclear(const std::string& name);
+    /*  key_start/key_end为空表示不限制, 范围为(key_start, key_end]   */
+    Status                  hkeys(const std::string& name, const std::string& key_start, const std::string& key_end,
+                                    uint64_t limit, std::vector<std::string> *ret);
+    /*  hgetall/hscan/hrscan: visitor版本按服务端顺序逐个交出(key, value), 不构造map   */
+    Status                  hgetall(const std::string& name, std::map<std::string, std::string> *ret);
+    Status                  hgetall(const std::string& name, const SSDBPairVisitor& visitor);
+    Status                  hscan(const std::string& name, const std::string& key_start, const std::string& key_end,
+                                    uint64_t limit, std::map<std::string, std::string> *ret);
+    Status                  hscan(const std::string& name, const std::string& key_start, const std::string& key_end,
+                                    uint64_t limit, const SSDBPairVisitor& visitor);
+    Status                  hrscan(const std::string& name, const std::string& key_start, const std::string& key_end,
+                                    uint64_t limit, std::map<std::string, std::string> *ret);
+    Status                  hrscan(const std::string& name, const std::string& key_start, const std::string& key_end,
+                                    uint64_t limit, const SSDBPairVisitor& visitor);
 
     Status                  zset(const std::string& name, const std::string& key, int64_t score);
+	Status                  multi_zset(const std::string& name, const std::map<std::string, int64_t>& kss);
 
     Status                  zget(const std::string& name, const std::string& key, int64_t *score);
+    Status                  zincr(const std::string& name, const std::string& key, int64_t by, int64_t *newVal);
 
     Status                  zsize(const std::string& name, int64_t *size);
 
@@ -100,10 +365,27 @@ public:
     Status                  zscan(const std::string& name, const std::string& key_start,
                                     int64_t score_start, int64_t score_end,uint64_t limit, std::vector<std::string> *ret);
 
+    /*  zscan/zrscan/zrange/zrrange/multi_zget的类型化版本: member与score在解析时直接写入ret, 不产生中间string   */
+    Status                  zscan(const std::string& name, const std::string& key_start,
+                                    int64_t score_start, int64_t score_end, uint64_t limit, SSDBZsetResult *ret);
+    Status                  zrscan(const std::string& name, const std::string& key_start,
+                                    int64_t score_start, int64_t score_end, uint64_t limit, SSDBZsetResult *ret);
+    Status                  zrange(const std::string& name, uint64_t offset, uint64_t limit, SSDBZsetResult *ret);
+    Status                  zrrange(const std::string& name, uint64_t offset, uint64_t limit, SSDBZsetResult *ret);
+    Status                  zrank(const std::string& name, const std::string& key, int64_t *rank);
+    /*  不存在的key不出现在结果中   */
+    Status                  multi_zget(const std::string& name, const std::vector<std::string>& keys, SSDBZsetResult *ret);
+
     Status                  zclear(const std::string& name);
 
     Status                  qpush(const std::string& name, const std::string& item);
+    Status                  qpush(const std::string& name, const SSDBValueSource& item);
+    /*  按顺序批量入队(按分块策略拆分为多个qpush), size(可为NULL)返回入队后的队列长度  */
+    Status                  qpush(const std::string& name, const std::vector<std::string>& items, int64_t *size = NULL);
     Status                  qpop(const std::string& name, std::string* item);
+    /*  一次取出最多count条追加到items, 队列为空时返回ok且不追加  */
+    Status                  qpop(const std::string& name, int64_t count, std::vector<std::string> *items);
+    Status                  qsize(const std::string& name, int64_t *size);
     Status                  qslice(const std::string& name, int64_t begin, int64_t end, std::vector<std::string> *ret);
     Status                  qclear(const std::string& name);
 
@@ -112,9 +394,57 @@ private:
     void operator=(const SSDBClient&); 
 
 private:
-    void                    request(const char*, int len);
-    int                     send(const char* buffer, int len);
+    /*  idempotent为true时, 连接在请求过程中断开会重连并重发一次   */
+    void                    request(const char*, int len, bool idempotent = false);
+    /*  发送command()编码在m_request中的命令  */
+    SSDBProtocolResponse*   commandRequest();
+    /*  未连接时按重连策略重连, 处于退避期间返回false    */
+    bool                    ensureConnected();
+    void                    onConnectResult(bool connected);
+    /*  按分块策略发送multi_*命令: 每块为cmd [name] + 若干次appendNext追加的元素(返回追加的字节数),
+        visitor依次处理每块的response. encodedBytes为所有元素编码后的总长度, 用于一次预留请求缓冲区.
+        返回第一个失败块的状态    */
+    Status                  multiRequest(const char* cmd, const std::string* name, size_t count, int64_t encodedBytes,
+                                        const std::function<int()>& appendNext, const SSDBPipelineVisitor& visitor);
+    Status                  zsetRequest(const char* cmd, const std::string& name, const std::string& key_start,
+                                        int64_t score_start, int64_t score_end, uint64_t limit, SSDBZsetResult *ret);
+    Status                  zrangeRequest(const char* cmd, const std::string& name, uint64_t offset, uint64_t limit, SSDBZsetResult *ret);
+    /*  发送hscan/hrscan/hkeys请求    */
+    void                    hrangeRequest(const char* cmd, const std::string& name, const std::string& key_start,
+                                        const std::string& key_end, uint64_t limit);
+    /*  追加(按压缩选项编码后的)value, 返回追加的长度  */
+    int                     appendValue(const std::string& val);
+    /*  zerocopy为true时, 不小于zerocopyThreshold的数据以MSG_ZEROCOPY发送, 调用者需保证
+        buffer在收到response之前不被修改(请求缓冲区/pipeline的buffer); 流式发送的分块缓冲区会被重复使用, 不能使用  */
+    int                     send(const char* buffer, int len, bool zerocopy = false);
+    /*  等待socket可读(或可写), 超过本次请求的deadline返回false  */
+    bool                    waitSocket(bool write);
+    void                    setupSocket(int fd);
+    void                    applySocketOptions();
+    /*  读取MSG_ZEROCOPY完成通知, 返回完成的个数 */
+    int                     drainZerocopy();
+    void                    beginRequest();
+    void                    endRequest();
+    /*  本次请求超时或快速失败时返回timeout/unavailable, 否则返回status    */
+    Status                  requestStatus(const Status& status) const;
     void                    recv();
+    int                     recvPackets(int count, const SSDBPipelineVisitor& visitor);
+    /*  接收一次数据追加到m_recvBuffer, 连接断开或超时返回false    */
+    bool                    recvMore();
+    /*  发送m_request中的get/hget并以流的方式接收value, sink为空时写入fd  */
+    Status                  streamRequest(const SSDBValueSink& sink, int fd, int64_t *size);
+    Status                  recvStream(const SSDBValueSink& sink, int fd, int64_t *size);
+    /*  直接从socket读取remaining字节的value交给sink/fd, 失败时断开连接   */
+    bool                    recvValue(const SSDBValueSink& sink, int fd, int64_t remaining);
+    /*  m_request中已编码命令名与参数, 追加value长度后流式发送value并接收response   */
+    Status                  streamUpload(const SSDBValueSource& value);
+    /*  发送整个value, 失败时断开连接(请求只发送了一部分) */
+    bool                    sendValue(const SSDBValueSource& value);
+    /*  录制buffer中已编码的count个命令  */
+    void                    capture(const char* buffer, int len, int count);
+    void                    flushCapture();
+    int                     transportRequest(const char* buffer, int len, int count, const SSDBPipelineVisitor& visitor);
+    void                    init();
 
 private:
     buffer_s*               m_recvBuffer;
@@ -126,6 +456,37 @@ private:
     std::string             m_ip;
     int                     m_port;
 	uint32_t					m_timeout;
+
+    /*  m_deadline为本次请求的截止时间(steady clock微秒), 0表示不限制  */
+    int64_t                 m_requestTimeout;
+    int64_t                 m_deadline;
+    bool                    m_timedout;
+
+    /*  m_retryAt为退避结束时间(steady clock微秒)   */
+    SSDBReconnectPolicy     m_reconnectPolicy;
+    int                     m_connectFailures;
+    int64_t                 m_retryAt;
+    uint64_t                m_random;
+    bool                    m_unavailable;
+
+    SSDBSocketOptions       m_socketOptions;
+    /*  m_zerocopyPending为已以MSG_ZEROCOPY发送但尚未收到完成通知的send次数  */
+    bool                    m_zerocopy;
+    int                     m_zerocopyPending;
+
+    /*  m_chunkKeys为当前块大小  */
+    SSDBChunkPolicy         m_chunkPolicy;
+    int                     m_chunkKeys;
+
+    /*  未调用setCompression时为NULL   */
+    SSDBValueCodec*         m_codec;
+
+    SSDBTransport*          m_transport;
+    SSDBReplyBuffer         m_transportReply;
+    bool                    m_transportReplyShared;
+
+    SSDBTrafficLog*         m_captureLog;
+    buffer_s*               m_captureBuffer;
 };
 
 #endif
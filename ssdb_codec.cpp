@@ -0,0 +1,455 @@
+#include <string.h>
+
+#if defined __has_include
+#if __has_include(<zlib.h>)
+#include <zlib.h>
+#define SSDB_HAVE_ZLIB
+#endif
+#endif
+
+#include "ssdb_protocol.h"
+#include "ssdb_codec.h"
+
+/*  压缩value的头部: '\0' 'S' 'C' 编码 + 原始长度(4字节小端)  */
+static const int CODEC_HEADER_LEN = 8;
+/*  未压缩: 用于转义本身以头部开始的value    */
+static const char CODEC_STORED = 0;
+static const char CODEC_ZLIB = 1;
+/*  解压后长度上限, 防止损坏的头部导致分配过大   */
+static const uint32_t CODEC_MAX_VALUE_LEN = 1024 * 1024 * 1024;
+/*  流式解压时每次交给sink的最大长度    */
+static const int CODEC_STREAM_CHUNK_LEN = 64 * 1024;
+
+struct SSDBValueCodecState
+{
+#if defined SSDB_HAVE_ZLIB
+    SSDBValueCodecState() : deflating(false), inflating(false)
+    {
+        memset(&deflater, 0, sizeof(deflater));
+        memset(&inflater, 0, sizeof(inflater));
+    }
+
+    z_stream    deflater;
+    z_stream    inflater;
+    bool        deflating;
+    bool        inflating;
+#endif
+};
+
+SSDBValueCodec::SSDBValueCodec() : m_state(new SSDBValueCodecState)
+{
+    beginStream(0);
+}
+
+SSDBValueCodec::~SSDBValueCodec()
+{
+#if defined SSDB_HAVE_ZLIB
+    if (m_state->deflating)
+    {
+        deflateEnd(&m_state->deflater);
+    }
+    if (m_state->inflating)
+    {
+        inflateEnd(&m_state->inflater);
+    }
+#endif
+    delete m_state;
+}
+
+void SSDBValueCodec::setOptions(const SSDBCompressionOptions& options)
+{
+#if defined SSDB_HAVE_ZLIB
+    if (m_state->deflating && options.level != m_options.level)
+    {
+        /*  压缩级别变化时重新初始化  */
+        deflateEnd(&m_state->deflater);
+        memset(&m_state->deflater, 0, sizeof(m_state->deflater));
+        m_state->deflating = false;
+    }
+#endif
+    m_options = options;
+}
+
+static uint32_t read_header_len(const char* data)
+{
+    uint32_t len = 0;
+    for (int i = 0; i < 4; ++i)
+    {
+        len |= (uint32_t)(unsigned char)data[4 + i] << (8 * i);
+    }
+    return len;
+}
+
+static void write_header(char* data, char codec, uint32_t len)
+{
+    data[0] = '\0';
+    data[1] = 'S';
+    data[2] = 'C';
+    data[3] = codec;
+    for (int i = 0; i < 4; ++i)
+    {
+        data[4 + i] = (char)((len >> (8 * i)) & 0xff);
+    }
+}
+
+/*  总长为len的value的头部编码, 不是有效的头部时返回-1.
+    data中至少有min(len, CODEC_HEADER_LEN + 2)字节   */
+static int header_codec(const char* data, int64_t len)
+{
+    if (len < CODEC_HEADER_LEN || data[0] != '\0' || data[1] != 'S' || data[2] != 'C')
+    {
+        return -1;
+    }
+
+    /*  除魔数外还检查头部与数据是否一致, 恰好以魔数开始的旧value不会被当作压缩数据   */
+    if (data[3] == CODEC_STORED)
+    {
+        return (int64_t)read_header_len(data) == len - CODEC_HEADER_LEN ? CODEC_STORED : -1;
+    }
+    if (data[3] == CODEC_ZLIB)
+    {
+        /*  zlib头: CM为8(deflate), (CMF*256+FLG)能被31整除  */
+        unsigned char cmf = len >= CODEC_HEADER_LEN + 2 ? (unsigned char)data[CODEC_HEADER_LEN] : 0;
+        unsigned char flg = len >= CODEC_HEADER_LEN + 2 ? (unsigned char)data[CODEC_HEADER_LEN + 1] : 0;
+        return (cmf & 0x0f) == 8 && (cmf * 256 + flg) % 31 == 0 ? CODEC_ZLIB : -1;
+    }
+    return -1;
+}
+
+bool SSDBValueCodec::compressed(const char* data, int len)
+{
+    return header_codec(data, len) >= 0;
+}
+
+void SSDBValueCodec::encode(const char* data, int len, const char** out, int* outLen)
+{
+    *out = data;
+    *outLen = len;
+    if (m_options.enabled && len >= m_options.threshold && len > 0 && deflateValue(data, len, outLen))
+    {
+        *out = m_buffer.data();
+        return;
+    }
+
+    if (compressed(data, len))
+    {
+        /*  原样存储的value本身以头部开始时加上STORED头部, 否则读取时会被当作压缩数据    */
+        if (m_buffer.size() < (size_t)len + CODEC_HEADER_LEN)
+        {
+            m_buffer.resize((size_t)len + CODEC_HEADER_LEN);
+        }
+        write_header(&m_buffer[0], CODEC_STORED, (uint32_t)len);
+        memcpy(&m_buffer[CODEC_HEADER_LEN], data, len);
+        *out = m_buffer.data();
+        *outLen = len + CODEC_HEADER_LEN;
+    }
+}
+
+bool SSDBValueCodec::deflateValue(const char* data, int len, int* outLen)
+{
+#if defined SSDB_HAVE_ZLIB
+    z_stream& stream = m_state->deflater;
+    if (!m_state->deflating)
+    {
+        if (deflateInit(&stream, m_options.level) != Z_OK)
+        {
+            return false;
+        }
+        m_state->deflating = true;
+    }
+    else
+    {
+        deflateReset(&stream);
+    }
+
+    uLong bound = deflateBound(&stream, (uLong)len);
+    if (m_buffer.size() < CODEC_HEADER_LEN + bound)
+    {
+        m_buffer.resize(CODEC_HEADER_LEN + bound);
+    }
+
+    stream.next_in = (Bytef*)data;
+    stream.avail_in = (uInt)len;
+    stream.next_out = (Bytef*)&m_buffer[CODEC_HEADER_LEN];
+    stream.avail_out = (uInt)bound;
+    int ret = deflate(&stream, Z_FINISH);
+    int size = CODEC_HEADER_LEN + (int)(bound - stream.avail_out);
+
+    /*  至少节省1/8才使用压缩结果   */
+    if (ret == Z_STREAM_END && size <= len - len / 8)
+    {
+        write_header(&m_buffer[0], CODEC_ZLIB, (uint32_t)len);
+        *outLen = size;
+        return true;
+    }
+#else
+    (void)data;
+    (void)len;
+    (void)outLen;
+#endif
+    return false;
+}
+
+bool SSDBValueCodec::decode(const char* data, int len, std::string* out)
+{
+    if (!compressed(data, len))
+    {
+        out->assign(data, len);
+        return true;
+    }
+
+    if (data[3] == CODEC_STORED)
+    {
+        out->assign(data + CODEC_HEADER_LEN, len - CODEC_HEADER_LEN);
+        return true;
+    }
+
+#if defined SSDB_HAVE_ZLIB
+    uint32_t valueLen = read_header_len(data);
+    if (valueLen > CODEC_MAX_VALUE_LEN)
+    {
+        return false;
+    }
+
+    z_stream& stream = m_state->inflater;
+    if (!m_state->inflating)
+    {
+        if (inflateInit(&stream) != Z_OK)
+        {
+            return false;
+        }
+        m_state->inflating = true;
+    }
+    else
+    {
+        inflateReset(&stream);
+    }
+
+    /*  直接解压到out, 不经过中间缓冲区  */
+    out->resize(valueLen);
+    stream.next_in = (Bytef*)(data + CODEC_HEADER_LEN);
+    stream.avail_in = (uInt)(len - CODEC_HEADER_LEN);
+    stream.next_out = (Bytef*)(valueLen > 0 ? &(*out)[0] : NULL);
+    stream.avail_out = (uInt)valueLen;
+    int ret = inflate(&stream, Z_FINISH);
+    return ret == Z_STREAM_END && stream.avail_out == 0;
+#else
+    return false;
+#endif
+}
+
+void SSDBValueCodec::beginStream(int64_t len)
+{
+    m_streamLen = len;
+    m_streamCodec = len > 0 ? -1 : -2;
+    m_streamHead.clear();
+    m_streamValueLen = 0;
+    m_streamOutLen = 0;
+    m_streamEnded = false;
+}
+
+bool SSDBValueCodec::decodeStream(const char* data, int len, const SSDBValueSink& sink)
+{
+    if (m_streamCodec == -1)
+    {
+        /*  先收齐判断头部所需的数据    */
+        int64_t need = m_streamLen < CODEC_HEADER_LEN + 2 ? m_streamLen : CODEC_HEADER_LEN + 2;
+        int64_t missing = need - (int64_t)m_streamHead.size();
+        int take = (int64_t)len < missing ? len : (int)missing;
+        m_streamHead.append(data, take);
+        data += take;
+        len -= take;
+        if (take < missing)
+        {
+            return true;
+        }
+
+        m_streamCodec = header_codec(m_streamHead.data(), m_streamLen);
+        int headerLen = CODEC_HEADER_LEN;
+        if (m_streamCodec < 0)
+        {
+            m_streamCodec = -2;
+            headerLen = 0;
+        }
+        else if (m_streamCodec == CODEC_ZLIB)
+        {
+#if defined SSDB_HAVE_ZLIB
+            m_streamValueLen = read_header_len(m_streamHead.data());
+            if (m_streamValueLen > CODEC_MAX_VALUE_LEN)
+            {
+                return false;
+            }
+            if (!m_state->inflating)
+            {
+                if (inflateInit(&m_state->inflater) != Z_OK)
+                {
+                    return false;
+                }
+                m_state->inflating = true;
+            }
+            else
+            {
+                inflateReset(&m_state->inflater);
+            }
+#else
+            return false;
+#endif
+        }
+        if (!decodeStreamBody(m_streamHead.data() + headerLen, (int)m_streamHead.size() - headerLen, sink))
+        {
+            return false;
+        }
+    }
+
+    return decodeStreamBody(data, len, sink);
+}
+
+bool SSDBValueCodec::decodeStreamBody(const char* data, int len, const SSDBValueSink& sink)
+{
+    if (len <= 0)
+    {
+        return true;
+    }
+    if (m_streamCodec != CODEC_ZLIB)
+    {
+        m_streamOutLen += len;
+        return sink(data, len);
+    }
+
+#if defined SSDB_HAVE_ZLIB
+    if (m_streamEnded)
+    {
+        /*  压缩数据之后还有多余的数据    */
+        return false;
+    }
+    if (m_streamChunk.empty())
+    {
+        m_streamChunk.resize(CODEC_STREAM_CHUNK_LEN);
+    }
+
+    z_stream& stream = m_state->inflater;
+    stream.next_in = (Bytef*)data;
+    stream.avail_in = (uInt)len;
+    do
+    {
+        stream.next_out = (Bytef*)&m_streamChunk[0];
+        stream.avail_out = (uInt)m_streamChunk.size();
+        int ret = inflate(&stream, Z_NO_FLUSH);
+        if (ret == Z_BUF_ERROR && stream.avail_in == 0)
+        {
+            /*  上次输出缓冲区用满, 但已没有更多输出   */
+            break;
+        }
+        if (ret != Z_OK && ret != Z_STREAM_END)
+        {
+            return false;
+        }
+
+        int produced = (int)m_streamChunk.size() - (int)stream.avail_out;
+        m_streamOutLen += produced;
+        if (m_streamOutLen > (int64_t)m_streamValueLen || (produced > 0 && !sink(&m_streamChunk[0], produced)))
+        {
+            return false;
+        }
+        m_streamEnded = ret == Z_STREAM_END;
+    } while (!m_streamEnded && (stream.avail_in > 0 || stream.avail_out == 0));
+    return stream.avail_in == 0;
+#else
+    return false;
+#endif
+}
+
+int64_t SSDBValueCodec::endStream()
+{
+    if (m_streamCodec == -1)
+    {
+        return -1;
+    }
+    if (m_streamCodec == CODEC_ZLIB && (!m_streamEnded || m_streamOutLen != (int64_t)m_streamValueLen))
+    {
+        return -1;
+    }
+    return m_streamOutLen;
+}
+
+Status read_value(SSDBProtocolResponse* response, SSDBValueCodec* codec, std::string* ret)
+{
+    if (codec == NULL)
+    {
+        return read_str(response, ret);
+    }
+
+    Status status = response->getStatus();
+    if (status.ok())
+    {
+        if (response->getBuffersLen() < 2)
+        {
+            status = Status("server_error");
+        }
+        else
+        {
+            Bytes* buf = response->getByIndex(1);
+            if (!codec->decode(buf->buffer, buf->len, ret))
+            {
+                status = Status("error");
+            }
+        }
+    }
+    return status;
+}
+
+Status read_values(SSDBProtocolResponse* response, SSDBValueCodec* codec, std::map<std::string, std::string>* ret)
+{
+    if (codec == NULL)
+    {
+        return read_map(response, ret);
+    }
+
+    Status status = response->getStatus();
+    if (status.ok())
+    {
+        std::string value;
+        for (size_t i = 1; i + 1 < response->getBuffersLen(); i += 2)
+        {
+            Bytes* key = response->getByIndex(i);
+            Bytes* buf = response->getByIndex(i + 1);
+            if (codec->decode(buf->buffer, buf->len, &value))
+            {
+                (*ret)[std::string(key->buffer, key->len)].swap(value);
+            }
+            else
+            {
+                /*  与get一致, value损坏时返回error而不是当作不存在   */
+                status = Status("error");
+            }
+        }
+    }
+    return status;
+}
+
+Status read_value_pairs(SSDBProtocolResponse* response, SSDBValueCodec* codec, const SSDBPairVisitor& visitor)
+{
+    if (codec == NULL)
+    {
+        return read_pairs(response, visitor);
+    }
+
+    bool decoded = true;
+    std::string value;
+    Status status = read_pairs(response, [codec, &visitor, &decoded, &value](const char* key, int keyLen, const char* data, int len) {
+        /*  没有头部的value不复制  */
+        if (!SSDBValueCodec::compressed(data, len))
+        {
+            visitor(key, keyLen, data, len);
+        }
+        else if (codec->decode(data, len, &value))
+        {
+            visitor(key, keyLen, value.data(), (int)value.size());
+        }
+        else
+        {
+            decoded = false;
+        }
+    });
+    return status.ok() && !decoded ? Status("error") : status;
+}
@@ -0,0 +1,72 @@
+#ifndef __SSDB_CODEC_H__
+#define __SSDB_CODEC_H__
+
+#include <string>
+#include <vector>
+
+#include "ssdb_client.h"
+
+class SSDBProtocolResponse;
+
+/*  value压缩: 超过阈值的value用zlib压缩后加8字节头(\0 S C 编码 + 原始长度)存储,
+    读取时识别头部自动解压, 没有头部的(旧)value原样返回.
+    不压缩的value本身以有效的头部开始时, 加上STORED编码的头部原样存储, 读取时去掉.
+    压缩与解压使用对象内复用的z_stream与缓冲区, 与client一样不是线程安全的.
+    编译时没有zlib(zlib.h)时不压缩, 读到压缩的value时返回失败    */
+
+struct SSDBValueCodecState;
+
+class SSDBValueCodec
+{
+public:
+    SSDBValueCodec();
+    ~SSDBValueCodec();
+
+    void                    setOptions(const SSDBCompressionOptions& options);
+
+    /*  返回要发送的数据: 不压缩(未启用/低于阈值/压缩收益不足)时为data本身,
+        否则指向内部缓冲区, 在下一次encode之前有效   */
+    void                    encode(const char* data, int len, const char** out, int* outLen);
+    /*  解码到out, 数据损坏时返回false   */
+    bool                    decode(const char* data, int len, std::string* out);
+
+    /*  流式解码: beginStream传入编码后value的总长度, 之后按顺序传入各块, 解码后的数据交给sink,
+        sink返回false或数据损坏时返回false. 全部传入后endStream检查value是否完整, 返回解码后的长度(损坏时为-1)  */
+    void                    beginStream(int64_t len);
+    bool                    decodeStream(const char* data, int len, const SSDBValueSink& sink);
+    int64_t                 endStream();
+
+    /*  data以有效的头部开始(STORED或压缩)   */
+    static bool             compressed(const char* data, int len);
+
+private:
+    SSDBValueCodec(const SSDBValueCodec&);
+    void operator=(const SSDBValueCodec&);
+
+    /*  压缩到m_buffer(含头部), 压缩收益不足时返回false   */
+    bool                    deflateValue(const char* data, int len, int* outLen);
+    /*  流式解码已确定编码后的数据  */
+    bool                    decodeStreamBody(const char* data, int len, const SSDBValueSink& sink);
+
+private:
+    SSDBCompressionOptions  m_options;
+    SSDBValueCodecState*    m_state;
+    std::string             m_buffer;
+
+    /*  m_streamCodec在收到足够判断头部的数据前为-1, 没有头部时为-2 */
+    int64_t                 m_streamLen;
+    int                     m_streamCodec;
+    std::string             m_streamHead;
+    uint32_t                m_streamValueLen;
+    int64_t                 m_streamOutLen;
+    bool                    m_streamEnded;
+    std::vector<char>       m_streamChunk;
+};
+
+/*  读取response中的value并以codec解码(codec为NULL时原样读取). value无法解码时返回error,
+    其余value仍写入ret/交给visitor. key与score等不是value的数据不解码   */
+Status read_value(SSDBProtocolResponse* response, SSDBValueCodec* codec, std::string* ret);
+Status read_values(SSDBProtocolResponse* response, SSDBValueCodec* codec, std::map<std::string, std::string>* ret);
+Status read_value_pairs(SSDBProtocolResponse* response, SSDBValueCodec* codec, const SSDBPairVisitor& visitor);
+
+#endif
@@ -0,0 +1,265 @@
+#ifndef __SSDB_COMMAND_H__
+#define __SSDB_COMMAND_H__
+
+#include <string>
+#include <vector>
+#include <list>
+#include <set>
+#include <map>
+#include <utility>
+#include <type_traits>
+#if __cplusplus >= 201703L
+#include <string_view>
+#endif
+
+#include "ssdb_protocol.h"
+#include "ssdb_client.h"
+#include "ssdb_codec.h"
+
+/*  通用命令API: 任意ssdb命令的编码与response读取
+
+    int64_t rank = 0;
+    client.command("zrank", "board", "user:1").get(&rank);
+    client.command("multi_zset", "board", scores);      // std::map<std::string, int64_t>
+
+    命令头(如"4\nzset\n")由SSDBCommandName在编译期生成, 频繁使用的命令可定义为constexpr常量:
+    static constexpr SSDBCommandName<5> ZSET("zset");
+    client.command(ZSET, "board", "user:1", 100);   */
+
+template<size_t... I>
+struct SSDBIndexes
+{
+};
+
+template<size_t N, size_t... I>
+struct SSDBMakeIndexes : SSDBMakeIndexes<N - 1, N - 1, I...>
+{
+};
+
+template<size_t... I>
+struct SSDBMakeIndexes<0, I...>
+{
+    typedef SSDBIndexes<I...> type;
+};
+
+constexpr size_t ssdb_pow10(size_t n)
+{
+    return n == 0 ? 1 : 10 * ssdb_pow10(n - 1);
+}
+
+/*  命令头"长度\n命令名\n"的第i个字符   */
+constexpr char ssdb_header_char(const char* name, size_t len, size_t digits, size_t i)
+{
+    return i < digits ? (char)('0' + len / ssdb_pow10(digits - 1 - i) % 10) :
+        (i == digits ? '\n' : (i < digits + 1 + len ? name[i - digits - 1] : '\n'));
+}
+
+template<size_t N>
+struct SSDBCommandName
+{
+    static_assert(N > 1 && N - 1 < 1000, "invalid command name");
+
+    enum
+    {
+        LEN = N - 1,
+        DIGITS = LEN < 10 ? 1 : (LEN < 100 ? 2 : 3),
+        SIZE = DIGITS + LEN + 2,
+    };
+
+    constexpr SSDBCommandName(const char (&name)[N]) : SSDBCommandName(name, typename SSDBMakeIndexes<SIZE>::type())
+    {
+    }
+
+    template<size_t... I>
+    constexpr SSDBCommandName(const char (&name)[N], SSDBIndexes<I...>) : data{ ssdb_header_char(name, LEN, DIGITS, I)... }
+    {
+    }
+
+    char data[SIZE];
+};
+
+/*  command()的response, 引用client的response, 在client的下一个请求之前有效.
+    client设置了压缩选项时get读取的string与map/visitor中的value按codec解压, list与item()不解压    */
+class SSDBCommandReply
+{
+public:
+    explicit SSDBCommandReply(SSDBProtocolResponse* response, SSDBValueCodec* codec = NULL) : m_response(response), m_codec(codec)
+    {
+    }
+
+    Status                  status() const
+    {
+        return m_response->getStatus();
+    }
+
+    bool                    ok() const
+    {
+        return status().ok() != 0;
+    }
+
+    /*  状态之后的数据项个数    */
+    size_t                  size() const
+    {
+        size_t count = m_response->getBuffersLen();
+        return count > 0 ? count - 1 : 0;
+    }
+
+    /*  第i个数据项(指向接收缓冲区)   */
+    const Bytes&            item(size_t i) const
+    {
+        return *m_response->getByIndex(i + 1);
+    }
+
+    Status                  get(std::string* ret) const
+    {
+        return read_value(m_response, m_codec, ret);
+    }
+
+    Status                  get(int64_t* ret) const
+    {
+        return read_int64(m_response, ret);
+    }
+
+    Status                  get(std::vector<std::string>* ret) const
+    {
+        return read_list(m_response, ret);
+    }
+
+    Status                  get(std::map<std::string, std::string>* ret) const
+    {
+        return read_values(m_response, m_codec, ret);
+    }
+
+    Status                  get(SSDBZsetResult* ret) const
+    {
+        ret->clear();
+        return read_zset(m_response, ret);
+    }
+
+    Status                  get(const SSDBPairVisitor& visitor) const
+    {
+        return read_value_pairs(m_response, m_codec, visitor);
+    }
+
+private:
+    SSDBProtocolResponse*   m_response;
+    SSDBValueCodec*         m_codec;
+};
+
+/*  按参数类型编码, 先全部声明以便容器元素递归使用  */
+inline void ssdb_append_arg(SSDBProtocolRequest* request, const char* data, int len);
+inline void ssdb_append_arg(SSDBProtocolRequest* request, const std::string& arg);
+inline void ssdb_append_arg(SSDBProtocolRequest* request, const char* arg);
+#if __cplusplus >= 201703L
+inline void ssdb_append_arg(SSDBProtocolRequest* request, std::string_view arg);
+#endif
+template<typename T>
+typename std::enable_if<std::is_integral<T>::value>::type ssdb_append_arg(SSDBProtocolRequest* request, T arg);
+template<typename T>
+void ssdb_append_arg(SSDBProtocolRequest* request, const std::vector<T>& arg);
+template<typename T>
+void ssdb_append_arg(SSDBProtocolRequest* request, const std::list<T>& arg);
+template<typename T>
+void ssdb_append_arg(SSDBProtocolRequest* request, const std::set<T>& arg);
+template<typename K, typename V>
+void ssdb_append_arg(SSDBProtocolRequest* request, const std::pair<K, V>& arg);
+template<typename K, typename V>
+void ssdb_append_arg(SSDBProtocolRequest* request, const std::map<K, V>& arg);
+
+inline void ssdb_append_arg(SSDBProtocolRequest* request, const char* data, int len)
+{
+    request->append(data, len);
+}
+
+inline void ssdb_append_arg(SSDBProtocolRequest* request, const std::string& arg)
+{
+    ssdb_append_arg(request, arg.data(), (int)arg.size());
+}
+
+inline void ssdb_append_arg(SSDBProtocolRequest* request, const char* arg)
+{
+    ssdb_append_arg(request, arg, (int)strlen(arg));
+}
+
+#if __cplusplus >= 201703L
+inline void ssdb_append_arg(SSDBProtocolRequest* request, std::string_view arg)
+{
+    ssdb_append_arg(request, arg.data(), (int)arg.size());
+}
+#endif
+
+template<typename T>
+typename std::enable_if<std::is_integral<T>::value>::type ssdb_append_arg(SSDBProtocolRequest* request, T arg)
+{
+    if (std::is_signed<T>::value)
+    {
+        request->appendInt64((int64_t)arg);
+    }
+    else
+    {
+        request->appendUint64((uint64_t)arg);
+    }
+}
+
+template<typename T>
+void ssdb_append_arg(SSDBProtocolRequest* request, const std::vector<T>& arg)
+{
+    for (typename std::vector<T>::const_iterator iter = arg.begin(); iter != arg.end(); ++iter)
+    {
+        ssdb_append_arg(request, *iter);
+    }
+}
+
+template<typename T>
+void ssdb_append_arg(SSDBProtocolRequest* request, const std::list<T>& arg)
+{
+    for (typename std::list<T>::const_iterator iter = arg.begin(); iter != arg.end(); ++iter)
+    {
+        ssdb_append_arg(request, *iter);
+    }
+}
+
+template<typename T>
+void ssdb_append_arg(SSDBProtocolRequest* request, const std::set<T>& arg)
+{
+    for (typename std::set<T>::const_iterator iter = arg.begin(); iter != arg.end(); ++iter)
+    {
+        ssdb_append_arg(request, *iter);
+    }
+}
+
+template<typename K, typename V>
+void ssdb_append_arg(SSDBProtocolRequest* request, const std::pair<K, V>& arg)
+{
+    ssdb_append_arg(request, arg.first);
+    ssdb_append_arg(request, arg.second);
+}
+
+template<typename K, typename V>
+void ssdb_append_arg(SSDBProtocolRequest* request, const std::map<K, V>& arg)
+{
+    for (typename std::map<K, V>::const_iterator iter = arg.begin(); iter != arg.end(); ++iter)
+    {
+        ssdb_append_arg(request, iter->first);
+        ssdb_append_arg(request, iter->second);
+    }
+}
+
+template<size_t N, typename... Args>
+SSDBCommandReply SSDBClient::command(const char (&name)[N], const Args&... args)
+{
+    return command(SSDBCommandName<N>(name), args...);
+}
+
+template<size_t N, typename... Args>
+SSDBCommandReply SSDBClient::command(const SSDBCommandName<N>& name, const Args&... args)
+{
+    m_request->appendBlock(name.data, SSDBCommandName<N>::SIZE);
+    int expand[] = { 0, (ssdb_append_arg(m_request, args), 0)... };
+    (void)expand;
+    m_request->endl();
+
+    return SSDBCommandReply(commandRequest(), m_codec);
+}
+
+#endif
@@ -0,0 +1,109 @@
+#ifndef __SSDB_COMPLETION_H__
+#define __SSDB_COMPLETION_H__
+
+#include <atomic>
+#include <thread>
+
+#include "platform.h"
+
+#if defined PLATFORM_WINDOWS
+#include <windows.h>
+#pragma comment(lib, "Synchronization.lib")
+#elif defined __linux__
+#include <unistd.h>
+#include <sys/syscall.h>
+#include <linux/futex.h>
+#endif
+
+/*  一次性完成通知: 等待线程先自旋, 仍未完成再阻塞在futex(Windows上为WaitOnAddress)上.
+    完成方只有在等待方已经阻塞时才需要一次唤醒系统调用.
+    complete调用之后完成方不能再访问此对象(等待方可能已经返回并销毁它).   */
+
+class SSDBCompletion
+{
+public:
+    enum
+    {
+        PENDING = 0,
+        WAITING = 1,
+        SUCCESS = 2,
+        FAILED = 3,
+    };
+
+    SSDBCompletion() : m_state(PENDING)
+    {
+    }
+
+    void reset()
+    {
+        m_state.store(PENDING, std::memory_order_relaxed);
+    }
+
+    bool done() const
+    {
+        return m_state.load(std::memory_order_acquire) >= SUCCESS;
+    }
+
+    void complete(bool success)
+    {
+        int prev = m_state.exchange(success ? SUCCESS : FAILED, std::memory_order_acq_rel);
+        if (prev == WAITING)
+        {
+            wake();
+        }
+    }
+
+    /*  返回true表示SUCCESS  */
+    bool wait()
+    {
+        for (int i = 0; i < SPIN_COUNT; ++i)
+        {
+            if (done())
+            {
+                return m_state.load(std::memory_order_acquire) == SUCCESS;
+            }
+        }
+
+        int state = PENDING;
+        if (m_state.compare_exchange_strong(state, WAITING, std::memory_order_acq_rel))
+        {
+            state = WAITING;
+        }
+        while (state < SUCCESS)
+        {
+            block(state);
+            state = m_state.load(std::memory_order_acquire);
+        }
+
+        return state == SUCCESS;
+    }
+
+private:
+    static const int SPIN_COUNT = 2000;
+
+    void block(int expected)
+    {
+#if defined PLATFORM_WINDOWS
+        WaitOnAddress(&m_state, &expected, sizeof(expected), INFINITE);
+#elif defined __linux__
+        syscall(SYS_futex, reinterpret_cast<int*>(&m_state), FUTEX_WAIT_PRIVATE, expected, NULL, NULL, 0);
+#else
+        (void)expected;
+        std::this_thread::yield();
+#endif
+    }
+
+    void wake()
+    {
+#if defined PLATFORM_WINDOWS
+        WakeByAddressSingle(&m_state);
+#elif defined __linux__
+        syscall(SYS_futex, reinterpret_cast<int*>(&m_state), FUTEX_WAKE_PRIVATE, 1, NULL, NULL, 0);
+#endif
+    }
+
+private:
+    std::atomic<int>    m_state;
+};
+
+#endif
@@ -0,0 +1,332 @@
+#ifndef __SSDB_COROUTINE_H__
+#define __SSDB_COROUTINE_H__
+
+/*  C++20协程版ssdb api (需要 -std=c++20)
+    auto r = co_await client.get(key);   if (r.status.ok()) use(r.value);
+    请求在co_await时编码并提交到SSDBAsyncConnection, response到达后由事件循环直接恢复协程.
+    awaiter对象位于协程帧中并保存结果, 每次调用没有回调/future的额外内存分配.
+    所有接口只能在事件循环所在线程使用.    */
+
+#if defined(__cpp_impl_coroutine)
+
+#include <coroutine>
+#include <exception>
+#include <utility>
+#include <string>
+#include <vector>
+#include <map>
+
+#include "ssdb_protocol.h"
+#include "ssdb_async_connection.h"
+
+template<typename T>
+struct SSDBReply
+{
+    Status  status;
+    T       value;
+};
+
+/*  无返回值的命令  */
+struct SSDBNone
+{
+};
+
+template<typename T>
+inline Status ssdb_coro_read(SSDBProtocolResponse* response, T* ret);
+
+template<>
+inline Status ssdb_coro_read(SSDBProtocolResponse* response, SSDBNone*)
+{
+    return response->getStatus();
+}
+
+template<>
+inline Status ssdb_coro_read(SSDBProtocolResponse* response, std::string* ret)
+{
+    return read_str(response, ret);
+}
+
+template<>
+inline Status ssdb_coro_read(SSDBProtocolResponse* response, int64_t* ret)
+{
+    return read_int64(response, ret);
+}
+
+template<>
+inline Status ssdb_coro_read(SSDBProtocolResponse* response, int* ret)
+{
+    return read_int(response, ret);
+}
+
+template<>
+inline Status ssdb_coro_read(SSDBProtocolResponse* response, std::vector<std::string>* ret)
+{
+    return read_list(response, ret);
+}
+
+template<>
+inline Status ssdb_coro_read(SSDBProtocolResponse* response, std::map<std::string, std::string>* ret)
+{
+    return read_map(response, ret);
+}
+
+/*  Encoder: void(SSDBProtocolRequest*), 在await_suspend中把请求编码进连接的发送缓冲区  */
+template<typename T, typename Encoder>
+class SSDBAwaiter : public SSDBAsyncOp
+{
+public:
+    SSDBAwaiter(SSDBAsyncConnection* connection, Encoder encoder) : m_connection(connection), m_encoder(std::move(encoder))
+    {
+    }
+
+    bool await_ready() const noexcept
+    {
+        return false;
+    }
+
+    bool await_suspend(std::coroutine_handle<> handle)
+    {
+        if (!m_connection->isconnected())
+        {
+            m_status = Status("error");
+            return false;
+        }
+
+        m_handle = handle;
+        m_encoder(m_connection->request());
+        if (!m_connection->submit(this))
+        {
+            /*  不挂起, 直接以error恢复   */
+            m_status = Status("error");
+            return false;
+        }
+        return true;
+    }
+
+    auto await_resume()
+    {
+        if constexpr (std::is_same<T, SSDBNone>::value)
+        {
+            return m_status;
+        }
+        else
+        {
+            return SSDBReply<T>{ m_status, std::move(m_value) };
+        }
+    }
+
+    void complete(SSDBProtocolResponse* response) override
+    {
+        m_status = response != NULL ? ssdb_coro_read(response, &m_value) : Status("error");
+        m_handle.resume();
+    }
+
+private:
+    SSDBAsyncConnection*        m_connection;
+    Encoder                     m_encoder;
+    std::coroutine_handle<>     m_handle;
+    Status                      m_status;
+    T                           m_value;
+};
+
+template<typename T, typename Encoder>
+inline SSDBAwaiter<T, Encoder> ssdb_make_awaiter(SSDBAsyncConnection* connection, Encoder encoder)
+{
+    return SSDBAwaiter<T, Encoder>(connection, std::move(encoder));
+}
+
+/*  参数以引用保存, 需在同一个co_await表达式中使用: co_await client.get(key)  */
+class SSDBCoroClient
+{
+public:
+    explicit SSDBCoroClient(SSDBAsyncConnection* connection) : m_connection(connection)
+    {
+    }
+
+    SSDBAsyncConnection*    connection() const
+    {
+        return m_connection;
+    }
+
+    auto set(const std::string& key, const std::string& val)
+    {
+        return ssdb_make_awaiter<SSDBNone>(m_connection, [&key, &val](SSDBProtocolRequest* request) {
+            request->appendStr("set");
+            request->appendStr(key);
+            request->appendStr(val);
+            request->endl();
+        });
+    }
+
+    auto setx(const std::string& key, const std::string& val, int ttl)
+    {
+        return ssdb_make_awaiter<SSDBNone>(m_connection, [&key, &val, ttl](SSDBProtocolRequest* request) {
+            request->appendStr("setx");
+            request->appendStr(key);
+            request->appendStr(val);
+            request->appendInt32(ttl);
+            request->endl();
+        });
+    }
+
+    auto get(const std::string& key)
+    {
+        return ssdb_make_awaiter<std::string>(m_connection, [&key](SSDBProtocolRequest* request) {
+            request->appendStr("get");
+            request->appendStr(key);
+            request->endl();
+        });
+    }
+
+    auto del(const std::string& key)
+    {
+        return ssdb_make_awaiter<SSDBNone>(m_connection, [&key](SSDBProtocolRequest* request) {
+            request->appendStr("del");
+            request->appendStr(key);
+            request->endl();
+        });
+    }
+
+    auto exists(const std::string& key)
+    {
+        return ssdb_make_awaiter<int>(m_connection, [&key](SSDBProtocolRequest* request) {
+            request->appendStr("exists");
+            request->appendStr(key);
+            request->endl();
+        });
+    }
+
+    auto multi_get(const std::vector<std::string>& keys)
+    {
+        return ssdb_make_awaiter<std::map<std::string, std::string> >(m_connection, [&keys](SSDBProtocolRequest* request) {
+            request->appendStr("multi_get");
+            for (size_t i = 0; i < keys.size(); i++)
+            {
+                request->appendStr(keys[i]);
+            }
+            request->endl();
+        });
+    }
+
+    auto multi_set(const std::map<std::string, std::string>& kvs)
+    {
+        return ssdb_make_awaiter<SSDBNone>(m_connection, [&kvs](SSDBProtocolRequest* request) {
+            request->appendStr("multi_set");
+            for (std::map<std::string, std::string>::const_iterator iter = kvs.begin(); iter != kvs.end(); ++iter)
+            {
+                request->appendStr(iter->first);
+                request->appendStr(iter->second);
+            }
+            request->endl();
+        });
+    }
+
+    auto hset(const std::string& name, const std::string& key, const std::string& val)
+    {
+        return ssdb_make_awaiter<SSDBNone>(m_connection, [&name, &key, &val](SSDBProtocolRequest* request) {
+            request->appendStr("hset");
+            request->appendStr(name);
+            request->appendStr(key);
+            request->appendStr(val);
+            request->endl();
+        });
+    }
+
+    auto hget(const std::string& name, const std::string& key)
+    {
+        return ssdb_make_awaiter<std::string>(m_connection, [&name, &key](SSDBProtocolRequest* request) {
+            request->appendStr("hget");
+            request->appendStr(name);
+            request->appendStr(key);
+            request->endl();
+        });
+    }
+
+    auto multi_hget(const std::string& name, const std::vector<std::string>& keys)
+    {
+        return ssdb_make_awaiter<std::map<std::string, std::string> >(m_connection, [&name, &keys](SSDBProtocolRequest* request) {
+            request->appendStr("multi_hget");
+            request->appendStr(name);
+            for (size_t i = 0; i < keys.size(); i++)
+            {
+                request->appendStr(keys[i]);
+            }
+            request->endl();
+        });
+    }
+
+    auto zset(const std::string& name, const std::string& key, int64_t score)
+    {
+        return ssdb_make_awaiter<SSDBNone>(m_connection, [&name, &key, score](SSDBProtocolRequest* request) {
+            request->appendStr("zset");
+            request->appendStr(name);
+            request->appendStr(key);
+            request->appendInt64(score);
+            request->endl();
+        });
+    }
+
+    auto zget(const std::string& name, const std::string& key)
+    {
+        return ssdb_make_awaiter<int64_t>(m_connection, [&name, &key](SSDBProtocolRequest* request) {
+            request->appendStr("zget");
+            request->appendStr(name);
+            request->appendStr(key);
+            request->endl();
+        });
+    }
+
+    auto qpush(const std::string& name, const std::string& item)
+    {
+        return ssdb_make_awaiter<SSDBNone>(m_connection, [&name, &item](SSDBProtocolRequest* request) {
+            request->appendStr("qpush");
+            request->appendStr(name);
+            request->appendStr(item);
+            request->endl();
+        });
+    }
+
+    auto qpop(const std::string& name)
+    {
+        return ssdb_make_awaiter<std::string>(m_connection, [&name](SSDBProtocolRequest* request) {
+            request->appendStr("qpop");
+            request->appendStr(name);
+            request->endl();
+        });
+    }
+
+private:
+    SSDBAsyncConnection*    m_connection;
+};
+
+/*  最简单的协程类型: 立即开始执行, 结束后自动销毁, 不返回值.
+    已有自己协程类型的业务直接在其中co_await SSDBCoroClient的接口即可   */
+struct SSDBTask
+{
+    struct promise_type
+    {
+        SSDBTask get_return_object() noexcept
+        {
+            return SSDBTask();
+        }
+        std::suspend_never initial_suspend() noexcept
+        {
+            return std::suspend_never();
+        }
+        std::suspend_never final_suspend() noexcept
+        {
+            return std::suspend_never();
+        }
+        void return_void() noexcept
+        {
+        }
+        void unhandled_exception()
+        {
+            std::terminate();
+        }
+    };
+};
+
+#endif
+
+#endif
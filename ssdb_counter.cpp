@@ -0,0 +1,247 @@
+#include "ssdb_protocol.h"
+#include "ssdb_counter.h"
+
+static std::atomic<unsigned int> g_threadIndex(0);
+
+/*  每个线程固定使用一个cell    */
+static unsigned int thread_cell()
+{
+    static thread_local unsigned int index = g_threadIndex.fetch_add(1, std::memory_order_relaxed);
+    return index;
+}
+
+SSDBCounter::SSDBCounter(SSDBCounterType type, const std::string& name, const std::string& key) : m_base(0), m_inflight(0), m_type(type), m_name(name), m_key(key)
+{
+    for (int i = 0; i < CELL_COUNT; ++i)
+    {
+        m_cells[i].delta.store(0, std::memory_order_relaxed);
+    }
+}
+
+void SSDBCounter::add(int64_t delta)
+{
+    m_cells[thread_cell() % CELL_COUNT].delta.fetch_add(delta, std::memory_order_relaxed);
+}
+
+int64_t SSDBCounter::value() const
+{
+    int64_t value = m_base.load(std::memory_order_relaxed) + m_inflight.load(std::memory_order_relaxed);
+    for (int i = 0; i < CELL_COUNT; ++i)
+    {
+        value += m_cells[i].delta.load(std::memory_order_relaxed);
+    }
+    return value;
+}
+
+int64_t SSDBCounter::take()
+{
+    int64_t delta = 0;
+    for (int i = 0; i < CELL_COUNT; ++i)
+    {
+        delta += m_cells[i].delta.exchange(0, std::memory_order_relaxed);
+    }
+    m_inflight.fetch_add(delta, std::memory_order_relaxed);
+    return delta;
+}
+
+SSDBCounterAggregator::SSDBCounterAggregator(SSDBClient* client) : m_client(client), m_running(false)
+{
+}
+
+SSDBCounterAggregator::~SSDBCounterAggregator()
+{
+    stop();
+    flush();
+
+    for (int i = 0; i < SHARD_COUNT; ++i)
+    {
+        for (std::unordered_map<std::string, SSDBCounter*>::iterator iter = m_shards[i].counters.begin(); iter != m_shards[i].counters.end(); ++iter)
+        {
+            delete iter->second;
+        }
+    }
+}
+
+SSDBCounter* SSDBCounterAggregator::counter(const std::string& key)
+{
+    return find(SSDB_COUNTER_KV, std::string(), key);
+}
+
+SSDBCounter* SSDBCounterAggregator::hcounter(const std::string& name, const std::string& key)
+{
+    return find(SSDB_COUNTER_HASH, name, key);
+}
+
+SSDBCounter* SSDBCounterAggregator::zcounter(const std::string& name, const std::string& key)
+{
+    return find(SSDB_COUNTER_ZSET, name, key);
+}
+
+void SSDBCounterAggregator::incr(const std::string& key, int64_t delta)
+{
+    counter(key)->add(delta);
+}
+
+void SSDBCounterAggregator::hincr(const std::string& name, const std::string& key, int64_t delta)
+{
+    hcounter(name, key)->add(delta);
+}
+
+void SSDBCounterAggregator::zincr(const std::string& name, const std::string& key, int64_t delta)
+{
+    zcounter(name, key)->add(delta);
+}
+
+SSDBCounter* SSDBCounterAggregator::find(SSDBCounterType type, const std::string& name, const std::string& key)
+{
+    /*  类型 + name长度 + name + key 唯一确定一个计数器  */
+    std::string id;
+    id.reserve(name.size() + key.size() + 16);
+    id += (char)('0' + type);
+    id += std::to_string(name.size());
+    id += ':';
+    id += name;
+    id += key;
+
+    Shard& shard = m_shards[std::hash<std::string>()(id) % SHARD_COUNT];
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    SSDBCounter*& slot = shard.counters[id];
+    if (slot == NULL)
+    {
+        slot = new SSDBCounter(type, name, key);
+    }
+    return slot;
+}
+
+void SSDBCounterAggregator::start(int intervalMs)
+{
+    stop();
+    m_running = true;
+    m_thread = std::thread([this, intervalMs]() {
+        run(intervalMs);
+    });
+}
+
+void SSDBCounterAggregator::stop()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_running = false;
+    }
+    m_cond.notify_all();
+    if (m_thread.joinable())
+    {
+        m_thread.join();
+    }
+}
+
+void SSDBCounterAggregator::run(int intervalMs)
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+    while (m_running)
+    {
+        m_cond.wait_for(lock, std::chrono::milliseconds(intervalMs));
+        if (!m_running)
+        {
+            break;
+        }
+
+        lock.unlock();
+        flush();
+        lock.lock();
+    }
+}
+
+Status SSDBCounterAggregator::flush()
+{
+    std::lock_guard<std::mutex> flushLock(m_flushMutex);
+
+    Status result("ok");
+    std::vector<SSDBCounter*> batch;
+    std::vector<int64_t> deltas;
+    SSDBProtocolRequest request;
+
+    for (int i = 0; i < SHARD_COUNT; ++i)
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_shards[i].mutex);
+            for (std::unordered_map<std::string, SSDBCounter*>::iterator iter = m_shards[i].counters.begin(); iter != m_shards[i].counters.end(); ++iter)
+            {
+                int64_t delta = iter->second->take();
+                if (delta != 0)
+                {
+                    batch.push_back(iter->second);
+                    deltas.push_back(delta);
+                }
+            }
+        }
+
+        if (batch.size() < FLUSH_BATCH && i + 1 < SHARD_COUNT)
+        {
+            continue;
+        }
+
+        for (size_t begin = 0; begin < batch.size(); begin += FLUSH_BATCH)
+        {
+            size_t end = begin + FLUSH_BATCH < batch.size() ? begin + FLUSH_BATCH : batch.size();
+            request.init();
+            for (size_t j = begin; j < end; ++j)
+            {
+                SSDBCounter* counter = batch[j];
+                switch (counter->m_type)
+                {
+                case SSDB_COUNTER_KV:
+                    request.appendStr("incr");
+                    break;
+                case SSDB_COUNTER_HASH:
+                    request.appendStr("hincr");
+                    request.appendStr(counter->m_name);
+                    break;
+                case SSDB_COUNTER_ZSET:
+                    request.appendStr("zincr");
+                    request.appendStr(counter->m_name);
+                    break;
+                }
+                request.appendStr(counter->m_key);
+                request.appendInt64(deltas[j]);
+                request.endl();
+            }
+
+            std::vector<bool> replied(end - begin, false);
+            m_client->pipeline(request.getResult(), request.getResultLen(), (int)(end - begin), [&](int index, SSDBProtocolResponse* response) {
+                SSDBCounter* counter = batch[begin + index];
+                int64_t value = 0;
+                Status status = read_int64(response, &value);
+                if (status.ok())
+                {
+                    /*  服务端值已包含本次发送的增量   */
+                    counter->m_base.store(value, std::memory_order_relaxed);
+                }
+                else if (result.ok())
+                {
+                    result = status;
+                }
+                counter->m_inflight.fetch_sub(deltas[begin + index], std::memory_order_relaxed);
+                replied[index] = true;
+            });
+
+            for (size_t j = begin; j < end; ++j)
+            {
+                if (!replied[j - begin])
+                {
+                    batch[j]->m_inflight.fetch_sub(deltas[j], std::memory_order_relaxed);
+                    batch[j]->add(deltas[j]);
+                    if (result.ok())
+                    {
+                        result = Status("error");
+                    }
+                }
+            }
+        }
+
+        batch.clear();
+        deltas.clear();
+    }
+
+    return result;
+}
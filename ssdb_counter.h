@@ -0,0 +1,128 @@
+#ifndef __SSDB_COUNTER_H__
+#define __SSDB_COUNTER_H__
+
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <mutex>
+#include <thread>
+#include <atomic>
+#include <condition_variable>
+
+#include "ssdb_client.h"
+
+/*  计数器聚合: 多个线程对同一计数器的增量先在本地累加, 由flush以pipeline的incr/hincr/zincr批量发送.
+    -   每个计数器分为若干cache line对齐的cell, 不同线程累加到不同cell(无锁, 不争用同一cache line)
+    -   计数器按key哈希分布在多个shard中, 只有第一次访问某个计数器时需要加shard锁
+    -   value()返回最近一次flush得到的服务端值加上尚未发送的增量(近似值)
+    -   flush时收不到response的增量会加回计数器, 下次重发(服务端可能已经执行, 此时会重复计数)
+
+    SSDBCounterAggregator aggregator(&client);      // client只供aggregator使用
+    aggregator.start(100);                          // 每100ms flush一次
+    aggregator.incr("views", 1);                    // 任意线程
+    SSDBCounter* likes = aggregator.hcounter("likes", "post:1");
+    likes->add(1);                                  // 热点计数器保存句柄, 省去查找   */
+
+enum SSDBCounterType
+{
+    SSDB_COUNTER_KV,
+    SSDB_COUNTER_HASH,
+    SSDB_COUNTER_ZSET,
+};
+
+class SSDBCounter
+{
+public:
+    /*  线程安全, 无锁  */
+    void                    add(int64_t delta);
+    int64_t                 value() const;
+
+private:
+    friend class SSDBCounterAggregator;
+
+    SSDBCounter(SSDBCounterType type, const std::string& name, const std::string& key);
+    SSDBCounter(const SSDBCounter&);
+    void operator=(const SSDBCounter&);
+
+    /*  取出并清零所有cell中的增量, 计入m_inflight直到收到response  */
+    int64_t                 take();
+
+private:
+    enum
+    {
+        CELL_COUNT = 4,
+    };
+
+    struct alignas(64) Cell
+    {
+        std::atomic<int64_t>    delta;
+    };
+
+    Cell                    m_cells[CELL_COUNT];
+    /*  最近一次flush得到的服务端值  */
+    std::atomic<int64_t>    m_base;
+    /*  已发送但尚未收到response的增量    */
+    std::atomic<int64_t>    m_inflight;
+
+    SSDBCounterType         m_type;
+    std::string             m_name;
+    std::string             m_key;
+};
+
+class SSDBCounterAggregator
+{
+public:
+    explicit SSDBCounterAggregator(SSDBClient* client);
+    /*  停止flush线程并最后flush一次  */
+    ~SSDBCounterAggregator();
+
+    /*  以下均线程安全, 返回的计数器在aggregator生命期内有效  */
+    SSDBCounter*            counter(const std::string& key);
+    SSDBCounter*            hcounter(const std::string& name, const std::string& key);
+    SSDBCounter*            zcounter(const std::string& name, const std::string& key);
+
+    void                    incr(const std::string& key, int64_t delta);
+    void                    hincr(const std::string& name, const std::string& key, int64_t delta);
+    void                    zincr(const std::string& name, const std::string& key, int64_t delta);
+
+    /*  启动后台线程, 每intervalMs毫秒flush一次   */
+    void                    start(int intervalMs);
+    void                    stop();
+
+    /*  发送所有未发送的增量, 可与add并发调用, 返回第一个失败的状态   */
+    Status                  flush();
+
+private:
+    SSDBCounterAggregator(const SSDBCounterAggregator&);
+    void operator=(const SSDBCounterAggregator&);
+
+    SSDBCounter*            find(SSDBCounterType type, const std::string& name, const std::string& key);
+    void                    run(int intervalMs);
+
+private:
+    enum
+    {
+        SHARD_COUNT = 64,
+        /*  每次pipeline发送的最大命令数   */
+        FLUSH_BATCH = 1024,
+    };
+
+    struct Shard
+    {
+        std::mutex                                      mutex;
+        std::unordered_map<std::string, SSDBCounter*>   counters;
+    };
+
+    SSDBClient*             m_client;
+    Shard                   m_shards[SHARD_COUNT];
+
+    /*  同一时间只有一个flush使用m_client  */
+    std::mutex              m_flushMutex;
+
+    std::thread             m_thread;
+    std::mutex              m_mutex;
+    std::condition_variable m_cond;
+    bool                    m_running;
+};
+
+#endif
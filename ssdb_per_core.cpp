@@ -0,0 +1,172 @@
+#include "platform.h"
+
+#if defined PLATFORM_WINDOWS
+#include <windows.h>
+#else
+#include <sched.h>
+#include <dirent.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#endif
+
+#include <map>
+#include <thread>
+
+#include "ssdb_reactor.h"
+#include "ssdb_per_core.h"
+
+static std::atomic<size_t> g_managerId(0);
+
+/*  本线程是否已按各manager的pinThreads绑定过cpu, 以manager的m_id为下标   */
+static thread_local std::vector<char> t_pinned;
+
+static size_t core_slots()
+{
+    unsigned int count = std::thread::hardware_concurrency();
+    return count > 0 ? count : 1;
+}
+
+SSDBPerCoreClients::SSDBPerCoreClients(const std::string& ip, int port, const SSDBPerCoreOptions& options) :
+    m_id(g_managerId.fetch_add(1, std::memory_order_relaxed)), m_ip(ip), m_port(port), m_options(options), m_cores(core_slots())
+{
+    for (size_t i = 0; i < m_cores.size(); ++i)
+    {
+        m_cores[i].store(NULL, std::memory_order_relaxed);
+    }
+}
+
+SSDBPerCoreClients::~SSDBPerCoreClients()
+{
+    for (size_t i = 0; i < m_instances.size(); ++i)
+    {
+        delete m_instances[i]->client;
+        delete m_instances[i];
+    }
+}
+
+SSDBCoreInstance* SSDBPerCoreClients::localInstance()
+{
+    if (m_options.pinThreads && (m_id >= t_pinned.size() || !t_pinned[m_id]))
+    {
+        if (m_id >= t_pinned.size())
+        {
+            t_pinned.resize(m_id + 1, 0);
+        }
+        ssdb_thread_bind_cpu(currentCpu());
+        t_pinned[m_id] = 1;
+    }
+
+    /*  每次调用都重新取cpu, 线程迁移后使用新cpu的client  */
+    int cpu = currentCpu();
+    size_t slot = (size_t)cpu % m_cores.size();
+    SSDBCoreInstance* instance = m_cores[slot].load(std::memory_order_acquire);
+    return instance != NULL ? instance : createInstance(slot, cpu);
+}
+
+SSDBCoreInstance* SSDBPerCoreClients::createInstance(size_t slot, int cpu)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    SSDBCoreInstance* instance = m_cores[slot].load(std::memory_order_acquire);
+    if (instance != NULL)
+    {
+        return instance;
+    }
+
+    /*  在该cpu上分配client, 绑定时内存按first-touch落在本地NUMA节点  */
+    instance = new SSDBCoreInstance(cpu, cpuNode(cpu));
+    instance->client = new SSDBClient();
+    if (m_options.requestTimeoutUs > 0)
+    {
+        instance->client->setRequestTimeout(m_options.requestTimeoutUs);
+    }
+    instance->client->connect(m_ip.c_str(), m_port, m_options.timeoutSec);
+
+    m_instances.push_back(instance);
+    m_cores[slot].store(instance, std::memory_order_release);
+    return instance;
+}
+
+static void add_metrics(SSDBCoreMetrics* metrics, const SSDBCoreInstance* instance)
+{
+    metrics->clients += 1;
+    metrics->requests += instance->requests.load(std::memory_order_relaxed);
+    metrics->errors += instance->errors.load(std::memory_order_relaxed);
+    metrics->totalLatencyUs += instance->totalLatencyUs.load(std::memory_order_relaxed);
+    uint64_t maxLatencyUs = instance->maxLatencyUs.load(std::memory_order_relaxed);
+    metrics->maxLatencyUs = maxLatencyUs > metrics->maxLatencyUs ? maxLatencyUs : metrics->maxLatencyUs;
+}
+
+SSDBCoreMetrics SSDBPerCoreClients::metrics() const
+{
+    SSDBCoreMetrics metrics;
+    std::lock_guard<std::mutex> lock(m_mutex);
+    for (size_t i = 0; i < m_instances.size(); ++i)
+    {
+        add_metrics(&metrics, m_instances[i]);
+    }
+    return metrics;
+}
+
+std::vector<SSDBCoreMetrics> SSDBPerCoreClients::coreMetrics() const
+{
+    std::map<int, SSDBCoreMetrics> cores;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        for (size_t i = 0; i < m_instances.size(); ++i)
+        {
+            SSDBCoreMetrics& metrics = cores[m_instances[i]->cpu];
+            metrics.cpu = m_instances[i]->cpu;
+            metrics.node = m_instances[i]->node;
+            add_metrics(&metrics, m_instances[i]);
+        }
+    }
+
+    std::vector<SSDBCoreMetrics> result;
+    for (std::map<int, SSDBCoreMetrics>::iterator iter = cores.begin(); iter != cores.end(); ++iter)
+    {
+        result.push_back(iter->second);
+    }
+    return result;
+}
+
+int SSDBPerCoreClients::currentCpu()
+{
+#if defined PLATFORM_WINDOWS
+    return (int)GetCurrentProcessorNumber();
+#elif defined __linux__
+    int cpu = sched_getcpu();
+    return cpu >= 0 ? cpu : 0;
+#else
+    return 0;
+#endif
+}
+
+int SSDBPerCoreClients::cpuNode(int cpu)
+{
+#if defined __linux__
+    /*  /sys/devices/system/cpu/cpuN/下有名为nodeM的链接    */
+    char path[64];
+    snprintf(path, sizeof(path), "/sys/devices/system/cpu/cpu%d", cpu);
+    DIR* dir = opendir(path);
+    if (dir == NULL)
+    {
+        return -1;
+    }
+
+    int node = -1;
+    struct dirent* entry = NULL;
+    while (node < 0 && (entry = readdir(dir)) != NULL)
+    {
+        if (strncmp(entry->d_name, "node", 4) == 0 && entry->d_name[4] >= '0' && entry->d_name[4] <= '9')
+        {
+            node = atoi(entry->d_name + 4);
+        }
+    }
+    closedir(dir);
+    return node;
+#else
+    (void)cpu;
+    return -1;
+#endif
+}
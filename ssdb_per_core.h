@@ -0,0 +1,137 @@
+#ifndef __SSDB_PER_CORE_H__
+#define __SSDB_PER_CORE_H__
+
+#include <string>
+#include <vector>
+#include <mutex>
+#include <atomic>
+#include <chrono>
+
+#include "ssdb_client.h"
+
+/*  按核心分片的client: 每次调用都取当前线程所在的cpu, 使用该cpu的client, 线程迁移后随之换到新cpu的client.
+    某个cpu的client在该cpu上第一次调用时创建, pinThreads时调用线程先绑定到该cpu, client的socket与收发缓冲区
+    按首次访问(first-touch)落在该cpu的NUMA节点上; 不绑定时线程可能在创建途中迁移, 不保证NUMA本地.
+    -   每个cpu的client各有一把锁, 调用线程数不超过cpu数且各在不同cpu上时不会竞争
+    -   创建client时需要加锁登记, metrics()汇总时只读取各client的原子计数
+    -   client保留到manager析构, 调用call的线程须在manager析构前结束
+
+    SSDBPerCoreClients clients("127.0.0.1", 8888);
+    // 任意线程
+    std::string value;
+    Status s = clients.call([&](SSDBClient& client) {
+        return client.get("key", &value);
+    });     */
+
+struct SSDBPerCoreOptions
+{
+    SSDBPerCoreOptions() : pinThreads(false), timeoutSec(5), requestTimeoutUs(0)
+    {
+    }
+
+    /*  把调用线程绑定到第一次调用时所在的cpu. 默认false不修改应用线程的亲和性, 每次调用按当时的cpu选择client;
+        同一父线程创建的线程常在同一个cpu上开始运行, 开启前应由应用先把各线程分散到不同的cpu   */
+    bool                    pinThreads;
+    uint32_t                timeoutSec;
+    int64_t                 requestTimeoutUs;
+};
+
+/*  cpu为-1表示所有核心的汇总   */
+struct SSDBCoreMetrics
+{
+    SSDBCoreMetrics() : cpu(-1), node(-1), clients(0), requests(0), errors(0), totalLatencyUs(0), maxLatencyUs(0)
+    {
+    }
+
+    int                     cpu;
+    int                     node;
+    int                     clients;
+    uint64_t                requests;
+    uint64_t                errors;
+    uint64_t                totalLatencyUs;
+    uint64_t                maxLatencyUs;
+};
+
+/*  一个cpu的client与它的计数, 都只在持有mutex时写入  */
+struct alignas(64) SSDBCoreInstance
+{
+    SSDBCoreInstance(int cpu_, int node_) : client(NULL), cpu(cpu_), node(node_), requests(0), errors(0), totalLatencyUs(0), maxLatencyUs(0)
+    {
+    }
+
+    void                    record(bool ok, uint64_t latencyUs)
+    {
+        requests.store(requests.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+        if (!ok)
+        {
+            errors.store(errors.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+        }
+        totalLatencyUs.store(totalLatencyUs.load(std::memory_order_relaxed) + latencyUs, std::memory_order_relaxed);
+        if (latencyUs > maxLatencyUs.load(std::memory_order_relaxed))
+        {
+            maxLatencyUs.store(latencyUs, std::memory_order_relaxed);
+        }
+    }
+
+    std::mutex              mutex;
+    SSDBClient*             client;
+    int                     cpu;
+    int                     node;
+    std::atomic<uint64_t>   requests;
+    std::atomic<uint64_t>   errors;
+    std::atomic<uint64_t>   totalLatencyUs;
+    std::atomic<uint64_t>   maxLatencyUs;
+};
+
+class SSDBPerCoreClients
+{
+public:
+    SSDBPerCoreClients(const std::string& ip, int port, const SSDBPerCoreOptions& options = SSDBPerCoreOptions());
+    ~SSDBPerCoreClients();
+
+    /*  用当前cpu的client执行f(SSDBClient&)并计入metrics, f返回Status, 执行期间持有该client的锁  */
+    template<typename F>
+    Status                  call(const F& f)
+    {
+        SSDBCoreInstance* instance = localInstance();
+        std::lock_guard<std::mutex> lock(instance->mutex);
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        Status status = f(*instance->client);
+        uint64_t latencyUs = (uint64_t)std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count();
+        /*  not_found是正常结果, 不计为错误  */
+        instance->record(status.ok() || status.not_found(), latencyUs);
+        return status;
+    }
+
+    /*  所有client的汇总  */
+    SSDBCoreMetrics         metrics() const;
+    /*  按cpu汇总, 只包含有client的cpu  */
+    std::vector<SSDBCoreMetrics> coreMetrics() const;
+
+    /*  当前线程所在的cpu, 无法获取时返回0   */
+    static int              currentCpu();
+    /*  cpu所在的NUMA节点, 无法获取时返回-1 */
+    static int              cpuNode(int cpu);
+
+private:
+    SSDBPerCoreClients(const SSDBPerCoreClients&);
+    void operator=(const SSDBPerCoreClients&);
+
+    SSDBCoreInstance*       localInstance();
+    SSDBCoreInstance*       createInstance(size_t slot, int cpu);
+
+private:
+    /*  thread_local绑定标记中的下标, 每个manager唯一, 不会重复使用   */
+    size_t                          m_id;
+    std::string                     m_ip;
+    int                             m_port;
+    SSDBPerCoreOptions              m_options;
+
+    /*  以cpu编号(对槽数取模)为下标, 创建后不再改变, 读取不加锁    */
+    std::vector<std::atomic<SSDBCoreInstance*>> m_cores;
+
+    mutable std::mutex              m_mutex;
+    std::vector<SSDBCoreInstance*>  m_instances;
+};
+
+#endif
@@ -0,0 +1,176 @@
+#include "ssdb_protocol.h"
+
+using namespace std;
+
+Status read_list(SSDBProtocolResponse *response, std::vector<std::string> *ret)
+{
+    Status status = response->getStatus();
+    if(status.ok())
+    {
+        for (size_t i = 1; i < response->getBuffersLen(); ++i)
+        {
+            Bytes* buffer = response->getByIndex(i);
+			ret->push_back(std::string(buffer->buffer, buffer->len));
+        }
+    }
+
+    return status;
+}
+
+Status read_map(SSDBProtocolResponse *response, std::map<std::string, std::string> *ret)
+{
+	Status s = response->getStatus();
+	if (s.ok())
+	{
+		for (size_t i = 1; i < response->getBuffersLen(); i += 2)
+		{
+			Bytes *key = response->getByIndex(i);
+			Bytes *value = response->getByIndex(i+1);
+			ret->insert(std::make_pair(std::string(key->buffer, key->len), std::string(value->buffer, value->len)));
+		}
+	}
+	return s;
+}
+
+Status read_int64(SSDBProtocolResponse *response, int64_t *ret)
+{
+    Status status = response->getStatus();
+    if(status.ok())
+    {
+        if(response->getBuffersLen() >= 2)
+        {
+            Bytes* buf = response->getByIndex(1);
+            string temp(buf->buffer, buf->len);
+            sscanf(temp.c_str(), "%lld",ret);
+        }
+        else
+        {
+            status = Status("server_error");
+        }
+    }
+
+    return status;
+}
+
+Status read_int(SSDBProtocolResponse *response, int *ret)
+{
+	Status s = response->getStatus();
+	if (s.ok())
+	{
+		if (response->getBuffersLen() >= 2)
+		{
+			Bytes* buf = response->getByIndex(1);
+			string temp(buf->buffer, buf->len);
+			sscanf(temp.c_str(), "%d", ret);
+		}
+		else
+		{
+			s = Status("server_error");
+		}
+	}
+	return s;
+}
+
+Status read_str(SSDBProtocolResponse *response, std::string *ret)
+{
+    Status status = response->getStatus();
+    if(status.ok())
+    {
+        if(response->getBuffersLen() >= 2)
+        {
+            Bytes* buf = response->getByIndex(1);
+            *ret = string(buf->buffer, buf->len);
+        }
+        else
+        {
+            status = Status("server_error");
+        }
+    }
+
+    return status;
+}
+
+Status read_pairs(SSDBProtocolResponse *response, const SSDBPairVisitor& visitor)
+{
+    Status status = response->getStatus();
+    if (status.ok())
+    {
+        size_t count = response->getBuffersLen();
+        if (count % 2 == 0)
+        {
+            return Status("server_error");
+        }
+
+        for (size_t i = 1; i < count; i += 2)
+        {
+            Bytes* key = response->getByIndex(i);
+            Bytes* value = response->getByIndex(i + 1);
+            visitor(key->buffer, key->len, value->buffer, value->len);
+        }
+    }
+
+    return status;
+}
+
+/*  解析十进制整数, buffer不以'\0'结尾   */
+static bool parse_int64(const char* buffer, int len, int64_t* ret)
+{
+    const char* current = buffer;
+    const char* end = buffer + len;
+    bool negative = current < end && *current == '-';
+    if (negative || (current < end && *current == '+'))
+    {
+        ++current;
+    }
+    if (current == end)
+    {
+        return false;
+    }
+
+    uint64_t value = 0;
+    for (; current < end; ++current)
+    {
+        if (*current < '0' || *current > '9')
+        {
+            return false;
+        }
+        value = value * 10 + (uint64_t)(*current - '0');
+    }
+    *ret = negative ? (int64_t)(0 - value) : (int64_t)value;
+    return true;
+}
+
+Status read_zset(SSDBProtocolResponse *response, SSDBZsetResult *ret)
+{
+    Status status = response->getStatus();
+    if (status.ok())
+    {
+        size_t count = response->getBuffersLen();
+        if (count % 2 == 0)
+        {
+            return Status("server_error");
+        }
+
+        /*  先统计member总长度, 一次预留好空间    */
+        size_t bytes = 0;
+        for (size_t i = 1; i < count; i += 2)
+        {
+            bytes += response->getByIndex(i)->len;
+        }
+        ret->reserve(count / 2, bytes);
+
+        for (size_t i = 1; i < count; i += 2)
+        {
+            Bytes* key = response->getByIndex(i);
+            Bytes* score = response->getByIndex(i + 1);
+            int64_t value = 0;
+            if (!parse_int64(score->buffer, score->len, &value))
+            {
+                return Status("server_error");
+            }
+            ret->append(key->buffer, key->len, value);
+        }
+    }
+
+    return status;
+}
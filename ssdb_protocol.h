@@ -0,0 +1,360 @@
+#ifndef __SSDB_PROTOCOL_H__
+#define __SSDB_PROTOCOL_H__
+
+#include <vector>
+#include <string>
+#include <map>
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "platform.h"
+#include "buffer.h"
+#include "ssdb_client.h"
+
+#if defined PLATFORM_WINDOWS
+#define snprintf _snprintf 
+#endif
+
+/*  ssdb协议编解码, 供SSDBClient以及benchmark使用  */
+
+#define DEFAULT_SSDBPROTOCOL_LEN 1024
+
+class SSDBProtocolRequest
+{
+public:
+    SSDBProtocolRequest()
+    {
+        m_request = ox_buffer_new(DEFAULT_SSDBPROTOCOL_LEN);
+    }
+
+    ~SSDBProtocolRequest()
+    {
+        ox_buffer_delete(m_request);
+        m_request = NULL;
+    }
+
+    /*  编码后的长度: 长度\n数据\n  */
+    static int encodedLen(int len)
+    {
+        return decimalLen((uint64_t)len) + len + 2;
+    }
+
+    static int decimalLen(uint64_t val)
+    {
+        int len = 1;
+        while (val >= 100)
+        {
+            val /= 100;
+            len += 2;
+        }
+        return val >= 10 ? len + 1 : len;
+    }
+
+    static int int64Len(int64_t val)
+    {
+        return val < 0 ? decimalLen(0 - (uint64_t)val) + 1 : decimalLen((uint64_t)val);
+    }
+
+    /*  把val的十进制写入buffer(不以'\0'结尾), 返回长度   */
+    static int formatUint64(char* buffer, uint64_t val)
+    {
+        static const char DIGIT_PAIRS[] =
+            "00010203040506070809101112131415161718192021222324252627282930313233343536373839"
+            "40414243444546474849505152535455565758596061626364656667686970717273747576777879"
+            "8081828384858687888990919293949596979899";
+
+        int len = decimalLen(val);
+        char* current = buffer + len;
+        while (val >= 100)
+        {
+            const char* pair = DIGIT_PAIRS + (val % 100) * 2;
+            val /= 100;
+            *--current = pair[1];
+            *--current = pair[0];
+        }
+        if (val >= 10)
+        {
+            *--current = DIGIT_PAIRS[val * 2 + 1];
+            *--current = DIGIT_PAIRS[val * 2];
+        }
+        else
+        {
+            *--current = (char)('0' + val);
+        }
+        return len;
+    }
+
+    static int formatInt64(char* buffer, int64_t val)
+    {
+        if (val < 0)
+        {
+            *buffer = '-';
+            return formatUint64(buffer + 1, 0 - (uint64_t)val) + 1;
+        }
+        return formatUint64(buffer, (uint64_t)val);
+    }
+
+    /*  预留至少len字节的可写空间, 之后写入len字节以内不会再扩容  */
+    void reserve(int len)
+    {
+        if (ox_buffer_getwritevalidcount(m_request) < len)
+        {
+            grow(len);
+        }
+    }
+
+    /*  一次写入: 长度\n数据\n   */
+    void append(const char* data, int len)
+    {
+        int total = encodedLen(len);
+        reserve(total);
+
+        char* current = ox_buffer_getwriteptr(m_request);
+        current += formatUint64(current, (uint64_t)len);
+        *current++ = '\n';
+        memcpy(current, data, len);
+        current[len] = '\n';
+        ox_buffer_addwritepos(m_request, total);
+    }
+
+    void appendStr(const char* str)
+    {
+        append(str, (int)strlen(str));
+    }
+
+    void appendStr(const std::string& str)
+    {
+        append(str.data(), (int)str.size());
+    }
+
+    void appendInt64(int64_t val)
+    {
+        char str[24];
+        append(str, formatInt64(str, val));
+    }
+
+    void appendUint64(uint64_t val)
+    {
+        char str[24];
+        append(str, formatUint64(str, val));
+    }
+
+    void appendInt32(int val)
+    {
+        appendInt64(val);
+    }
+
+    void endl()
+    {
+        appendBlock("\n", 1);
+    }
+
+    void appendBlock(const char* data, int len)
+    {
+        if (len > 0)
+        {
+            reserve(len);
+            ox_buffer_write(m_request, data, len);
+        }
+    }
+
+    const char* getResult()
+    {
+        return ox_buffer_getreadptr(m_request);
+    }
+    int getResultLen()
+    {
+        return ox_buffer_getreadvalidcount(m_request);
+    }
+
+    void init()
+    {
+        ox_buffer_init(m_request);
+    }
+
+    /*  丢弃头部已发送的len字节, 全部发送完毕则重置   */
+    void consume(int len)
+    {
+        ox_buffer_addreadpos(m_request, len);
+        if (ox_buffer_getreadvalidcount(m_request) == 0)
+        {
+            init();
+        }
+    }
+private:
+    /*  按两倍扩容, 连续append的总拷贝量为O(n)   */
+    void grow(int len)
+    {
+        int used = ox_buffer_getreadvalidcount(m_request);
+        int size = ox_buffer_getsize(m_request) * 2;
+        size = size >= used + len ? size : used + len;
+
+        buffer_s* temp = ox_buffer_new(size);
+        if (used > 0)
+        {
+            memcpy(ox_buffer_getwriteptr(temp), ox_buffer_getreadptr(m_request), used);
+            ox_buffer_addwritepos(temp, used);
+        }
+        ox_buffer_delete(m_request);
+        m_request = temp;
+    }
+
+private:
+    buffer_s*   m_request;
+};
+
+struct Bytes
+{
+    const char* buffer;
+    int len;
+};
+
+class SSDBProtocolResponse
+{
+public:
+    SSDBProtocolResponse() : mError(NULL)
+    {
+    }
+
+    ~SSDBProtocolResponse()
+    {
+    }
+
+    void init()
+    {
+        mBuffers.clear();
+        mError = NULL;
+    }
+
+    /*  没有收到response时(如请求超时)getStatus返回的code, 默认为"error" */
+    void setError(const char* code)
+    {
+        mError = code;
+    }
+
+    void parse(const char* buffer, int len)
+    {
+        const char* current = buffer;
+        while (true)
+        {
+            char* temp;
+            int datasize = strtol(current, &temp, 10);
+            current = temp;
+            current += 1;
+            Bytes tmp = { current, datasize };
+            mBuffers.push_back(tmp);
+            current += datasize;
+
+            current += 1;
+
+            if (*current == '\n')
+            {
+                /*  收到完整消息,ok  */
+                current += 1;         /*  跳过\n    */
+                break;
+            }
+        }
+    }
+
+    Bytes* getByIndex(size_t index)
+    {
+        if(mBuffers.size() > index)
+        {
+            return &mBuffers[index];
+        }
+        else
+        {
+            const char* nullstr = "null";
+            static  Bytes nullbuffer = { nullstr, (int)strlen(nullstr)+1 };
+            return &nullbuffer;
+        }
+    }
+
+    size_t getBuffersLen() const
+    {
+        return mBuffers.size();
+    }
+
+    Status getStatus()
+    {
+        if(mBuffers.empty())
+        {
+            return Status(mError != NULL ? mError : "error");
+        }
+
+        return std::string(mBuffers[0].buffer, mBuffers[0].len);
+    }
+
+    static int check_ssdb_packet(const char* buffer, int len)
+    {
+        if (buffer == NULL || len <= 0)
+        {
+            return 0;
+        }
+
+        const char* end = buffer + len; /*  无效内存地址  */
+        const char* current = buffer;   /*  当前解析位置*/
+
+        while (true)
+        {
+            /*  buffer不以'\0'结尾, 不能使用strtol  */
+            const char* temp = current;
+            int datasize = 0;
+            while (temp < end && *temp >= '0' && *temp <= '9')
+            {
+                datasize = datasize * 10 + (*temp - '0');
+                ++temp;
+            }
+            if (temp == current)
+            {
+                break;
+            }
+            current = temp;         /*  跳过datasize*/
+
+            if (current >= end || *current != '\n')
+            {
+                break;
+            }
+            current += 1;         /*  跳过\n    */
+            current += datasize;  /*  跳过data  */
+
+            if (current >= end || *current != '\n')
+            {
+                break;
+            }
+
+            current += 1;         /*  跳过\n    */
+
+            if (current >= end)
+            {
+                break;
+            }
+            else if(*current == '\n')
+            {
+                /*  收到完整消息,ok  */
+                current += 1;         /*  跳过\n    */
+                return (int)(current - buffer);
+            }
+        }
+
+        /*  非完整消息返回0  */
+        return 0;
+    }
+
+private:
+    std::vector<Bytes>   mBuffers;
+    const char*          mError;
+};
+
+Status read_list(SSDBProtocolResponse *response, std::vector<std::string> *ret);
+Status read_map(SSDBProtocolResponse *response, std::map<std::string, std::string> *ret);
+Status read_int64(SSDBProtocolResponse *response, int64_t *ret);
+Status read_int(SSDBProtocolResponse *response, int *ret);
+Status read_str(SSDBProtocolResponse *response, std::string *ret);
+/*  依次把(key, value)对交给visitor  */
+Status read_pairs(SSDBProtocolResponse *response, const SSDBPairVisitor& visitor);
+/*  把(member, score)对追加到ret   */
+Status read_zset(SSDBProtocolResponse *response, SSDBZsetResult *ret);
+
+#endif
@@ -0,0 +1,205 @@
+#include "ssdb_protocol.h"
+#include "ssdb_queue_consumer.h"
+
+SSDBQueueConsumer::SSDBQueueConsumer(SSDBClient* client, const std::string& name, const SSDBQueueConsumerOptions& options) :
+    m_client(client), m_name(name), m_options(options), m_running(false), m_fetching(false), m_error("ok")
+{
+    m_options.batchSize = m_options.batchSize > 0 ? m_options.batchSize : 1;
+    m_options.pipelineDepth = m_options.pipelineDepth > 0 ? m_options.pipelineDepth : 1;
+    m_options.capacity = m_options.capacity > 0 ? m_options.capacity : 1;
+    m_options.lowWater = m_options.lowWater < m_options.capacity ? m_options.lowWater : m_options.capacity;
+    m_options.minBackoffMs = m_options.minBackoffMs > 0 ? m_options.minBackoffMs : 1;
+    m_options.maxBackoffMs = m_options.maxBackoffMs > m_options.minBackoffMs ? m_options.maxBackoffMs : m_options.minBackoffMs;
+}
+
+SSDBQueueConsumer::~SSDBQueueConsumer()
+{
+    stop();
+}
+
+void SSDBQueueConsumer::start()
+{
+    stop();
+    m_running = true;
+    m_thread = std::thread([this]() {
+        run();
+    });
+}
+
+void SSDBQueueConsumer::stop()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_running = false;
+    }
+    m_refill.notify_all();
+    m_readable.notify_all();
+    if (m_thread.joinable())
+    {
+        m_thread.join();
+    }
+}
+
+bool SSDBQueueConsumer::waitItems(std::unique_lock<std::mutex>& lock, int timeoutMs)
+{
+    if (m_items.empty() && m_running && timeoutMs != 0)
+    {
+        auto ready = [this]() {
+            return !m_items.empty() || !m_running;
+        };
+        if (timeoutMs < 0)
+        {
+            m_readable.wait(lock, ready);
+        }
+        else
+        {
+            m_readable.wait_for(lock, std::chrono::milliseconds(timeoutMs), ready);
+        }
+    }
+
+    return !m_items.empty();
+}
+
+bool SSDBQueueConsumer::pop(std::string* item, int timeoutMs)
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+    if (!waitItems(lock, timeoutMs))
+    {
+        return false;
+    }
+
+    item->swap(m_items.front());
+    m_items.pop_front();
+    if (m_items.size() < m_options.lowWater && !m_fetching)
+    {
+        m_refill.notify_one();
+    }
+    return true;
+}
+
+size_t SSDBQueueConsumer::pop(std::vector<std::string>* items, size_t max, int timeoutMs)
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+    if (max == 0 || !waitItems(lock, timeoutMs))
+    {
+        return 0;
+    }
+
+    size_t count = m_items.size() < max ? m_items.size() : max;
+    for (size_t i = 0; i < count; ++i)
+    {
+        items->push_back(std::move(m_items.front()));
+        m_items.pop_front();
+    }
+    if (m_items.size() < m_options.lowWater && !m_fetching)
+    {
+        m_refill.notify_one();
+    }
+    return count;
+}
+
+size_t SSDBQueueConsumer::drain(std::vector<std::string>* items)
+{
+    return pop(items, (size_t)-1, 0);
+}
+
+size_t SSDBQueueConsumer::buffered() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_items.size();
+}
+
+Status SSDBQueueConsumer::lastError() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_error;
+}
+
+void SSDBQueueConsumer::run()
+{
+    std::vector<std::string> fetched;
+    int backoffMs = 0;
+
+    std::unique_lock<std::mutex> lock(m_mutex);
+    while (m_running)
+    {
+        if (m_items.size() >= m_options.lowWater)
+        {
+            m_refill.wait(lock, [this]() {
+                return m_items.size() < m_options.lowWater || !m_running;
+            });
+            continue;
+        }
+
+        size_t want = m_options.capacity - m_items.size();
+        m_fetching = true;
+        lock.unlock();
+        fetch(want, &fetched);
+        lock.lock();
+        m_fetching = false;
+
+        if (!fetched.empty())
+        {
+            for (size_t i = 0; i < fetched.size(); ++i)
+            {
+                m_items.push_back(std::move(fetched[i]));
+            }
+            fetched.clear();
+            m_readable.notify_all();
+            backoffMs = 0;
+        }
+        else
+        {
+            /*  队列为空或请求失败: 退避, 只有stop能提前唤醒   */
+            backoffMs = backoffMs == 0 ? m_options.minBackoffMs : backoffMs * 2;
+            backoffMs = backoffMs < m_options.maxBackoffMs ? backoffMs : m_options.maxBackoffMs;
+            m_refill.wait_for(lock, std::chrono::milliseconds(backoffMs), [this]() {
+                return !m_running;
+            });
+        }
+    }
+}
+
+bool SSDBQueueConsumer::fetch(size_t want, std::vector<std::string>* items)
+{
+    SSDBProtocolRequest request;
+    int count = 0;
+    while (want > 0 && count < m_options.pipelineDepth)
+    {
+        size_t batch = want < (size_t)m_options.batchSize ? want : (size_t)m_options.batchSize;
+        request.appendStr("qpop");
+        request.appendStr(m_name);
+        request.appendInt64((int64_t)batch);
+        request.endl();
+        want -= batch;
+        ++count;
+    }
+
+    Status error("ok");
+    int done = m_client->pipeline(request.getResult(), request.getResultLen(), count, [&](int, SSDBProtocolResponse* response) {
+        Status status = response->getStatus();
+        if (status.ok())
+        {
+            for (size_t i = 1; i < response->getBuffersLen(); ++i)
+            {
+                Bytes* buffer = response->getByIndex(i);
+                items->push_back(std::string(buffer->buffer, buffer->len));
+            }
+        }
+        else if (!status.not_found() && error.ok())
+        {
+            error = status;
+        }
+    });
+    if (done < count && error.ok())
+    {
+        error = Status("error");
+    }
+
+    if (!error.ok())
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_error = error;
+    }
+    return error.ok();
+}
@@ -0,0 +1,86 @@
+#ifndef __SSDB_QUEUE_CONSUMER_H__
+#define __SSDB_QUEUE_CONSUMER_H__
+
+#include <string>
+#include <vector>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <condition_variable>
+
+#include "ssdb_client.h"
+
+/*  队列消费者: 后台线程以pipeline的批量qpop预取队列中的条目到本地缓冲, pop直接从本地缓冲取出.
+    -   本地缓冲少于lowWater条时补充, 最多补充到capacity条
+    -   队列为空(或请求失败)时后台线程按指数退避等待, 取到条目后复位
+    -   条目在预取时已从服务端队列移除: stop后未被pop的条目留在本地缓冲, 需要时用drain取回;
+        pipeline过程中连接断开时, 已出队但未收到的条目会丢失
+
+    SSDBQueueConsumer consumer(&client, "jobs");    // client只供consumer使用
+    consumer.start();
+    std::string job;
+    while (consumer.pop(&job, 1000)) { ... }    // 任意线程    */
+
+struct SSDBQueueConsumerOptions
+{
+    SSDBQueueConsumerOptions() : batchSize(256), pipelineDepth(4), lowWater(512), capacity(4096), minBackoffMs(1), maxBackoffMs(200)
+    {
+    }
+
+    /*  每个qpop命令取出的最大条数, 每次pipeline最多发送的qpop命令数    */
+    int                     batchSize;
+    int                     pipelineDepth;
+    size_t                  lowWater;
+    size_t                  capacity;
+    int                     minBackoffMs;
+    int                     maxBackoffMs;
+};
+
+class SSDBQueueConsumer
+{
+public:
+    SSDBQueueConsumer(SSDBClient* client, const std::string& name, const SSDBQueueConsumerOptions& options = SSDBQueueConsumerOptions());
+    ~SSDBQueueConsumer();
+
+    void                    start();
+    void                    stop();
+
+    /*  以下均线程安全. 本地缓冲为空时最多等待timeoutMs毫秒(<0表示一直等待), 未启动时不等待  */
+    bool                    pop(std::string* item, int timeoutMs);
+    /*  一次取出最多max条追加到items, 返回取出的条数    */
+    size_t                  pop(std::vector<std::string>* items, size_t max, int timeoutMs);
+    /*  取出本地缓冲中的所有条目  */
+    size_t                  drain(std::vector<std::string>* items);
+
+    size_t                  buffered() const;
+    /*  最近一次失败的预取的状态  */
+    Status                  lastError() const;
+
+private:
+    SSDBQueueConsumer(const SSDBQueueConsumer&);
+    void operator=(const SSDBQueueConsumer&);
+
+    void                    run();
+    /*  以一个pipeline取出最多want条追加到items, 失败返回false(已收到的条目仍然追加)    */
+    bool                    fetch(size_t want, std::vector<std::string>* items);
+    /*  等待本地缓冲非空, 调用时持有锁   */
+    bool                    waitItems(std::unique_lock<std::mutex>& lock, int timeoutMs);
+
+private:
+    SSDBClient*                 m_client;
+    std::string                 m_name;
+    SSDBQueueConsumerOptions    m_options;
+
+    std::deque<std::string>     m_items;
+    mutable std::mutex          m_mutex;
+    /*  m_readable通知pop有新条目, m_refill通知后台线程缓冲低于lowWater   */
+    std::condition_variable     m_readable;
+    std::condition_variable     m_refill;
+    bool                        m_running;
+    bool                        m_fetching;
+    Status                      m_error;
+
+    std::thread                 m_thread;
+};
+
+#endif
@@ -0,0 +1,583 @@
+#include <string.h>
+
+#include "buffer.h"
+#include "socketlibtypes.h"
+#include "socketlibfunction.h"
+
+#include "ssdb_protocol.h"
+#include "ssdb_reactor.h"
+
+#if defined PLATFORM_WINDOWS
+#define poll WSAPoll
+#else
+#include <sys/uio.h>
+#endif
+
+#if defined __linux__
+#include <sys/eventfd.h>
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+/*  单次writev最多合并的请求数    */
+static const int MAX_IOV = 64;
+/*  所有连接断开时两次重连之间的最小间隔(毫秒)   */
+static const int64_t RECONNECT_INTERVAL_MS = 1000;
+
+struct SSDBReactorConnection
+{
+    sock                            fd;
+    buffer_s*                       recvBuffer;
+
+    /*  已分配到此连接的请求, head为最早的请求, sendCursor为第一个尚未发送完的请求 */
+    SSDBSubmission*                 head;
+    SSDBSubmission*                 tail;
+    SSDBSubmission*                 sendCursor;
+    int                             inflight;
+
+    /*  正在非阻塞连接(fd有效但尚未连上), 期间分配的请求在连上后发送   */
+    bool                            connecting;
+    int64_t                         connectDeadline;
+};
+
+SSDBReactor::SSDBReactor()
+{
+    ox_socket_init();
+    m_cpu = -1;
+    m_pending = 0;
+    m_running = false;
+    m_sleeping = false;
+    m_connected = 0;
+    m_wakeupFd[0] = -1;
+    m_wakeupFd[1] = -1;
+    m_lastReconnect = 0;
+    m_port = 0;
+    m_timeout = 5;
+}
+
+SSDBReactor::~SSDBReactor()
+{
+    stop();
+}
+
+bool SSDBReactor::start(const char* ip, int port, int connections, uint32_t timeoutSec, int cpu)
+{
+    if (m_running)
+    {
+        return false;
+    }
+
+    m_ip = ip;
+    m_port = port;
+    m_timeout = timeoutSec;
+    m_cpu = cpu;
+
+#if defined __linux__
+    m_wakeupFd[0] = m_wakeupFd[1] = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+#elif !defined PLATFORM_WINDOWS
+    if (pipe(m_wakeupFd) == 0)
+    {
+        ox_socket_set_block(m_wakeupFd[0], false);
+        ox_socket_set_block(m_wakeupFd[1], false);
+    }
+#endif
+
+    /*  所有连接并行建立  */
+    std::vector<sock> fds(connections > 0 ? connections : 0, SOCKET_ERROR);
+    if (!fds.empty())
+    {
+        ox_socket_connect_all(ip, port, connections, &fds[0], timeoutSec);
+    }
+    for (int i = 0; i < connections; ++i)
+    {
+        SSDBReactorConnection* connection = new SSDBReactorConnection;
+        connection->fd = SOCKET_ERROR;
+        connection->recvBuffer = ox_buffer_new(DEFAULT_SSDBPROTOCOL_LEN);
+        connection->head = NULL;
+        connection->tail = NULL;
+        connection->sendCursor = NULL;
+        connection->inflight = 0;
+        connection->connecting = false;
+        connection->connectDeadline = 0;
+        attach(connection, fds[i]);
+        m_connections.push_back(connection);
+    }
+
+    m_running = true;
+    m_thread = std::thread(&SSDBReactor::loop, this);
+    return m_connected > 0;
+}
+
+void SSDBReactor::stop()
+{
+    if (m_running.exchange(false))
+    {
+        wakeup();
+        m_thread.join();
+    }
+
+    /*  I/O线程已退出, 剩余的请求全部失败   */
+    for (size_t i = 0; i < m_connections.size(); ++i)
+    {
+        closeConnection(m_connections[i]);
+        ox_buffer_delete(m_connections[i]->recvBuffer);
+        delete m_connections[i];
+    }
+    m_connections.clear();
+    SSDBSubmission* submission = NULL;
+    while ((submission = m_queue.pop()) != NULL)
+    {
+        finish(submission, false);
+    }
+
+    if (m_wakeupFd[0] >= 0)
+    {
+        close(m_wakeupFd[0]);
+        if (m_wakeupFd[1] != m_wakeupFd[0])
+        {
+            close(m_wakeupFd[1]);
+        }
+        m_wakeupFd[0] = m_wakeupFd[1] = -1;
+    }
+}
+
+bool SSDBReactor::isconnected() const
+{
+    return m_connected > 0;
+}
+
+int SSDBReactor::pending() const
+{
+    return m_pending;
+}
+
+void SSDBReactor::post(SSDBSubmission* submission)
+{
+    submission->sent = 0;
+    submission->received = 0;
+    submission->next = NULL;
+    ++m_pending;
+
+    if (!m_running)
+    {
+        finish(submission, false);
+        return;
+    }
+
+    m_queue.push(submission);
+    if (m_sleeping.load() && m_sleeping.exchange(false))
+    {
+        wakeup();
+    }
+}
+
+void SSDBReactor::finish(SSDBSubmission* submission, bool success)
+{
+    --m_pending;
+    submission->complete(success);
+}
+
+void SSDBReactor::wakeup()
+{
+#if defined __linux__
+    uint64_t one = 1;
+    if (write(m_wakeupFd[1], &one, sizeof(one)) < 0)
+    {
+    }
+#elif !defined PLATFORM_WINDOWS
+    char one = 1;
+    if (write(m_wakeupFd[1], &one, sizeof(one)) < 0)
+    {
+    }
+#endif
+}
+
+bool SSDBReactor::reconnect(SSDBReactorConnection* connection)
+{
+    /*  非阻塞连接, 由loop中的poll等待完成, 不阻塞I/O线程  */
+    sock fd = SOCKET_ERROR;
+    int ret = ox_socket_connect_nonblock(m_ip.c_str(), m_port, &fd);
+    if (ret > 0)
+    {
+        return attach(connection, fd);
+    }
+    if (ret < 0)
+    {
+        return false;
+    }
+
+    connection->fd = fd;
+    connection->connecting = true;
+    connection->connectDeadline = ox_now_ms() + (m_timeout > 0 ? m_timeout : 1) * 1000;
+    return true;
+}
+
+void SSDBReactor::onConnect(SSDBReactorConnection* connection)
+{
+    sock fd = connection->fd;
+    if (ox_socket_connect_error(fd) != 0)
+    {
+        closeConnection(connection);
+        return;
+    }
+
+    connection->fd = SOCKET_ERROR;
+    connection->connecting = false;
+    if (!attach(connection, fd))
+    {
+        /*  attach已关闭fd, 排队的请求失败   */
+        closeConnection(connection);
+    }
+}
+
+bool SSDBReactor::attach(SSDBReactorConnection* connection, int fd)
+{
+    if (fd == SOCKET_ERROR)
+    {
+        return false;
+    }
+    if (!ox_socket_setup_async(fd))
+    {
+        ox_socket_close(fd);
+        return false;
+    }
+
+    connection->fd = fd;
+    ox_buffer_init(connection->recvBuffer);
+    ++m_connected;
+    return true;
+}
+
+void SSDBReactor::closeConnection(SSDBReactorConnection* connection)
+{
+    if (connection->fd != SOCKET_ERROR)
+    {
+        ox_socket_close(connection->fd);
+        connection->fd = SOCKET_ERROR;
+        if (!connection->connecting)
+        {
+            --m_connected;
+        }
+        connection->connecting = false;
+    }
+
+    while (connection->head != NULL)
+    {
+        SSDBSubmission* submission = connection->head;
+        connection->head = submission->next;
+        finish(submission, false);
+    }
+    connection->tail = NULL;
+    connection->sendCursor = NULL;
+    connection->inflight = 0;
+}
+
+SSDBReactorConnection* SSDBReactor::select()
+{
+    /*  选择未完成请求最少的连接, 没有已连接的连接时排在正在连接的连接上  */
+    SSDBReactorConnection* best = NULL;
+    SSDBReactorConnection* connecting = NULL;
+    for (size_t i = 0; i < m_connections.size(); ++i)
+    {
+        SSDBReactorConnection* connection = m_connections[i];
+        if (connection->connecting)
+        {
+            connecting = connecting == NULL || connection->inflight < connecting->inflight ? connection : connecting;
+        }
+        else if (connection->fd != SOCKET_ERROR && (best == NULL || connection->inflight < best->inflight))
+        {
+            best = connection;
+        }
+    }
+    return best != NULL ? best : connecting;
+}
+
+void SSDBReactor::assign(SSDBSubmission* submission)
+{
+    SSDBReactorConnection* best = select();
+    if (best == NULL && ox_now_ms() - m_lastReconnect >= RECONNECT_INTERVAL_MS)
+    {
+        /*  所有断开的连接同时发起非阻塞连接    */
+        m_lastReconnect = ox_now_ms();
+        for (size_t i = 0; i < m_connections.size(); ++i)
+        {
+            if (m_connections[i]->fd == SOCKET_ERROR)
+            {
+                reconnect(m_connections[i]);
+            }
+        }
+        best = select();
+    }
+
+    if (best == NULL)
+    {
+        finish(submission, false);
+        return;
+    }
+
+    submission->next = NULL;
+    if (best->tail != NULL)
+    {
+        best->tail->next = submission;
+    }
+    else
+    {
+        best->head = submission;
+    }
+    best->tail = submission;
+    if (best->sendCursor == NULL)
+    {
+        best->sendCursor = submission;
+    }
+    ++best->inflight;
+}
+
+void SSDBReactor::flush(SSDBReactorConnection* connection)
+{
+    while (connection->fd != SOCKET_ERROR && !connection->connecting && connection->sendCursor != NULL)
+    {
+        /*  把尚未发送的请求合并为一次writev    */
+#if defined PLATFORM_WINDOWS
+        WSABUF iov[MAX_IOV];
+#else
+        struct iovec iov[MAX_IOV];
+#endif
+        int iovcnt = 0;
+        for (SSDBSubmission* submission = connection->sendCursor; submission != NULL && iovcnt < MAX_IOV; submission = submission->next)
+        {
+#if defined PLATFORM_WINDOWS
+            iov[iovcnt].buf = (char*)submission->buffer + submission->sent;
+            iov[iovcnt].len = submission->len - submission->sent;
+#else
+            iov[iovcnt].iov_base = (void*)(submission->buffer + submission->sent);
+            iov[iovcnt].iov_len = submission->len - submission->sent;
+#endif
+            ++iovcnt;
+        }
+
+#if defined PLATFORM_WINDOWS
+        DWORD bytes = 0;
+        int sendret = WSASend(connection->fd, iov, iovcnt, &bytes, 0, NULL, NULL) == 0 ? (int)bytes : -1;
+#else
+        struct msghdr msg;
+        memset(&msg, 0, sizeof(msg));
+        msg.msg_iov = iov;
+        msg.msg_iovlen = iovcnt;
+        int sendret = (int)sendmsg(connection->fd, &msg, MSG_NOSIGNAL);
+#endif
+        if (sendret < 0)
+        {
+            if (sErrno == S_EWOULDBLOCK)
+            {
+                break;
+            }
+            if (sErrno != S_EINTR)
+            {
+                closeConnection(connection);
+            }
+            continue;
+        }
+
+        while (sendret > 0 && connection->sendCursor != NULL)
+        {
+            SSDBSubmission* submission = connection->sendCursor;
+            int left = submission->len - submission->sent;
+            if (sendret >= left)
+            {
+                sendret -= left;
+                submission->sent = submission->len;
+                connection->sendCursor = submission->next;
+            }
+            else
+            {
+                submission->sent += sendret;
+                sendret = 0;
+            }
+        }
+    }
+}
+
+void SSDBReactor::receive(SSDBReactorConnection* connection)
+{
+    while (connection->fd != SOCKET_ERROR)
+    {
+        buffer_s* buffer = connection->recvBuffer;
+        if (ox_buffer_getwritevalidcount(buffer) < 128)
+        {
+            ox_buffer_adjustto_head(buffer);
+        }
+        if (ox_buffer_getwritevalidcount(buffer) < 128)
+        {
+            /*  扩大缓冲区   */
+            buffer_s* temp = ox_buffer_new(ox_buffer_getsize(buffer) * 2);
+            memcpy(ox_buffer_getwriteptr(temp), ox_buffer_getreadptr(buffer), ox_buffer_getreadvalidcount(buffer));
+            ox_buffer_addwritepos(temp, ox_buffer_getreadvalidcount(buffer));
+            ox_buffer_delete(buffer);
+            connection->recvBuffer = buffer = temp;
+        }
+
+        int len = ::recv(connection->fd, ox_buffer_getwriteptr(buffer), ox_buffer_getwritevalidcount(buffer), 0);
+        if (len < 0 && sErrno == S_EWOULDBLOCK)
+        {
+            break;
+        }
+        if ((len < 0 && sErrno != S_EINTR) || len == 0)
+        {
+            closeConnection(connection);
+            break;
+        }
+        if (len < 0)
+        {
+            continue;
+        }
+        ox_buffer_addwritepos(buffer, len);
+
+        int packetLen = 0;
+        while ((packetLen = SSDBProtocolResponse::check_ssdb_packet(ox_buffer_getreadptr(buffer), ox_buffer_getreadvalidcount(buffer))) > 0)
+        {
+            SSDBSubmission* submission = connection->head;
+            if (submission == NULL || submission == connection->sendCursor)
+            {
+                /*  没有对应请求的response, 协议已错乱  */
+                closeConnection(connection);
+                return;
+            }
+
+            submission->reply->append(ox_buffer_getreadptr(buffer), packetLen);
+            ox_buffer_addreadpos(buffer, packetLen);
+            if (++submission->received == submission->count)
+            {
+                connection->head = submission->next;
+                if (connection->head == NULL)
+                {
+                    connection->tail = NULL;
+                }
+                --connection->inflight;
+                finish(submission, true);
+            }
+        }
+    }
+}
+
+void SSDBReactor::loop()
+{
+    if (m_cpu >= 0)
+    {
+        ssdb_thread_bind_cpu(m_cpu);
+    }
+
+    std::vector<struct pollfd> fds;
+    while (m_running)
+    {
+        SSDBSubmission* submission = NULL;
+        while ((submission = m_queue.pop()) != NULL)
+        {
+            assign(submission);
+        }
+        /*  连接超时的连接关闭, 排队的请求失败  */
+        int64_t now = ox_now_ms();
+        int64_t connectWaitMs = -1;
+        for (size_t i = 0; i < m_connections.size(); ++i)
+        {
+            SSDBReactorConnection* connection = m_connections[i];
+            if (connection->connecting && now >= connection->connectDeadline)
+            {
+                closeConnection(connection);
+            }
+            else if (connection->connecting && (connectWaitMs < 0 || connection->connectDeadline - now < connectWaitMs))
+            {
+                connectWaitMs = connection->connectDeadline - now;
+            }
+            flush(connection);
+        }
+
+        fds.clear();
+        struct pollfd pfd;
+        if (m_wakeupFd[0] >= 0)
+        {
+            pfd.fd = m_wakeupFd[0];
+            pfd.events = POLLIN;
+            pfd.revents = 0;
+            fds.push_back(pfd);
+        }
+        for (size_t i = 0; i < m_connections.size(); ++i)
+        {
+            SSDBReactorConnection* connection = m_connections[i];
+            pfd.fd = connection->fd;
+            pfd.events = connection->fd == SOCKET_ERROR ? 0 : POLLIN;
+            if (connection->connecting || connection->sendCursor != NULL)
+            {
+                pfd.events |= POLLOUT;
+            }
+            pfd.revents = 0;
+            fds.push_back(pfd);
+        }
+
+        /*  进入poll前声明休眠, 之后再检查一次队列, 避免错过生产者的唤醒 */
+        m_sleeping.store(true);
+        if ((submission = m_queue.pop()) != NULL)
+        {
+            m_sleeping.store(false);
+            assign(submission);
+            continue;
+        }
+
+#if defined PLATFORM_WINDOWS
+        int timeoutMs = 1;
+#else
+        int timeoutMs = m_wakeupFd[0] >= 0 ? 1000 : 1;
+#endif
+        if (connectWaitMs >= 0 && connectWaitMs < timeoutMs)
+        {
+            timeoutMs = (int)connectWaitMs;
+        }
+        int ret = poll(&fds[0], (int)fds.size(), timeoutMs);
+        m_sleeping.store(false);
+        if (ret <= 0)
+        {
+            continue;
+        }
+
+        size_t index = 0;
+        if (m_wakeupFd[0] >= 0)
+        {
+            if (fds[0].revents & POLLIN)
+            {
+                char drain[64];
+                while (read(m_wakeupFd[0], drain, sizeof(drain)) > 0)
+                {
+                }
+            }
+            index = 1;
+        }
+        for (size_t i = 0; i < m_connections.size(); ++i, ++index)
+        {
+            if (m_connections[i]->connecting)
+            {
+                if (fds[index].revents & (POLLOUT | POLLERR | POLLHUP))
+                {
+                    onConnect(m_connections[i]);
+                }
+            }
+            else if (fds[index].revents & (POLLIN | POLLERR | POLLHUP))
+            {
+                receive(m_connections[i]);
+            }
+        }
+    }
+}
+
+bool ssdb_thread_bind_cpu(int cpu)
+{
+#if defined PLATFORM_WINDOWS
+    return SetThreadAffinityMask(GetCurrentThread(), (DWORD_PTR)1 << cpu) != 0;
+#elif defined __linux__
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(cpu, &set);
+    return pthread_setaffinity_np(pthread_self(), sizeof(set), &set) == 0;
+#else
+    (void)cpu;
+    return false;
+#endif
+}
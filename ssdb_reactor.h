@@ -0,0 +1,111 @@
+#ifndef __SSDB_REACTOR_H__
+#define __SSDB_REACTOR_H__
+
+#include <string>
+#include <vector>
+#include <thread>
+#include <atomic>
+
+#include "ssdb_client.h"
+#include "mpsc_queue.h"
+#include "ssdb_completion.h"
+
+/*  reactor: 一个I/O线程 + 若干到同一ssdb节点的非阻塞连接
+    任意线程通过post提交请求节点(无锁MPSC队列), reactor线程取出所有就绪请求,
+    按连接合并为一次writev发送, 再按FIFO顺序把response匹配回请求并调用complete.  */
+
+struct SSDBSubmission : public MpscNode
+{
+    SSDBSubmission() : buffer(NULL), len(0), count(1), reply(NULL), sent(0), received(0), next(NULL)
+    {
+    }
+    virtual ~SSDBSubmission()
+    {
+    }
+
+    /*  在reactor线程中调用, 之后reactor不再访问此对象   */
+    virtual void            complete(bool success) = 0;
+
+    /*  已编码的请求(包含count个命令), response依次追加到reply   */
+    const char*             buffer;
+    int                     len;
+    int                     count;
+    std::string*            reply;
+
+    /*  reactor内部使用 */
+    int                     sent;
+    int                     received;
+    SSDBSubmission*         next;
+};
+
+/*  同步等待的请求节点, 通常位于调用线程栈上  */
+struct SSDBWaitSubmission : public SSDBSubmission
+{
+    virtual void complete(bool success)
+    {
+        completion.complete(success);
+    }
+
+    SSDBCompletion          completion;
+};
+
+struct SSDBReactorConnection;
+
+class SSDBReactor
+{
+public:
+    SSDBReactor();
+    ~SSDBReactor();
+
+    /*  (阻塞)建立connections个连接并启动reactor线程, cpu>=0时把线程绑定到该cpu   */
+    bool                    start(const char* ip, int port, int connections = 1, uint32_t timeoutSec = 5, int cpu = -1);
+    /*  停止reactor线程并断开所有连接, 未完成的请求以失败完成, 不能与post并发调用  */
+    void                    stop();
+
+    /*  线程安全, submission在complete之前必须保持有效  */
+    void                    post(SSDBSubmission* submission);
+
+    bool                    isconnected() const;
+    /*  已提交但尚未完成的请求数, 用于负载均衡  */
+    int                     pending() const;
+
+private:
+    SSDBReactor(const SSDBReactor&);
+    void operator=(const SSDBReactor&);
+
+    void                    loop();
+    void                    wakeup();
+    void                    finish(SSDBSubmission* submission, bool success);
+    void                    assign(SSDBSubmission* submission);
+    /*  选择要分配请求的连接, 没有可用连接时返回NULL  */
+    SSDBReactorConnection*  select();
+    /*  发起非阻塞重连, 连接完成由loop中的poll检测(onConnect) */
+    bool                    reconnect(SSDBReactorConnection* connection);
+    void                    onConnect(SSDBReactorConnection* connection);
+    bool                    attach(SSDBReactorConnection* connection, int fd);
+    void                    closeConnection(SSDBReactorConnection* connection);
+    void                    flush(SSDBReactorConnection* connection);
+    void                    receive(SSDBReactorConnection* connection);
+
+private:
+    MpscQueue<SSDBSubmission>           m_queue;
+    std::vector<SSDBReactorConnection*> m_connections;
+    std::thread                         m_thread;
+    int                                 m_cpu;
+
+    std::atomic<bool>                   m_running;
+    std::atomic<bool>                   m_sleeping;
+    std::atomic<int>                    m_connected;
+    std::atomic<int>                    m_pending;
+    int                                 m_wakeupFd[2];
+    int64_t                             m_lastReconnect;
+
+    std::string                         m_ip;
+    int                                 m_port;
+    uint32_t                            m_timeout;
+};
+
+/*  把当前线程绑定到指定cpu  */
+bool ssdb_thread_bind_cpu(int cpu);
+
+#endif
@@ -0,0 +1,143 @@
+#include "ssdb_protocol.h"
+#include "ssdb_reactor.h"
+#include "ssdb_reactor_engine.h"
+#include "work_stealing_pool.h"
+
+/*  异步请求节点, 完成后把回调投递到线程池, 回调执行完毕后释放   */
+struct SSDBCallbackSubmission : public SSDBSubmission
+{
+    virtual void complete(bool success)
+    {
+        this->success = success;
+        pool->post([this]() {
+            if (this->success)
+            {
+                SSDBProtocolResponse response;
+                response.parse(response_buffer.c_str(), (int)response_buffer.size());
+                callback(true, &response);
+            }
+            else
+            {
+                callback(false, NULL);
+            }
+            delete this;
+        });
+    }
+
+    std::string             request_buffer;
+    std::string             response_buffer;
+    SSDBAsyncCallback       callback;
+    WorkStealingPool*       pool;
+    bool                    success;
+};
+
+SSDBReactorEngine::SSDBReactorEngine()
+{
+    m_pool = new WorkStealingPool;
+    m_next = 0;
+}
+
+SSDBReactorEngine::~SSDBReactorEngine()
+{
+    stop();
+    delete m_pool;
+    m_pool = NULL;
+}
+
+bool SSDBReactorEngine::start(const char* ip, int port, const SSDBReactorOptions& options)
+{
+    if (!m_reactors.empty())
+    {
+        return false;
+    }
+
+    m_pool->start(options.callbackThreads);
+
+    bool connected = false;
+    for (int i = 0; i < options.reactors; ++i)
+    {
+        int cpu = options.cpus.empty() ? -1 : options.cpus[i % options.cpus.size()];
+        SSDBReactor* reactor = new SSDBReactor;
+        if (reactor->start(ip, port, options.connectionsPerReactor, options.timeoutSec, cpu))
+        {
+            connected = true;
+        }
+        m_reactors.push_back(reactor);
+    }
+
+    return connected;
+}
+
+void SSDBReactorEngine::stop()
+{
+    for (size_t i = 0; i < m_reactors.size(); ++i)
+    {
+        m_reactors[i]->stop();
+        delete m_reactors[i];
+    }
+    m_reactors.clear();
+    m_pool->stop();
+}
+
+bool SSDBReactorEngine::isconnected() const
+{
+    for (size_t i = 0; i < m_reactors.size(); ++i)
+    {
+        if (m_reactors[i]->isconnected())
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+SSDBReactor* SSDBReactorEngine::pick()
+{
+    /*  从轮询位置开始的两个reactor中选择未完成请求较少的一个 */
+    unsigned start = m_next++;
+    SSDBReactor* first = m_reactors[start % m_reactors.size()];
+    SSDBReactor* second = m_reactors[(start + 1) % m_reactors.size()];
+    if (!first->isconnected() && second->isconnected())
+    {
+        return second;
+    }
+    return second->pending() < first->pending() && second->isconnected() ? second : first;
+}
+
+void SSDBReactorEngine::submit(const char* buffer, int len, const SSDBAsyncCallback& callback)
+{
+    if (m_reactors.empty())
+    {
+        callback(false, NULL);
+        return;
+    }
+
+    SSDBCallbackSubmission* submission = new SSDBCallbackSubmission;
+    submission->request_buffer.assign(buffer, len);
+    submission->buffer = submission->request_buffer.c_str();
+    submission->len = len;
+    submission->count = 1;
+    submission->reply = &submission->response_buffer;
+    submission->callback = callback;
+    submission->pool = m_pool;
+    submission->success = false;
+
+    pick()->post(submission);
+}
+
+bool SSDBReactorEngine::request(const char* buffer, int len, int count, SSDBReplyBuffer& reply)
+{
+    if (m_reactors.empty())
+    {
+        return false;
+    }
+
+    SSDBWaitSubmission submission;
+    submission.buffer = buffer;
+    submission.len = len;
+    submission.count = count;
+    submission.reply = reply.get();
+
+    pick()->post(&submission);
+    return submission.completion.wait();
+}
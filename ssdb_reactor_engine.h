@@ -0,0 +1,74 @@
+#ifndef __SSDB_REACTOR_ENGINE_H__
+#define __SSDB_REACTOR_ENGINE_H__
+
+#include <string>
+#include <vector>
+#include <atomic>
+#include <functional>
+
+#include "ssdb_client.h"
+#include "ssdb_transport.h"
+
+/*  多reactor I/O引擎
+    N个reactor线程(可绑定到指定cpu), 每个reactor拥有若干到ssdb节点的连接;
+    同步请求(SSDBClient经SSDBTransport接口)由调用线程等待, 异步请求的完成回调在work-stealing线程池中执行,
+    慢回调不会阻塞reactor.
+
+    SSDBReactorOptions options;
+    options.reactors = 4;
+    options.cpus.push_back(2); ...
+    SSDBReactorEngine engine;
+    engine.start("127.0.0.1", 8888, options);
+    SSDBClient client(&engine);                     // 同步, 每个线程一个
+    engine.submit(buffer, len, callback);           // 异步  */
+
+class SSDBReactor;
+class WorkStealingPool;
+
+struct SSDBReactorOptions
+{
+    SSDBReactorOptions() : reactors(1), connectionsPerReactor(1), callbackThreads(1), timeoutSec(5)
+    {
+    }
+
+    int                 reactors;
+    int                 connectionsPerReactor;
+    /*  第i个reactor绑定到cpus[i % cpus.size()], 为空则不绑定   */
+    std::vector<int>    cpus;
+    /*  执行异步回调的线程数  */
+    int                 callbackThreads;
+    uint32_t            timeoutSec;
+};
+
+/*  异步请求完成回调: 失败(连接断开等)时success为false且response为NULL   */
+typedef std::function<void(bool success, SSDBProtocolResponse* response)> SSDBAsyncCallback;
+
+class SSDBReactorEngine : public SSDBTransport
+{
+public:
+    SSDBReactorEngine();
+    ~SSDBReactorEngine();
+
+    bool                    start(const char* ip, int port, const SSDBReactorOptions& options = SSDBReactorOptions());
+    /*  停止所有reactor, 执行完已完成请求的回调后返回  */
+    void                    stop();
+
+    /*  异步提交一个已编码的命令, 请求内容会被复制, 线程安全  */
+    void                    submit(const char* buffer, int len, const SSDBAsyncCallback& callback);
+
+    virtual bool            request(const char* buffer, int len, int count, SSDBReplyBuffer& reply);
+    virtual bool            isconnected() const;
+
+private:
+    SSDBReactorEngine(const SSDBReactorEngine&);
+    void operator=(const SSDBReactorEngine&);
+
+    SSDBReactor*            pick();
+
+private:
+    std::vector<SSDBReactor*>   m_reactors;
+    WorkStealingPool*           m_pool;
+    std::atomic<unsigned>       m_next;
+};
+
+#endif
@@ -0,0 +1,289 @@
+#include <string>
+#include <vector>
+#include <thread>
+#include <chrono>
+#include <atomic>
+#include <algorithm>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "platform.h"
+#include "ssdb_client.h"
+#include "ssdb_capture.h"
+
+#if defined PLATFORM_WINDOWS
+#include <io.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
+/*  回放SSDBClient::startCapture录制的流量
+    用法: ssdb_replay <log> <ip> <port> [-c 连接数] [-s 速度倍数] [-b 每批最大请求数]
+    -s 1 按录制时的速率回放, -s 2 两倍速, -s 0 不等待尽快回放.
+    每个连接一个线程, 已到期的请求合并为一批pipeline发送.  */
+
+using namespace std;
+
+typedef std::chrono::steady_clock ReplayClock;
+
+struct ReplayRecord
+{
+    int64_t     timestamp;
+    const char* data;
+    int         len;
+    /*  记录中的命令个数(pipeline录制为一条记录)  */
+    int         count;
+};
+
+struct ReplayStats
+{
+    std::atomic<int64_t>    requests;
+    std::atomic<int64_t>    replies;
+    std::atomic<int64_t>    bytes;
+    std::atomic<int64_t>    lagUs;
+};
+
+class ReplayFile
+{
+public:
+    ReplayFile() : m_data(NULL), m_len(0)
+    {
+    }
+
+    ~ReplayFile()
+    {
+#if defined PLATFORM_WINDOWS
+        free(m_data);
+#else
+        if (m_data != NULL)
+        {
+            munmap(m_data, m_len);
+        }
+#endif
+    }
+
+    bool open(const char* path)
+    {
+#if defined PLATFORM_WINDOWS
+        FILE* fp = fopen(path, "rb");
+        if (fp == NULL)
+        {
+            return false;
+        }
+        fseek(fp, 0, SEEK_END);
+        m_len = ftell(fp);
+        fseek(fp, 0, SEEK_SET);
+        m_data = (char*)malloc(m_len);
+        bool ok = m_data != NULL && fread(m_data, 1, m_len, fp) == m_len;
+        fclose(fp);
+        return ok;
+#else
+        int fd = ::open(path, O_RDONLY);
+        if (fd < 0)
+        {
+            return false;
+        }
+        struct stat st;
+        if (fstat(fd, &st) != 0 || st.st_size == 0)
+        {
+            ::close(fd);
+            return false;
+        }
+        m_len = (size_t)st.st_size;
+        void* addr = mmap(NULL, m_len, PROT_READ, MAP_PRIVATE, fd, 0);
+        ::close(fd);
+        if (addr == MAP_FAILED)
+        {
+            return false;
+        }
+        madvise(addr, m_len, MADV_SEQUENTIAL);
+        m_data = (char*)addr;
+        return true;
+#endif
+    }
+
+    /*  解析全部记录并按时间戳排序, 文件尾部不完整的记录被忽略  */
+    bool load(std::vector<ReplayRecord>* records) const
+    {
+        /*  旧格式的记录头没有命令个数, 每条记录一个命令  */
+        size_t headLen = 0;
+        if (m_len >= SSDB_CAPTURE_MAGIC_LEN && memcmp(m_data, SSDB_CAPTURE_MAGIC, SSDB_CAPTURE_MAGIC_LEN) == 0)
+        {
+            headLen = SSDB_CAPTURE_RECORD_HEAD_LEN;
+        }
+        else if (m_len >= SSDB_CAPTURE_MAGIC_LEN && memcmp(m_data, SSDB_CAPTURE_MAGIC_V1, SSDB_CAPTURE_MAGIC_LEN) == 0)
+        {
+            headLen = SSDB_CAPTURE_RECORD_HEAD_LEN_V1;
+        }
+        else
+        {
+            return false;
+        }
+
+        size_t pos = SSDB_CAPTURE_MAGIC_LEN;
+        while (pos + headLen <= m_len)
+        {
+            ReplayRecord record;
+            memcpy(&record.timestamp, m_data + pos, sizeof(record.timestamp));
+            memcpy(&record.len, m_data + pos + sizeof(record.timestamp), sizeof(record.len));
+            record.count = 1;
+            if (headLen == SSDB_CAPTURE_RECORD_HEAD_LEN)
+            {
+                memcpy(&record.count, m_data + pos + sizeof(record.timestamp) + sizeof(record.len), sizeof(record.count));
+            }
+            if (record.len <= 0 || record.count <= 0 || pos + headLen + record.len > m_len)
+            {
+                break;
+            }
+            record.data = m_data + pos + headLen;
+            records->push_back(record);
+            pos += headLen + record.len;
+        }
+
+        std::stable_sort(records->begin(), records->end(), [](const ReplayRecord& a, const ReplayRecord& b) {
+            return a.timestamp < b.timestamp;
+        });
+        return true;
+    }
+
+private:
+    char*       m_data;
+    size_t      m_len;
+};
+
+static void replay_connection(const std::vector<ReplayRecord>* records, int index, int connections, double speed,
+    int batchMax, const char* ip, int port, ReplayClock::time_point start, ReplayStats* stats)
+{
+    SSDBClient client;
+    client.connect(ip, port);
+    if (!client.isconnected())
+    {
+        fprintf(stderr, "connection %d: connect %s:%d failed\n", index, ip, port);
+        return;
+    }
+
+    const int64_t base = records->empty() ? 0 : (*records)[0].timestamp;
+    std::string batch;
+    size_t i = index;
+    while (i < records->size())
+    {
+        /*  等待下一条请求到期  */
+        const ReplayRecord& next = (*records)[i];
+        ReplayClock::time_point due = start;
+        if (speed > 0)
+        {
+            due += std::chrono::microseconds((int64_t)((next.timestamp - base) / speed));
+            std::this_thread::sleep_until(due);
+        }
+
+        /*  合并此刻所有已到期的记录, count为其中的命令总数   */
+        batch.clear();
+        int batched = 0;
+        int count = 0;
+        ReplayClock::time_point now = ReplayClock::now();
+        while (i < records->size() && (batched == 0 || count + (*records)[i].count <= batchMax))
+        {
+            const ReplayRecord& record = (*records)[i];
+            if (speed > 0 && start + std::chrono::microseconds((int64_t)((record.timestamp - base) / speed)) > now)
+            {
+                break;
+            }
+            batch.append(record.data, record.len);
+            ++batched;
+            count += record.count;
+            i += connections;
+        }
+
+        stats->lagUs += std::chrono::duration_cast<std::chrono::microseconds>(now - due).count() * count;
+        stats->requests += count;
+        stats->bytes += batch.size();
+        stats->replies += client.pipeline(batch.c_str(), (int)batch.size(), count);
+    }
+}
+
+static void usage()
+{
+    fprintf(stderr, "usage: ssdb_replay <log> <ip> <port> [-c connections] [-s speed] [-b batch]\n");
+}
+
+int main(int argc, char** argv)
+{
+    if (argc < 4)
+    {
+        usage();
+        return 1;
+    }
+
+    const char* path = argv[1];
+    const char* ip = argv[2];
+    int port = atoi(argv[3]);
+    int connections = 1;
+    double speed = 1.0;
+    int batchMax = 128;
+    for (int i = 4; i + 1 < argc; i += 2)
+    {
+        if (strcmp(argv[i], "-c") == 0)
+        {
+            connections = std::max(1, atoi(argv[i + 1]));
+        }
+        else if (strcmp(argv[i], "-s") == 0)
+        {
+            speed = atof(argv[i + 1]);
+        }
+        else if (strcmp(argv[i], "-b") == 0)
+        {
+            batchMax = std::max(1, atoi(argv[i + 1]));
+        }
+        else
+        {
+            usage();
+            return 1;
+        }
+    }
+
+    ReplayFile file;
+    std::vector<ReplayRecord> records;
+    if (!file.open(path) || !file.load(&records))
+    {
+        fprintf(stderr, "invalid capture log: %s\n", path);
+        return 1;
+    }
+
+    int64_t commands = 0;
+    for (size_t i = 0; i < records.size(); ++i)
+    {
+        commands += records[i].count;
+    }
+
+    ReplayStats stats;
+    stats.requests = 0;
+    stats.replies = 0;
+    stats.bytes = 0;
+    stats.lagUs = 0;
+
+    ReplayClock::time_point start = ReplayClock::now();
+    std::vector<std::thread> threads;
+    for (int i = 0; i < connections; ++i)
+    {
+        threads.push_back(std::thread(replay_connection, &records, i, connections, speed, batchMax, ip, port, start, &stats));
+    }
+    for (size_t i = 0; i < threads.size(); ++i)
+    {
+        threads[i].join();
+    }
+
+    double seconds = std::chrono::duration_cast<std::chrono::microseconds>(ReplayClock::now() - start).count() / 1e6;
+    double recorded = records.size() > 1 ? (records.back().timestamp - records.front().timestamp) / 1e6 : 0;
+    printf("records,requests,replies,bytes,recorded_sec,replay_sec,ops_per_sec,avg_lag_us\n");
+    printf("%lld,%lld,%lld,%lld,%.3f,%.3f,%.1f,%.1f\n",
+        (long long)records.size(), (long long)stats.requests.load(), (long long)stats.replies.load(),
+        (long long)stats.bytes.load(), recorded, seconds,
+        seconds > 0 ? stats.requests.load() / seconds : 0.0,
+        stats.requests.load() > 0 ? (double)stats.lagUs.load() / stats.requests.load() : 0.0);
+
+    return stats.replies.load() == commands ? 0 : 2;
+}
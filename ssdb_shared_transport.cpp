@@ -0,0 +1,40 @@
+#include "ssdb_reactor.h"
+#include "ssdb_shared_transport.h"
+
+SSDBSharedTransport::SSDBSharedTransport()
+{
+    m_reactor = new SSDBReactor;
+}
+
+SSDBSharedTransport::~SSDBSharedTransport()
+{
+    delete m_reactor;
+    m_reactor = NULL;
+}
+
+bool SSDBSharedTransport::start(const char* ip, int port, int connections, uint32_t timeoutSec)
+{
+    return m_reactor->start(ip, port, connections, timeoutSec);
+}
+
+void SSDBSharedTransport::stop()
+{
+    m_reactor->stop();
+}
+
+bool SSDBSharedTransport::isconnected() const
+{
+    return m_reactor->isconnected();
+}
+
+bool SSDBSharedTransport::request(const char* buffer, int len, int count, SSDBReplyBuffer& reply)
+{
+    SSDBWaitSubmission submission;
+    submission.buffer = buffer;
+    submission.len = len;
+    submission.count = count;
+    submission.reply = reply.get();
+
+    m_reactor->post(&submission);
+    return submission.completion.wait();
+}
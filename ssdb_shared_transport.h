@@ -0,0 +1,41 @@
+#ifndef __SSDB_SHARED_TRANSPORT_H__
+#define __SSDB_SHARED_TRANSPORT_H__
+
+#include "ssdb_client.h"
+#include "ssdb_transport.h"
+
+/*  多线程共享的多路复用transport
+    任意线程通过各自的SSDBClient提交已编码的请求, 请求节点(位于调用线程栈上)进入无锁MPSC队列,
+    唯一的I/O线程(SSDBReactor)取出所有就绪请求, 按连接合并为一次writev发送, 再按FIFO顺序把response匹配回请求,
+    通过futex唤醒等待的调用线程. 少量连接即可服务大量线程, 负载高时小请求会自动合并发送.
+
+    SSDBSharedTransport transport;
+    transport.start("127.0.0.1", 8888, 2);
+    SSDBClient client(&transport);      // 每个线程一个
+    client.get(key, &value);   */
+
+class SSDBReactor;
+
+class SSDBSharedTransport : public SSDBTransport
+{
+public:
+    SSDBSharedTransport();
+    ~SSDBSharedTransport();
+
+    /*  (阻塞)建立connections个连接并启动I/O线程 */
+    bool                    start(const char* ip, int port, int connections = 1, uint32_t timeoutSec = 5);
+    /*  停止I/O线程并断开所有连接, 未完成的请求返回失败  */
+    void                    stop();
+
+    virtual bool            request(const char* buffer, int len, int count, SSDBReplyBuffer& reply);
+    virtual bool            isconnected() const;
+
+private:
+    SSDBSharedTransport(const SSDBSharedTransport&);
+    void operator=(const SSDBSharedTransport&);
+
+private:
+    SSDBReactor*            m_reactor;
+};
+
+#endif
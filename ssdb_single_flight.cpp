@@ -0,0 +1,135 @@
+#include <string.h>
+#include <stdlib.h>
+#include <condition_variable>
+
+#include "ssdb_single_flight.h"
+
+/*  可以合并的只读命令   */
+static const char* READONLY_COMMANDS[] =
+{
+    "get", "exists", "ttl", "strlen", "getbit", "substr", "keys", "rkeys", "scan", "rscan", "multi_get", "multi_exists",
+    "hget", "hexists", "hsize", "hgetall", "hkeys", "hscan", "hrscan", "hlist", "hrlist", "multi_hget", "multi_hexists", "multi_hsize",
+    "zget", "zexists", "zsize", "zrank", "zrrank", "zrange", "zrrange", "zkeys", "zscan", "zrscan", "zcount", "zsum", "zavg", "zlist", "zrlist", "multi_zget", "multi_zexists", "multi_zsize",
+    "qsize", "qfront", "qback", "qget", "qslice", "qrange", "qlist", "qrlist",
+};
+
+struct SSDBFlight
+{
+    SSDBFlight() : done(false), success(false)
+    {
+    }
+
+    bool                        done;
+    bool                        success;
+    SSDBReplyBuffer             reply;
+    std::condition_variable     cond;
+};
+
+SSDBSingleFlightTransport::SSDBSingleFlightTransport(SSDBTransport* inner) : m_inner(inner), m_shared(0)
+{
+}
+
+bool SSDBSingleFlightTransport::isconnected() const
+{
+    return m_inner->isconnected();
+}
+
+uint64_t SSDBSingleFlightTransport::shared() const
+{
+    return m_shared.load(std::memory_order_relaxed);
+}
+
+bool SSDBSingleFlightTransport::readonly(const char* buffer, int len, int count)
+{
+    const char* current = buffer;
+    const char* end = buffer + len;
+    for (int i = 0; i < count; ++i)
+    {
+        bool first = true;
+        while (current < end && *current != '\n')
+        {
+            /*  每一项为: 长度\n数据\n    */
+            char* temp = NULL;
+            long itemLen = strtol(current, &temp, 10);
+            if (temp == current || temp >= end || *temp != '\n' || itemLen < 0 || end - (temp + 1) < itemLen + 1)
+            {
+                return false;
+            }
+            const char* data = temp + 1;
+
+            if (first)
+            {
+                bool found = false;
+                for (size_t j = 0; j < sizeof(READONLY_COMMANDS) / sizeof(READONLY_COMMANDS[0]) && !found; ++j)
+                {
+                    found = strlen(READONLY_COMMANDS[j]) == (size_t)itemLen && memcmp(READONLY_COMMANDS[j], data, itemLen) == 0;
+                }
+                if (!found)
+                {
+                    return false;
+                }
+                first = false;
+            }
+            current = data + itemLen + 1;
+        }
+
+        if (first || current >= end)
+        {
+            return false;
+        }
+        /*  跳过命令结尾的空行   */
+        ++current;
+    }
+
+    return current == end;
+}
+
+bool SSDBSingleFlightTransport::request(const char* buffer, int len, int count, SSDBReplyBuffer& reply)
+{
+    if (len <= 0 || !readonly(buffer, len, count))
+    {
+        return m_inner->request(buffer, len, count, reply);
+    }
+
+    std::string key(buffer, len);
+    std::shared_ptr<SSDBFlight> flight;
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        std::unordered_map<std::string, std::shared_ptr<SSDBFlight>>::iterator iter = m_flights.find(key);
+        if (iter != m_flights.end())
+        {
+            /*  等待进行中的相同请求, 共享它的response  */
+            flight = iter->second;
+            flight->cond.wait(lock, [&flight]() {
+                return flight->done;
+            });
+            m_shared.fetch_add(1, std::memory_order_relaxed);
+            if (flight->success)
+            {
+                reply = flight->reply;
+            }
+            return flight->success;
+        }
+
+        flight = std::make_shared<SSDBFlight>();
+        m_flights.insert(std::make_pair(key, flight));
+    }
+
+    bool success = m_inner->request(buffer, len, count, reply);
+
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_flights.erase(key);
+        if (success && flight.use_count() > 1)
+        {
+            /*  有其他请求在等待: 把response移到新的共享缓冲区(不拷贝数据), 调用方不会再复用它   */
+            reply = std::make_shared<std::string>(std::move(*reply));
+            flight->reply = reply;
+        }
+        flight->done = true;
+        flight->success = success;
+    }
+    flight->cond.notify_all();
+
+    return success;
+}
@@ -0,0 +1,50 @@
+#ifndef __SSDB_SINGLE_FLIGHT_H__
+#define __SSDB_SINGLE_FLIGHT_H__
+
+#include <string>
+#include <unordered_map>
+#include <memory>
+#include <mutex>
+#include <atomic>
+
+#include "ssdb_transport.h"
+
+/*  single-flight: 合并并发的相同读请求
+    包装另一个transport(如SSDBSharedTransport). 只包含读命令(get/hget/multi_hget等)的请求,
+    如果已有编码完全相同的请求正在进行, 不再发送, 等待该请求完成后共享它的response缓冲区(引用计数, 不拷贝).
+    写命令或混有写命令的pipeline直接转发.
+
+    SSDBSharedTransport shared;
+    shared.start("127.0.0.1", 8888, 2);
+    SSDBSingleFlightTransport transport(&shared);
+    SSDBClient client(&transport);      // 每个线程一个   */
+
+struct SSDBFlight;
+
+class SSDBSingleFlightTransport : public SSDBTransport
+{
+public:
+    /*  inner需在此对象生命期内保持有效   */
+    explicit SSDBSingleFlightTransport(SSDBTransport* inner);
+
+    virtual bool            request(const char* buffer, int len, int count, SSDBReplyBuffer& reply);
+    virtual bool            isconnected() const;
+
+    /*  共享了其他请求response的请求数    */
+    uint64_t                shared() const;
+
+    /*  buffer中的count个命令是否都是只读命令    */
+    static bool             readonly(const char* buffer, int len, int count);
+
+private:
+    SSDBSingleFlightTransport(const SSDBSingleFlightTransport&);
+    void operator=(const SSDBSingleFlightTransport&);
+
+private:
+    SSDBTransport*                                                  m_inner;
+    std::mutex                                                      m_mutex;
+    std::unordered_map<std::string, std::shared_ptr<SSDBFlight>>    m_flights;
+    std::atomic<uint64_t>                                           m_shared;
+};
+
+#endif
@@ -0,0 +1,606 @@
+#include "platform.h"
+
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <vector>
+#include <chrono>
+
+#if !defined PLATFORM_WINDOWS
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <dirent.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
+#include "ssdb_protocol.h"
+#include "ssdb_spool.h"
+
+/*  每条记录: 记录头 + count个已编码的请求   */
+struct SpoolRecordHeader
+{
+    uint32_t    magic;
+    uint32_t    len;
+    uint32_t    count;
+    uint32_t    checksum;
+};
+
+static const uint32_t SPOOL_RECORD_MAGIC = 0x4c4f5053;      /*  "SPOL"  */
+static const int64_t SPOOL_HEADER_LEN = (int64_t)sizeof(SpoolRecordHeader);
+
+struct SSDBSpoolSegment
+{
+    uint64_t        seq;
+    std::string     path;
+    int             fd;
+    char*           data;
+    int64_t         size;
+    /*  已写入的长度  */
+    int64_t         end;
+};
+
+/*  写入线程各自复用一个编码缓冲区   */
+static thread_local SSDBProtocolRequest t_request;
+
+static uint32_t spool_checksum(const char* data, int64_t len)
+{
+    /*  每次处理8字节的FNV变体, 只用于识别写了一半的记录    */
+    uint64_t hash = 14695981039346656037ULL;
+    int64_t i = 0;
+    for (; i + 8 <= len; i += 8)
+    {
+        uint64_t word;
+        memcpy(&word, data + i, 8);
+        hash = (hash ^ word) * 1099511628211ULL;
+    }
+    for (; i < len; ++i)
+    {
+        hash = (hash ^ (unsigned char)data[i]) * 1099511628211ULL;
+    }
+    return (uint32_t)(hash ^ (hash >> 32));
+}
+
+static std::string segment_path(const std::string& dir, uint64_t seq)
+{
+    char name[64];
+    snprintf(name, sizeof(name), "/spool.%020llu.log", (unsigned long long)seq);
+    return dir + name;
+}
+
+/*  打开(create为true时创建)日志段文件并映射, size为0时使用文件现有大小   */
+static SSDBSpoolSegment* map_segment(const std::string& path, uint64_t seq, int64_t size, bool create)
+{
+#if defined PLATFORM_WINDOWS
+    (void)path;
+    (void)seq;
+    (void)size;
+    (void)create;
+    return NULL;
+#else
+    int fd = ::open(path.c_str(), O_RDWR | O_CLOEXEC | (create ? O_CREAT | O_EXCL : 0), 0644);
+    if (fd < 0)
+    {
+        return NULL;
+    }
+
+    struct stat st;
+    if (create ? ftruncate(fd, (off_t)size) != 0 : fstat(fd, &st) != 0)
+    {
+        ::close(fd);
+        return NULL;
+    }
+    size = create ? size : (int64_t)st.st_size;
+
+    void* data = size > 0 ? mmap(NULL, (size_t)size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0) : MAP_FAILED;
+    if (data == MAP_FAILED)
+    {
+        ::close(fd);
+        return NULL;
+    }
+
+    SSDBSpoolSegment* segment = new SSDBSpoolSegment;
+    segment->seq = seq;
+    segment->path = path;
+    segment->fd = fd;
+    segment->data = (char*)data;
+    segment->size = size;
+    segment->end = 0;
+    return segment;
+#endif
+}
+
+static void unmap_segment(SSDBSpoolSegment* segment)
+{
+#if !defined PLATFORM_WINDOWS
+    munmap(segment->data, (size_t)segment->size);
+    ::close(segment->fd);
+#endif
+    delete segment;
+}
+
+/*  从offset开始扫描有效记录, 返回最后一条有效记录的结尾  */
+static int64_t scan_records(const SSDBSpoolSegment* segment, int64_t offset)
+{
+    while (offset + SPOOL_HEADER_LEN <= segment->size)
+    {
+        SpoolRecordHeader header;
+        memcpy(&header, segment->data + offset, sizeof(header));
+        int64_t next = offset + SPOOL_HEADER_LEN + header.len;
+        if (header.magic != SPOOL_RECORD_MAGIC || header.count == 0 || next > segment->size ||
+            spool_checksum(segment->data + offset + SPOOL_HEADER_LEN, header.len) != header.checksum)
+        {
+            break;
+        }
+        offset = next;
+    }
+    return offset;
+}
+
+SSDBWriteSpool::SSDBWriteSpool(SSDBClient* client, const SSDBSpoolOptions& options) : m_client(client), m_options(options),
+    m_readSeq(0), m_readOffset(0), m_pendingBytes(0), m_replayed(0), m_failed(0), m_running(false)
+{
+    m_options.maxSegments = m_options.maxSegments > 1 ? m_options.maxSegments : 2;
+    m_options.minBackoffMs = m_options.minBackoffMs > 0 ? m_options.minBackoffMs : 1;
+    m_options.maxBackoffMs = m_options.maxBackoffMs > m_options.minBackoffMs ? m_options.maxBackoffMs : m_options.minBackoffMs;
+}
+
+SSDBWriteSpool::~SSDBWriteSpool()
+{
+    close();
+}
+
+bool SSDBWriteSpool::open(const std::string& dir)
+{
+    close();
+
+    m_dir = dir;
+    if (!recover())
+    {
+        close();
+        return false;
+    }
+
+    m_running = true;
+    m_thread = std::thread([this]() {
+        run();
+    });
+    return true;
+}
+
+void SSDBWriteSpool::close()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_running = false;
+    }
+    m_written.notify_all();
+    if (m_thread.joinable())
+    {
+        m_thread.join();
+    }
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (!m_segments.empty())
+    {
+        writeCheckpoint(m_readSeq, m_readOffset);
+    }
+    for (std::map<uint64_t, SSDBSpoolSegment*>::iterator iter = m_segments.begin(); iter != m_segments.end(); ++iter)
+    {
+        unmap_segment(iter->second);
+    }
+    m_segments.clear();
+    m_pendingBytes = 0;
+    m_drained.notify_all();
+}
+
+SSDBSpoolSegment* SSDBWriteSpool::createSegment(uint64_t seq, int64_t size)
+{
+    return map_segment(segment_path(m_dir, seq), seq, size, true);
+}
+
+void SSDBWriteSpool::removeSegment(SSDBSpoolSegment* segment)
+{
+    std::string path = segment->path;
+    unmap_segment(segment);
+#if !defined PLATFORM_WINDOWS
+    unlink(path.c_str());
+#endif
+}
+
+bool SSDBWriteSpool::recover()
+{
+#if defined PLATFORM_WINDOWS
+    return false;
+#else
+    uint64_t checkpointSeq = 0;
+    int64_t checkpointOffset = 0;
+    readCheckpoint(&checkpointSeq, &checkpointOffset);
+
+    DIR* dir = opendir(m_dir.c_str());
+    if (dir == NULL)
+    {
+        return false;
+    }
+    std::vector<uint64_t> seqs;
+    struct dirent* entry = NULL;
+    while ((entry = readdir(dir)) != NULL)
+    {
+        unsigned long long seq = 0;
+        char tail[8] = { 0 };
+        if (sscanf(entry->d_name, "spool.%llu.%4s", &seq, tail) == 2 && strcmp(tail, "log") == 0)
+        {
+            seqs.push_back((uint64_t)seq);
+        }
+    }
+    closedir(dir);
+
+    for (size_t i = 0; i < seqs.size(); ++i)
+    {
+        if (seqs[i] < checkpointSeq)
+        {
+            /*  已全部重放   */
+            unlink(segment_path(m_dir, seqs[i]).c_str());
+            continue;
+        }
+
+        SSDBSpoolSegment* segment = map_segment(segment_path(m_dir, seqs[i]), seqs[i], 0, false);
+        if (segment == NULL)
+        {
+            return false;
+        }
+        segment->end = scan_records(segment, 0);
+        m_segments[segment->seq] = segment;
+    }
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (m_segments.empty())
+    {
+        SSDBSpoolSegment* segment = createSegment(checkpointSeq + 1, m_options.segmentBytes);
+        if (segment == NULL)
+        {
+            return false;
+        }
+        m_segments[segment->seq] = segment;
+    }
+    else
+    {
+        /*  清除最后一个日志段有效记录之后的残留数据, 避免之后的写入与旧记录拼成有效记录   */
+        SSDBSpoolSegment* tail = m_segments.rbegin()->second;
+        memset(tail->data + tail->end, 0, (size_t)(tail->size - tail->end));
+    }
+
+    SSDBSpoolSegment* head = m_segments.begin()->second;
+    m_readSeq = head->seq;
+    m_readOffset = head->seq == checkpointSeq ? (checkpointOffset < head->end ? checkpointOffset : head->end) : 0;
+    m_pendingBytes = -m_readOffset;
+    for (std::map<uint64_t, SSDBSpoolSegment*>::iterator iter = m_segments.begin(); iter != m_segments.end(); ++iter)
+    {
+        m_pendingBytes += iter->second->end;
+    }
+    return true;
+#endif
+}
+
+void SSDBWriteSpool::writeCheckpoint(uint64_t seq, int64_t offset)
+{
+#if !defined PLATFORM_WINDOWS
+    /*  写临时文件后rename, checkpoint不会写了一半   */
+    std::string path = m_dir + "/checkpoint";
+    std::string temp = path + ".tmp";
+    char content[64];
+    int len = snprintf(content, sizeof(content), "%llu %lld\n", (unsigned long long)seq, (long long)offset);
+    int fd = ::open(temp.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd < 0)
+    {
+        return;
+    }
+    bool written = ::write(fd, content, len) == len;
+    ::close(fd);
+    if (written)
+    {
+        rename(temp.c_str(), path.c_str());
+    }
+#else
+    (void)seq;
+    (void)offset;
+#endif
+}
+
+bool SSDBWriteSpool::readCheckpoint(uint64_t* seq, int64_t* offset)
+{
+    FILE* file = fopen((m_dir + "/checkpoint").c_str(), "r");
+    if (file == NULL)
+    {
+        return false;
+    }
+    unsigned long long fileSeq = 0;
+    long long fileOffset = 0;
+    bool success = fscanf(file, "%llu %lld", &fileSeq, &fileOffset) == 2;
+    fclose(file);
+    if (success)
+    {
+        *seq = (uint64_t)fileSeq;
+        *offset = (int64_t)fileOffset;
+    }
+    return success;
+}
+
+Status SSDBWriteSpool::append(const char* buffer, int len, int count)
+{
+    if (buffer == NULL || len <= 0 || count <= 0)
+    {
+        return Status("error");
+    }
+
+    SpoolRecordHeader header;
+    header.magic = SPOOL_RECORD_MAGIC;
+    header.len = (uint32_t)len;
+    header.count = (uint32_t)count;
+    header.checksum = spool_checksum(buffer, len);
+    int64_t need = SPOOL_HEADER_LEN + len;
+
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (m_segments.empty())
+        {
+            return Status("error");
+        }
+
+        SSDBSpoolSegment* tail = m_segments.rbegin()->second;
+        if (tail->end + need > tail->size)
+        {
+            if ((int)m_segments.size() >= m_options.maxSegments)
+            {
+                return Status("full");
+            }
+            SSDBSpoolSegment* segment = createSegment(tail->seq + 1, need > m_options.segmentBytes ? need : m_options.segmentBytes);
+            if (segment == NULL)
+            {
+                return Status("error");
+            }
+            m_segments[segment->seq] = segment;
+            tail = segment;
+        }
+
+        memcpy(tail->data + tail->end + SPOOL_HEADER_LEN, buffer, len);
+        memcpy(tail->data + tail->end, &header, sizeof(header));
+        tail->end += need;
+        m_pendingBytes += need;
+    }
+    m_written.notify_one();
+
+    return Status("ok");
+}
+
+Status SSDBWriteSpool::set(const std::string& key, const std::string& val)
+{
+    t_request.init();
+    t_request.appendStr("set");
+    t_request.appendStr(key);
+    t_request.appendStr(val);
+    t_request.endl();
+    return append(t_request.getResult(), t_request.getResultLen(), 1);
+}
+
+Status SSDBWriteSpool::del(const std::string& key)
+{
+    t_request.init();
+    t_request.appendStr("del");
+    t_request.appendStr(key);
+    t_request.endl();
+    return append(t_request.getResult(), t_request.getResultLen(), 1);
+}
+
+Status SSDBWriteSpool::hset(const std::string& name, const std::string& key, const std::string& val)
+{
+    t_request.init();
+    t_request.appendStr("hset");
+    t_request.appendStr(name);
+    t_request.appendStr(key);
+    t_request.appendStr(val);
+    t_request.endl();
+    return append(t_request.getResult(), t_request.getResultLen(), 1);
+}
+
+Status SSDBWriteSpool::hdel(const std::string& name, const std::string& key)
+{
+    t_request.init();
+    t_request.appendStr("hdel");
+    t_request.appendStr(name);
+    t_request.appendStr(key);
+    t_request.endl();
+    return append(t_request.getResult(), t_request.getResultLen(), 1);
+}
+
+Status SSDBWriteSpool::zset(const std::string& name, const std::string& key, int64_t score)
+{
+    t_request.init();
+    t_request.appendStr("zset");
+    t_request.appendStr(name);
+    t_request.appendStr(key);
+    t_request.appendInt64(score);
+    t_request.endl();
+    return append(t_request.getResult(), t_request.getResultLen(), 1);
+}
+
+Status SSDBWriteSpool::qpush(const std::string& name, const std::string& item)
+{
+    t_request.init();
+    t_request.appendStr("qpush");
+    t_request.appendStr(name);
+    t_request.appendStr(item);
+    t_request.endl();
+    return append(t_request.getResult(), t_request.getResultLen(), 1);
+}
+
+bool SSDBWriteSpool::sync()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    bool success = !m_segments.empty();
+#if !defined PLATFORM_WINDOWS
+    for (std::map<uint64_t, SSDBSpoolSegment*>::iterator iter = m_segments.begin(); iter != m_segments.end(); ++iter)
+    {
+        success = msync(iter->second->data, (size_t)iter->second->size, MS_SYNC) == 0 && success;
+    }
+#endif
+    return success;
+}
+
+bool SSDBWriteSpool::waitDrained(int timeoutMs)
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+    return m_drained.wait_for(lock, std::chrono::milliseconds(timeoutMs), [this]() {
+        return m_pendingBytes == 0;
+    });
+}
+
+int64_t SSDBWriteSpool::pendingBytes() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_pendingBytes;
+}
+
+uint64_t SSDBWriteSpool::replayedCommands() const
+{
+    return m_replayed.load(std::memory_order_relaxed);
+}
+
+uint64_t SSDBWriteSpool::failedCommands() const
+{
+    return m_failed.load(std::memory_order_relaxed);
+}
+
+int SSDBWriteSpool::collect(std::vector<int64_t>* recordEnds, std::vector<int>* recordCounts)
+{
+    const char* data = NULL;
+    int64_t offset = 0;
+    int64_t end = 0;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        std::map<uint64_t, SSDBSpoolSegment*>::iterator iter = m_segments.find(m_readSeq);
+        while (iter != m_segments.end() && m_readOffset >= iter->second->end && iter->second != m_segments.rbegin()->second)
+        {
+            /*  已重放完且不再写入的日志段   */
+            removeSegment(iter->second);
+            m_segments.erase(iter++);
+            m_readSeq = iter->first;
+            m_readOffset = 0;
+            writeCheckpoint(m_readSeq, m_readOffset);
+        }
+        if (iter == m_segments.end() || m_readOffset >= iter->second->end)
+        {
+            return 0;
+        }
+
+        /*  m_readOffset到end之间的记录不会再被修改, 可以在锁外读取    */
+        data = iter->second->data;
+        offset = m_readOffset;
+        end = iter->second->end;
+    }
+
+    recordEnds->clear();
+    recordCounts->clear();
+    m_batch.clear();
+    int commands = 0;
+    while (offset < end)
+    {
+        SpoolRecordHeader header;
+        memcpy(&header, data + offset, sizeof(header));
+        if (!m_batch.empty() && (m_batch.size() + header.len > (size_t)m_options.batchBytes || commands + (int)header.count > m_options.batchCommands))
+        {
+            break;
+        }
+
+        m_batch.append(data + offset + SPOOL_HEADER_LEN, header.len);
+        offset += SPOOL_HEADER_LEN + header.len;
+        commands += (int)header.count;
+        recordEnds->push_back(offset);
+        recordCounts->push_back((int)header.count);
+    }
+    return commands;
+}
+
+bool SSDBWriteSpool::waitBackoff(int backoffMs)
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_written.wait_for(lock, std::chrono::milliseconds(backoffMs), [this]() {
+        return !m_running;
+    });
+    return m_running;
+}
+
+void SSDBWriteSpool::run()
+{
+    std::vector<int64_t> recordEnds;
+    std::vector<int> recordCounts;
+    int backoffMs = 0;
+
+    while (true)
+    {
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_written.wait(lock, [this]() {
+                return !m_running || m_pendingBytes > 0;
+            });
+            if (!m_running)
+            {
+                break;
+            }
+        }
+
+        int count = collect(&recordEnds, &recordCounts);
+        if (count == 0)
+        {
+            continue;
+        }
+
+        int done = m_client->pipeline(m_batch.data(), (int)m_batch.size(), count, [this](int, SSDBProtocolResponse* response) {
+            if (!response->getStatus().ok())
+            {
+                m_failed.fetch_add(1, std::memory_order_relaxed);
+            }
+        });
+
+        /*  只前进到所有命令都收到response的记录   */
+        size_t records = 0;
+        int acked = 0;
+        while (records < recordCounts.size() && acked + recordCounts[records] <= done)
+        {
+            acked += recordCounts[records];
+            ++records;
+        }
+        if (records > 0)
+        {
+            uint64_t seq = 0;
+            {
+                std::lock_guard<std::mutex> lock(m_mutex);
+                m_pendingBytes -= recordEnds[records - 1] - m_readOffset;
+                m_readOffset = recordEnds[records - 1];
+                seq = m_readSeq;
+                m_replayed.fetch_add(acked, std::memory_order_relaxed);
+                if (m_pendingBytes == 0)
+                {
+                    m_drained.notify_all();
+                }
+            }
+            /*  读位置只由本线程修改, 可以在锁外写checkpoint  */
+            writeCheckpoint(seq, recordEnds[records - 1]);
+        }
+
+        if (done < count)
+        {
+            backoffMs = backoffMs == 0 ? m_options.minBackoffMs : backoffMs * 2;
+            backoffMs = backoffMs < m_options.maxBackoffMs ? backoffMs : m_options.maxBackoffMs;
+            if (!waitBackoff(backoffMs))
+            {
+                break;
+            }
+        }
+        else
+        {
+            backoffMs = 0;
+        }
+    }
+}
@@ -0,0 +1,114 @@
+#ifndef __SSDB_SPOOL_H__
+#define __SSDB_SPOOL_H__
+
+#include <string>
+#include <map>
+#include <mutex>
+#include <thread>
+#include <atomic>
+#include <condition_variable>
+
+#include "ssdb_client.h"
+
+/*  磁盘写缓冲(spool): 写请求编码后追加到目录下mmap的日志段文件(spool.<序号>.log)中即返回,
+    后台线程在连接可用时把日志按顺序以pipeline批量重放到ssdb, 并把重放进度写入checkpoint文件.
+    -   写入只是一次内存拷贝, ssdb不可用或写入突发时不阻塞调用线程; 日志段总数达到maxSegments时写入返回Status("full")
+    -   进程重启后从checkpoint继续重放未完成的日志(记录带校验, 末尾写了一半的记录被丢弃)
+    -   至少一次: 重放过程中连接断开时, 未确认的命令会在重连后重发
+    -   数据写入mmap即可在进程崩溃后保留, 需要在机器掉电后保留时调用sync()
+    -   仅支持Linux等POSIX系统
+
+    SSDBClient drainClient;     // 只供spool的后台线程使用
+    drainClient.connect("127.0.0.1", 8888);
+    SSDBWriteSpool spool(&drainClient);
+    spool.open("/data/ssdb_spool");
+    spool.set("k", "v");        // 任意线程   */
+
+struct SSDBSpoolOptions
+{
+    SSDBSpoolOptions() : segmentBytes(64 * 1024 * 1024), maxSegments(16), batchBytes(1024 * 1024), batchCommands(1024),
+        minBackoffMs(10), maxBackoffMs(1000)
+    {
+    }
+
+    int64_t                 segmentBytes;
+    int                     maxSegments;
+    /*  每次pipeline重放的最大字节数与命令数(至少一条记录)    */
+    int                     batchBytes;
+    int                     batchCommands;
+    /*  重放失败后的等待时间, 从min开始每次翻倍直到max   */
+    int                     minBackoffMs;
+    int                     maxBackoffMs;
+};
+
+struct SSDBSpoolSegment;
+
+class SSDBWriteSpool
+{
+public:
+    explicit SSDBWriteSpool(SSDBClient* client, const SSDBSpoolOptions& options = SSDBSpoolOptions());
+    /*  停止后台线程, 未重放的日志保留在磁盘上    */
+    ~SSDBWriteSpool();
+
+    /*  打开(或恢复)dir下的日志并启动后台重放线程, dir需已存在  */
+    bool                    open(const std::string& dir);
+    void                    close();
+
+    /*  以下均线程安全  */
+    Status                  set(const std::string& key, const std::string& val);
+    Status                  del(const std::string& key);
+    Status                  hset(const std::string& name, const std::string& key, const std::string& val);
+    Status                  hdel(const std::string& name, const std::string& key);
+    Status                  zset(const std::string& name, const std::string& key, int64_t score);
+    Status                  qpush(const std::string& name, const std::string& item);
+    /*  追加已编码的count个请求(response被丢弃)    */
+    Status                  append(const char* buffer, int len, int count);
+
+    /*  把已写入的日志刷到磁盘   */
+    bool                    sync();
+    /*  等待已写入的日志全部重放, 超时返回false  */
+    bool                    waitDrained(int timeoutMs);
+
+    /*  尚未重放的字节数    */
+    int64_t                 pendingBytes() const;
+    uint64_t                replayedCommands() const;
+    /*  重放后服务端返回非ok的命令数  */
+    uint64_t                failedCommands() const;
+
+private:
+    SSDBWriteSpool(const SSDBWriteSpool&);
+    void operator=(const SSDBWriteSpool&);
+
+    SSDBSpoolSegment*       createSegment(uint64_t seq, int64_t size);
+    bool                    recover();
+    void                    removeSegment(SSDBSpoolSegment* segment);
+    void                    writeCheckpoint(uint64_t seq, int64_t offset);
+    bool                    readCheckpoint(uint64_t* seq, int64_t* offset);
+    void                    run();
+    /*  从读位置收集一批记录到m_batch, 返回命令数   */
+    int                     collect(std::vector<int64_t>* recordEnds, std::vector<int>* recordCounts);
+    bool                    waitBackoff(int backoffMs);
+
+private:
+    SSDBClient*                                 m_client;
+    SSDBSpoolOptions                            m_options;
+    std::string                                 m_dir;
+
+    mutable std::mutex                          m_mutex;
+    std::condition_variable                     m_written;
+    std::condition_variable                     m_drained;
+    std::map<uint64_t, SSDBSpoolSegment*>       m_segments;
+    /*  写位置为最后一个日志段的end, 读位置为(m_readSeq, m_readOffset)  */
+    uint64_t                                    m_readSeq;
+    int64_t                                     m_readOffset;
+    int64_t                                     m_pendingBytes;
+
+    std::string                                 m_batch;
+    std::atomic<uint64_t>                       m_replayed;
+    std::atomic<uint64_t>                       m_failed;
+
+    std::thread                                 m_thread;
+    bool                                        m_running;
+};
+
+#endif
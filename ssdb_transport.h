@@ -0,0 +1,28 @@
+#ifndef __SSDB_TRANSPORT_H__
+#define __SSDB_TRANSPORT_H__
+
+#include <string>
+#include <memory>
+
+/*  请求传输层
+    SSDBClient只负责命令编解码, 设置transport后请求的收发由transport完成.
+    transport实现需要线程安全: 每个线程使用自己的SSDBClient(非线程安全), 多个SSDBClient共享同一个transport. */
+
+/*  response缓冲区: 调用request时reply非空且由调用方独占, transport可以直接写入;
+    transport也可以把reply替换为与其他请求共享的缓冲区(不能是调用时传入的缓冲区), 此时调用方只能读取  */
+typedef std::shared_ptr<std::string> SSDBReplyBuffer;
+
+class SSDBTransport
+{
+public:
+    virtual ~SSDBTransport()
+    {
+    }
+
+    /*  发送len字节的已编码请求(包含count个命令), 把count个完整response依次写入reply.
+        失败(连接断开等)返回false   */
+    virtual bool            request(const char* buffer, int len, int count, SSDBReplyBuffer& reply) = 0;
+    virtual bool            isconnected() const = 0;
+};
+
+#endif
@@ -0,0 +1,1097 @@
+#include <string.h>
+
+#include "buffer.h"
+#include "socketlibtypes.h"
+#include "socketlibfunction.h"
+
+#include "ssdb_protocol.h"
+#include "ssdb_uring_transport.h"
+
+#if defined __linux__ && defined __has_include
+#if __has_include(<linux/io_uring.h>)
+#include <linux/io_uring.h>
+#if defined IORING_RECV_MULTISHOT
+#define SSDB_HAVE_IO_URING
+#endif
+#endif
+#endif
+
+#if defined SSDB_HAVE_IO_URING
+
+#include <errno.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <sys/eventfd.h>
+
+/*  所有连接断开时两次重连之间的最小间隔(毫秒)   */
+static const int64_t RECONNECT_INTERVAL_MS = 1000;
+
+static const unsigned int SQ_ENTRIES = 256;
+static const unsigned int CQ_ENTRIES = 4096;
+/*  每个连接注册的发送缓冲区大小, 更大的请求分多次发送   */
+static const int SEND_BUFFER_LEN = 64 * 1024;
+/*  一次发送的数据达到此长度时使用零拷贝发送, 小数据由内核拷贝更快    */
+static const int ZEROCOPY_MIN_LEN = 16 * 1024;
+/*  provided buffer ring: 所有连接共享, 数量必须是2的幂  */
+static const unsigned int RECV_BUFFER_COUNT = 256;
+static const int RECV_BUFFER_LEN = 16 * 1024;
+static const unsigned short RECV_BUFFER_GROUP = 0;
+
+/*  user_data: 高32位为连接的generation, 用来丢弃已关闭连接的迟到事件  */
+enum
+{
+    OP_WAKEUP = 1,
+    OP_RECV = 2,
+    OP_SEND = 3,
+    /*  等待非阻塞连接完成的POLL_ADD与它链接的超时  */
+    OP_CONNECT = 4,
+    OP_CONNECT_TIMEOUT = 5,
+};
+
+static uint64_t make_user_data(int op, int index, uint32_t generation)
+{
+    return ((uint64_t)generation << 32) | ((uint64_t)op << 24) | (uint64_t)index;
+}
+
+struct SSDBUringRing
+{
+    int                             fd;
+    unsigned int                    sqEntries;
+    unsigned int*                   sqHead;
+    unsigned int*                   sqTail;
+    unsigned int*                   sqMask;
+    unsigned int*                   sqArray;
+    struct io_uring_sqe*            sqes;
+    unsigned int*                   cqHead;
+    unsigned int*                   cqTail;
+    unsigned int*                   cqMask;
+    struct io_uring_cqe*            cqes;
+
+    /*  已填充但尚未对内核可见的SQ尾部  */
+    unsigned int                    localTail;
+
+    void*                           sqRing;
+    size_t                          sqRingLen;
+    void*                           cqRing;
+    size_t                          cqRingLen;
+    size_t                          sqesLen;
+};
+
+struct SSDBUringConnection
+{
+    int                             index;
+    uint32_t                        generation;
+    sock                            fd;
+    buffer_s*                       recvBuffer;
+
+    /*  已分配到此连接的请求, head为最早的请求, sendCursor为第一个尚未发送完的请求 */
+    SSDBSubmission*                 head;
+    SSDBSubmission*                 tail;
+    SSDBSubmission*                 sendCursor;
+    int                             inflight;
+
+    /*  注册的发送缓冲区, sending为其中待发送的字节数(0表示空闲), sendOffset为已发送的字节数  */
+    char*                           sendBuffer;
+    int                             sending;
+    int                             sendOffset;
+    bool                            sendZerocopy;
+    /*  尚未收到通知的零拷贝发送数, 为0之前不能改写发送缓冲区(连接关闭后同样如此)   */
+    int                             zerocopyPending;
+
+    /*  正在非阻塞连接(fd有效但尚未连上), 期间分配的请求在连上后发送   */
+    bool                            connecting;
+    struct __kernel_timespec        connectTimeout;
+};
+
+static int uring_setup(SSDBUringRing* ring)
+{
+    memset(ring, 0, sizeof(*ring));
+    ring->fd = -1;
+
+    struct io_uring_params params;
+    memset(&params, 0, sizeof(params));
+    params.flags = IORING_SETUP_CQSIZE | IORING_SETUP_COOP_TASKRUN;
+    params.cq_entries = CQ_ENTRIES;
+    int fd = (int)syscall(__NR_io_uring_setup, SQ_ENTRIES, &params);
+    if (fd < 0 && errno == EINVAL)
+    {
+        /*  COOP_TASKRUN需要5.19  */
+        params.flags &= ~IORING_SETUP_COOP_TASKRUN;
+        fd = (int)syscall(__NR_io_uring_setup, SQ_ENTRIES, &params);
+    }
+    if (fd < 0)
+    {
+        return -1;
+    }
+    ring->fd = fd;
+
+    ring->sqRingLen = params.sq_off.array + params.sq_entries * sizeof(unsigned int);
+    ring->cqRingLen = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+    if (params.features & IORING_FEAT_SINGLE_MMAP)
+    {
+        ring->sqRingLen = ring->cqRingLen = ring->sqRingLen > ring->cqRingLen ? ring->sqRingLen : ring->cqRingLen;
+    }
+
+    ring->sqRing = mmap(NULL, ring->sqRingLen, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQ_RING);
+    if (ring->sqRing == MAP_FAILED)
+    {
+        ring->sqRing = NULL;
+        return -1;
+    }
+    if (params.features & IORING_FEAT_SINGLE_MMAP)
+    {
+        ring->cqRing = ring->sqRing;
+    }
+    else
+    {
+        ring->cqRing = mmap(NULL, ring->cqRingLen, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_CQ_RING);
+        if (ring->cqRing == MAP_FAILED)
+        {
+            ring->cqRing = NULL;
+            return -1;
+        }
+    }
+    ring->sqesLen = params.sq_entries * sizeof(struct io_uring_sqe);
+    void* sqes = mmap(NULL, ring->sqesLen, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQES);
+    if (sqes == MAP_FAILED)
+    {
+        return -1;
+    }
+
+    char* sq = (char*)ring->sqRing;
+    char* cq = (char*)ring->cqRing;
+    ring->sqEntries = params.sq_entries;
+    ring->sqHead = (unsigned int*)(sq + params.sq_off.head);
+    ring->sqTail = (unsigned int*)(sq + params.sq_off.tail);
+    ring->sqMask = (unsigned int*)(sq + params.sq_off.ring_mask);
+    ring->sqArray = (unsigned int*)(sq + params.sq_off.array);
+    ring->sqes = (struct io_uring_sqe*)sqes;
+    ring->cqHead = (unsigned int*)(cq + params.cq_off.head);
+    ring->cqTail = (unsigned int*)(cq + params.cq_off.tail);
+    ring->cqMask = (unsigned int*)(cq + params.cq_off.ring_mask);
+    ring->cqes = (struct io_uring_cqe*)(cq + params.cq_off.cqes);
+    ring->localTail = *ring->sqTail;
+    return 0;
+}
+
+static void uring_destroy(SSDBUringRing* ring)
+{
+    if (ring->sqes != NULL)
+    {
+        munmap(ring->sqes, ring->sqesLen);
+    }
+    if (ring->cqRing != NULL && ring->cqRing != ring->sqRing)
+    {
+        munmap(ring->cqRing, ring->cqRingLen);
+    }
+    if (ring->sqRing != NULL)
+    {
+        munmap(ring->sqRing, ring->sqRingLen);
+    }
+    if (ring->fd >= 0)
+    {
+        close(ring->fd);
+    }
+    memset(ring, 0, sizeof(*ring));
+    ring->fd = -1;
+}
+
+/*  提交所有已填充的SQE, waitNr>0时同时等待完成事件 */
+static int uring_enter(SSDBUringRing* ring, unsigned int waitNr)
+{
+    __atomic_store_n(ring->sqTail, ring->localTail, __ATOMIC_RELEASE);
+    unsigned int toSubmit = ring->localTail - __atomic_load_n(ring->sqHead, __ATOMIC_ACQUIRE);
+    if (toSubmit == 0 && waitNr == 0)
+    {
+        return 0;
+    }
+    int ret = (int)syscall(__NR_io_uring_enter, ring->fd, toSubmit, waitNr, waitNr > 0 ? IORING_ENTER_GETEVENTS : 0, NULL, 0);
+    return ret < 0 ? -errno : ret;
+}
+
+/*  保证SQ中至少有count个空位, SQ已满时先提交已有的SQE.
+    CQ溢出(-EBUSY)时只有loop收割完成事件后内核才会再接受提交, 不能在这里重试, 返回false由调用者放弃或推迟本次操作  */
+static bool uring_reserve(SSDBUringRing* ring, unsigned int count)
+{
+    while (ring->localTail - __atomic_load_n(ring->sqHead, __ATOMIC_ACQUIRE) + count > ring->sqEntries)
+    {
+        int ret = uring_enter(ring, 0);
+        if (ret < 0 && ret != -EINTR)
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+static struct io_uring_sqe* uring_get_sqe(SSDBUringRing* ring)
+{
+    if (!uring_reserve(ring, 1))
+    {
+        return NULL;
+    }
+
+    unsigned int index = ring->localTail & *ring->sqMask;
+    struct io_uring_sqe* sqe = &ring->sqes[index];
+    memset(sqe, 0, sizeof(*sqe));
+    ring->sqArray[index] = index;
+    ++ring->localTail;
+    return sqe;
+}
+
+SSDBUringTransport::SSDBUringTransport()
+{
+    ox_socket_init();
+    m_ring = new SSDBUringRing;
+    memset(m_ring, 0, sizeof(*m_ring));
+    m_ring->fd = -1;
+    m_cpu = -1;
+    m_running = false;
+    m_sleeping = false;
+    m_connected = 0;
+    m_pending = 0;
+    m_wakeupFd = -1;
+    m_wakeupValue = 0;
+    m_wakeupArmed = false;
+    m_lastReconnect = 0;
+    m_sendBuffers = NULL;
+    m_recvBuffers = NULL;
+    m_bufRing = NULL;
+    m_bufTail = 0;
+    m_zerocopy = true;
+    m_port = 0;
+    m_timeout = 5;
+}
+
+SSDBUringTransport::~SSDBUringTransport()
+{
+    stop();
+    delete m_ring;
+    m_ring = NULL;
+}
+
+bool SSDBUringTransport::available()
+{
+    SSDBUringTransport probe;
+    bool ok = probe.setup(1);
+    probe.teardown();
+    return ok;
+}
+
+bool SSDBUringTransport::start(const char* ip, int port, int connections, uint32_t timeoutSec, int cpu)
+{
+    if (m_running || m_thread.joinable() || connections <= 0)
+    {
+        return false;
+    }
+
+    m_ip = ip;
+    m_port = port;
+    m_timeout = timeoutSec;
+    m_cpu = cpu;
+
+    if (!setup(connections))
+    {
+        teardown();
+        return false;
+    }
+
+    /*  所有连接并行建立  */
+    std::vector<sock> fds(connections, SOCKET_ERROR);
+    ox_socket_connect_all(ip, port, connections, &fds[0], timeoutSec);
+    for (int i = 0; i < connections; ++i)
+    {
+        SSDBUringConnection* connection = new SSDBUringConnection;
+        connection->index = i;
+        connection->generation = 0;
+        connection->fd = SOCKET_ERROR;
+        connection->recvBuffer = ox_buffer_new(DEFAULT_SSDBPROTOCOL_LEN);
+        connection->head = NULL;
+        connection->tail = NULL;
+        connection->sendCursor = NULL;
+        connection->inflight = 0;
+        connection->sendBuffer = m_sendBuffers + (size_t)i * SEND_BUFFER_LEN;
+        connection->sending = 0;
+        connection->sendOffset = 0;
+        connection->sendZerocopy = false;
+        connection->zerocopyPending = 0;
+        connection->connecting = false;
+        memset(&connection->connectTimeout, 0, sizeof(connection->connectTimeout));
+        m_connections.push_back(connection);
+        attach(connection, fds[i]);
+    }
+    armWakeup();
+
+    m_running = true;
+    m_thread = std::thread(&SSDBUringTransport::loop, this);
+    return m_connected > 0;
+}
+
+void SSDBUringTransport::stop()
+{
+    /*  I/O线程可能已因ring出错而退出   */
+    m_running = false;
+    if (m_thread.joinable())
+    {
+        wakeup();
+        m_thread.join();
+    }
+
+    /*  I/O线程已退出, 剩余的请求全部失败   */
+    for (size_t i = 0; i < m_connections.size(); ++i)
+    {
+        closeConnection(m_connections[i]);
+        ox_buffer_delete(m_connections[i]->recvBuffer);
+        delete m_connections[i];
+    }
+    m_connections.clear();
+    SSDBSubmission* submission = NULL;
+    while ((submission = m_queue.pop()) != NULL)
+    {
+        finish(submission, false);
+    }
+
+    teardown();
+}
+
+bool SSDBUringTransport::setup(int connections)
+{
+    if (uring_setup(m_ring) < 0)
+    {
+        return false;
+    }
+
+    m_wakeupFd = eventfd(0, EFD_CLOEXEC);
+    if (m_wakeupFd < 0)
+    {
+        return false;
+    }
+
+    /*  每个连接一块发送缓冲区, 注册后内核不再需要每次pin用户内存    */
+    size_t sendLen = (size_t)connections * SEND_BUFFER_LEN;
+    void* memory = NULL;
+    if (posix_memalign(&memory, 4096, sendLen) != 0)
+    {
+        return false;
+    }
+    m_sendBuffers = (char*)memory;
+    std::vector<struct iovec> iovs(connections);
+    for (int i = 0; i < connections; ++i)
+    {
+        iovs[i].iov_base = m_sendBuffers + (size_t)i * SEND_BUFFER_LEN;
+        iovs[i].iov_len = SEND_BUFFER_LEN;
+    }
+    if (syscall(__NR_io_uring_register, m_ring->fd, IORING_REGISTER_BUFFERS, &iovs[0], connections) < 0)
+    {
+        return false;
+    }
+
+    /*  provided buffer ring, 由multishot recv直接从中取用  */
+    memory = NULL;
+    if (posix_memalign(&memory, 4096, (size_t)RECV_BUFFER_COUNT * RECV_BUFFER_LEN) != 0)
+    {
+        return false;
+    }
+    m_recvBuffers = (char*)memory;
+    memory = NULL;
+    size_t ringLen = RECV_BUFFER_COUNT * sizeof(struct io_uring_buf);
+    if (posix_memalign(&memory, 4096, ringLen) != 0)
+    {
+        return false;
+    }
+    memset(memory, 0, ringLen);
+    m_bufRing = memory;
+
+    struct io_uring_buf_reg reg;
+    memset(&reg, 0, sizeof(reg));
+    reg.ring_addr = (uint64_t)(uintptr_t)m_bufRing;
+    reg.ring_entries = RECV_BUFFER_COUNT;
+    reg.bgid = RECV_BUFFER_GROUP;
+    if (syscall(__NR_io_uring_register, m_ring->fd, IORING_REGISTER_PBUF_RING, &reg, 1) < 0)
+    {
+        return false;
+    }
+
+    m_bufTail = 0;
+    for (unsigned int i = 0; i < RECV_BUFFER_COUNT; ++i)
+    {
+        recycle(i);
+    }
+    m_zerocopy = true;
+    return true;
+}
+
+void SSDBUringTransport::teardown()
+{
+    /*  关闭ring后内核释放注册的内存, 之后才能free   */
+    uring_destroy(m_ring);
+    if (m_wakeupFd >= 0)
+    {
+        close(m_wakeupFd);
+        m_wakeupFd = -1;
+    }
+    free(m_sendBuffers);
+    m_sendBuffers = NULL;
+    free(m_recvBuffers);
+    m_recvBuffers = NULL;
+    free(m_bufRing);
+    m_bufRing = NULL;
+}
+
+bool SSDBUringTransport::isconnected() const
+{
+    return m_connected > 0;
+}
+
+int SSDBUringTransport::pending() const
+{
+    return m_pending;
+}
+
+bool SSDBUringTransport::request(const char* buffer, int len, int count, SSDBReplyBuffer& reply)
+{
+    SSDBWaitSubmission submission;
+    submission.buffer = buffer;
+    submission.len = len;
+    submission.count = count;
+    submission.reply = reply.get();
+
+    post(&submission);
+    return submission.completion.wait();
+}
+
+void SSDBUringTransport::post(SSDBSubmission* submission)
+{
+    submission->sent = 0;
+    submission->received = 0;
+    submission->next = NULL;
+    ++m_pending;
+
+    if (!m_running)
+    {
+        finish(submission, false);
+        return;
+    }
+
+    m_queue.push(submission);
+    if (m_sleeping.load() && m_sleeping.exchange(false))
+    {
+        wakeup();
+    }
+}
+
+void SSDBUringTransport::finish(SSDBSubmission* submission, bool success)
+{
+    --m_pending;
+    submission->complete(success);
+}
+
+void SSDBUringTransport::wakeup()
+{
+    uint64_t one = 1;
+    if (write(m_wakeupFd, &one, sizeof(one)) < 0)
+    {
+    }
+}
+
+bool SSDBUringTransport::reconnect(SSDBUringConnection* connection)
+{
+    /*  非阻塞连接, 由POLL_ADD等待完成并以链接的超时限制等待时间, 不阻塞I/O线程  */
+    sock fd = SOCKET_ERROR;
+    int ret = ox_socket_connect_nonblock(m_ip.c_str(), m_port, &fd);
+    if (ret > 0)
+    {
+        return attach(connection, fd);
+    }
+    if (ret < 0)
+    {
+        return false;
+    }
+
+    /*  POLL_ADD与LINK_TIMEOUT必须相邻提交   */
+    if (!uring_reserve(m_ring, 2))
+    {
+        ox_socket_close(fd);
+        return false;
+    }
+    connection->fd = fd;
+    connection->connecting = true;
+    connection->connectTimeout.tv_sec = m_timeout > 0 ? m_timeout : 1;
+    connection->connectTimeout.tv_nsec = 0;
+
+    struct io_uring_sqe* sqe = uring_get_sqe(m_ring);
+    sqe->opcode = IORING_OP_POLL_ADD;
+    sqe->fd = fd;
+    sqe->poll32_events = POLLOUT;
+    sqe->flags = IOSQE_IO_LINK;
+    sqe->user_data = make_user_data(OP_CONNECT, connection->index, connection->generation);
+
+    sqe = uring_get_sqe(m_ring);
+    sqe->opcode = IORING_OP_LINK_TIMEOUT;
+    sqe->addr = (uint64_t)(uintptr_t)&connection->connectTimeout;
+    sqe->len = 1;
+    sqe->user_data = make_user_data(OP_CONNECT_TIMEOUT, connection->index, connection->generation);
+    return true;
+}
+
+void SSDBUringTransport::onConnect(SSDBUringConnection* connection, int res)
+{
+    /*  res为-ECANCELED表示超时 */
+    sock fd = connection->fd;
+    if (res < 0 || ox_socket_connect_error(fd) != 0)
+    {
+        closeConnection(connection);
+        return;
+    }
+
+    connection->fd = SOCKET_ERROR;
+    connection->connecting = false;
+    if (!attach(connection, fd))
+    {
+        /*  attach已关闭fd, 排队的请求失败   */
+        closeConnection(connection);
+    }
+}
+
+bool SSDBUringTransport::attach(SSDBUringConnection* connection, int fd)
+{
+    if (fd == SOCKET_ERROR)
+    {
+        return false;
+    }
+    if (!ox_socket_setup_async(fd))
+    {
+        ox_socket_close(fd);
+        return false;
+    }
+
+    connection->fd = fd;
+    connection->sending = 0;
+    connection->sendOffset = 0;
+    ox_buffer_init(connection->recvBuffer);
+    ++m_connected;
+    armRecv(connection);
+    return true;
+}
+
+void SSDBUringTransport::closeConnection(SSDBUringConnection* connection)
+{
+    if (connection->fd != SOCKET_ERROR)
+    {
+        /*  shutdown让仍在内核中的recv/send立即结束, 迟到的完成事件按generation丢弃  */
+        shutdown(connection->fd, SHUT_RDWR);
+        ox_socket_close(connection->fd);
+        connection->fd = SOCKET_ERROR;
+        ++connection->generation;
+        if (!connection->connecting)
+        {
+            --m_connected;
+        }
+        connection->connecting = false;
+    }
+
+    while (connection->head != NULL)
+    {
+        SSDBSubmission* submission = connection->head;
+        connection->head = submission->next;
+        finish(submission, false);
+    }
+    connection->tail = NULL;
+    connection->sendCursor = NULL;
+    connection->inflight = 0;
+    connection->sending = 0;
+    connection->sendOffset = 0;
+}
+
+void SSDBUringTransport::assign(SSDBSubmission* submission)
+{
+    SSDBUringConnection* best = select();
+    if (best == NULL && ox_now_ms() - m_lastReconnect >= RECONNECT_INTERVAL_MS)
+    {
+        /*  所有断开的连接同时发起非阻塞连接    */
+        m_lastReconnect = ox_now_ms();
+        for (size_t i = 0; i < m_connections.size(); ++i)
+        {
+            if (m_connections[i]->fd == SOCKET_ERROR)
+            {
+                reconnect(m_connections[i]);
+            }
+        }
+        best = select();
+    }
+
+    if (best == NULL)
+    {
+        finish(submission, false);
+        return;
+    }
+
+    submission->next = NULL;
+    if (best->tail != NULL)
+    {
+        best->tail->next = submission;
+    }
+    else
+    {
+        best->head = submission;
+    }
+    best->tail = submission;
+    if (best->sendCursor == NULL)
+    {
+        best->sendCursor = submission;
+    }
+    ++best->inflight;
+}
+
+SSDBUringConnection* SSDBUringTransport::select()
+{
+    /*  选择未完成请求最少的连接, 没有已连接的连接时排在正在连接的连接上  */
+    SSDBUringConnection* best = NULL;
+    SSDBUringConnection* connecting = NULL;
+    for (size_t i = 0; i < m_connections.size(); ++i)
+    {
+        SSDBUringConnection* connection = m_connections[i];
+        if (connection->connecting)
+        {
+            connecting = connecting == NULL || connection->inflight < connecting->inflight ? connection : connecting;
+        }
+        else if (connection->fd != SOCKET_ERROR && (best == NULL || connection->inflight < best->inflight))
+        {
+            best = connection;
+        }
+    }
+    return best != NULL ? best : connecting;
+}
+
+void SSDBUringTransport::armWakeup()
+{
+    struct io_uring_sqe* sqe = uring_get_sqe(m_ring);
+    m_wakeupArmed = sqe != NULL;
+    if (sqe == NULL)
+    {
+        /*  loop在休眠前重试    */
+        return;
+    }
+    sqe->opcode = IORING_OP_READ;
+    sqe->fd = m_wakeupFd;
+    sqe->addr = (uint64_t)(uintptr_t)&m_wakeupValue;
+    sqe->len = sizeof(m_wakeupValue);
+    sqe->user_data = make_user_data(OP_WAKEUP, 0, 0);
+}
+
+void SSDBUringTransport::armRecv(SSDBUringConnection* connection)
+{
+    struct io_uring_sqe* sqe = uring_get_sqe(m_ring);
+    if (sqe == NULL)
+    {
+        closeConnection(connection);
+        return;
+    }
+    sqe->opcode = IORING_OP_RECV;
+    sqe->fd = connection->fd;
+    sqe->flags = IOSQE_BUFFER_SELECT;
+    sqe->buf_group = RECV_BUFFER_GROUP;
+    sqe->ioprio = IORING_RECV_MULTISHOT;
+    sqe->user_data = make_user_data(OP_RECV, connection->index, connection->generation);
+}
+
+void SSDBUringTransport::flush(SSDBUringConnection* connection)
+{
+    if (connection->fd == SOCKET_ERROR || connection->connecting || connection->sending > 0 || connection->zerocopyPending > 0 || connection->sendCursor == NULL)
+    {
+        return;
+    }
+    if (!uring_reserve(m_ring, 1))
+    {
+        /*  暂时无法提交(如CQ溢出), 请求留在队列中, loop收割完成事件后再发送    */
+        return;
+    }
+
+    /*  把尚未发送的请求依次拷贝到注册的发送缓冲区, 拷贝后即视为已发送:
+        response的完成事件可能先于send的完成事件被处理, 请求随后可能已被销毁   */
+    int staged = 0;
+    while (connection->sendCursor != NULL && staged < SEND_BUFFER_LEN)
+    {
+        SSDBSubmission* submission = connection->sendCursor;
+        int len = submission->len - submission->sent;
+        if (len > SEND_BUFFER_LEN - staged)
+        {
+            len = SEND_BUFFER_LEN - staged;
+        }
+        memcpy(connection->sendBuffer + staged, submission->buffer + submission->sent, len);
+        staged += len;
+        submission->sent += len;
+        if (submission->sent == submission->len)
+        {
+            connection->sendCursor = submission->next;
+        }
+    }
+
+    connection->sending = staged;
+    connection->sendOffset = 0;
+    submitSend(connection);
+}
+
+void SSDBUringTransport::submitSend(SSDBUringConnection* connection)
+{
+    struct io_uring_sqe* sqe = uring_get_sqe(m_ring);
+    if (sqe == NULL)
+    {
+        closeConnection(connection);
+        return;
+    }
+
+    int len = connection->sending - connection->sendOffset;
+    connection->sendZerocopy = m_zerocopy && len >= ZEROCOPY_MIN_LEN;
+    sqe->opcode = IORING_OP_SEND;
+    sqe->fd = connection->fd;
+    sqe->addr = (uint64_t)(uintptr_t)(connection->sendBuffer + connection->sendOffset);
+    sqe->len = len;
+    sqe->msg_flags = MSG_NOSIGNAL;
+    if (connection->sendZerocopy)
+    {
+        /*  直接从注册的缓冲区发送, 内核不再拷贝也不再pin内存  */
+        sqe->opcode = IORING_OP_SEND_ZC;
+        sqe->ioprio = IORING_RECVSEND_FIXED_BUF;
+        sqe->buf_index = connection->index;
+    }
+    sqe->user_data = make_user_data(OP_SEND, connection->index, connection->generation);
+}
+
+void SSDBUringTransport::onSend(SSDBUringConnection* connection, int res)
+{
+    if ((res == -EOPNOTSUPP || res == -EINVAL) && connection->sendZerocopy)
+    {
+        /*  内核或socket类型不支持零拷贝, 之后改为普通send   */
+        m_zerocopy = false;
+        res = 0;
+    }
+    else if (res == -EAGAIN || res == -EINTR)
+    {
+        res = 0;
+    }
+    else if (res < 0)
+    {
+        closeConnection(connection);
+        return;
+    }
+
+    connection->sendOffset += res;
+    if (connection->sendOffset < connection->sending)
+    {
+        /*  只发送了一部分, 剩余数据仍在发送缓冲区中  */
+        submitSend(connection);
+    }
+    else
+    {
+        connection->sending = 0;
+        connection->sendOffset = 0;
+    }
+}
+
+void SSDBUringTransport::onRecv(SSDBUringConnection* connection, int res, unsigned int flags)
+{
+    if (flags & IORING_CQE_F_BUFFER)
+    {
+        unsigned int bid = flags >> IORING_CQE_BUFFER_SHIFT;
+        if (res > 0 && !consume(connection, m_recvBuffers + (size_t)bid * RECV_BUFFER_LEN, res))
+        {
+            /*  没有对应请求的response, 协议已错乱  */
+            closeConnection(connection);
+        }
+        recycle(bid);
+    }
+
+    if (res == 0 || (res < 0 && res != -ENOBUFS))
+    {
+        /*  对端关闭或出错    */
+        closeConnection(connection);
+    }
+    else if (connection->fd != SOCKET_ERROR && !(flags & IORING_CQE_F_MORE))
+    {
+        /*  multishot结束(例如provided buffer暂时用完), 重新提交  */
+        armRecv(connection);
+    }
+}
+
+bool SSDBUringTransport::consume(SSDBUringConnection* connection, const char* data, int len)
+{
+    buffer_s* buffer = connection->recvBuffer;
+    if (ox_buffer_getreadvalidcount(buffer) == 0)
+    {
+        /*  没有残余数据时直接在provided buffer中解析   */
+        int used = dispatch(connection, data, len);
+        if (used < 0)
+        {
+            return false;
+        }
+        data += used;
+        len -= used;
+        if (len == 0)
+        {
+            return true;
+        }
+    }
+
+    if (ox_buffer_getwritevalidcount(buffer) < len)
+    {
+        ox_buffer_adjustto_head(buffer);
+    }
+    if (ox_buffer_getwritevalidcount(buffer) < len)
+    {
+        /*  扩大缓冲区   */
+        int size = ox_buffer_getsize(buffer) * 2;
+        while (size - ox_buffer_getreadvalidcount(buffer) < len)
+        {
+            size *= 2;
+        }
+        buffer_s* temp = ox_buffer_new(size);
+        ox_buffer_write(temp, ox_buffer_getreadptr(buffer), ox_buffer_getreadvalidcount(buffer));
+        ox_buffer_delete(buffer);
+        connection->recvBuffer = buffer = temp;
+    }
+    ox_buffer_write(buffer, data, len);
+
+    int used = dispatch(connection, ox_buffer_getreadptr(buffer), ox_buffer_getreadvalidcount(buffer));
+    if (used < 0)
+    {
+        return false;
+    }
+    ox_buffer_addreadpos(buffer, used);
+    return true;
+}
+
+int SSDBUringTransport::dispatch(SSDBUringConnection* connection, const char* data, int len)
+{
+    int used = 0;
+    int packetLen = 0;
+    while ((packetLen = SSDBProtocolResponse::check_ssdb_packet(data + used, len - used)) > 0)
+    {
+        SSDBSubmission* submission = connection->head;
+        if (submission == NULL || submission == connection->sendCursor)
+        {
+            return -1;
+        }
+
+        submission->reply->append(data + used, packetLen);
+        used += packetLen;
+        if (++submission->received == submission->count)
+        {
+            connection->head = submission->next;
+            if (connection->head == NULL)
+            {
+                connection->tail = NULL;
+            }
+            --connection->inflight;
+            finish(submission, true);
+        }
+    }
+
+    return used;
+}
+
+void SSDBUringTransport::recycle(unsigned int bid)
+{
+    /*  io_uring_buf_ring在C++中的布局与C不同(空结构体占1字节), 直接按io_uring_buf数组访问,
+        ring的tail与bufs[0].resv重叠    */
+    struct io_uring_buf* bufs = (struct io_uring_buf*)m_bufRing;
+    struct io_uring_buf* buf = &bufs[m_bufTail & (RECV_BUFFER_COUNT - 1)];
+    buf->addr = (uint64_t)(uintptr_t)(m_recvBuffers + (size_t)bid * RECV_BUFFER_LEN);
+    buf->len = RECV_BUFFER_LEN;
+    buf->bid = (unsigned short)bid;
+    ++m_bufTail;
+    __atomic_store_n(&bufs[0].resv, m_bufTail, __ATOMIC_RELEASE);
+}
+
+void SSDBUringTransport::loop()
+{
+    if (m_cpu >= 0)
+    {
+        ssdb_thread_bind_cpu(m_cpu);
+    }
+
+    while (m_running)
+    {
+        SSDBSubmission* submission = NULL;
+        while ((submission = m_queue.pop()) != NULL)
+        {
+            assign(submission);
+        }
+        for (size_t i = 0; i < m_connections.size(); ++i)
+        {
+            flush(m_connections[i]);
+        }
+        if (!m_wakeupArmed)
+        {
+            armWakeup();
+        }
+
+        /*  进入io_uring_enter前声明休眠, 之后再检查一次队列, 避免错过生产者的唤醒 */
+        m_sleeping.store(true);
+        if ((submission = m_queue.pop()) != NULL)
+        {
+            m_sleeping.store(false);
+            assign(submission);
+            continue;
+        }
+
+        /*  一次系统调用提交所有连接的发送并等待完成事件    */
+        int ret = uring_enter(m_ring, 1);
+        m_sleeping.store(false);
+        if (ret < 0 && ret != -EINTR && ret != -EAGAIN && ret != -EBUSY)
+        {
+            /*  ring不可用: 之后的请求直接失败, 已分配与排队的请求全部失败, 不必等到stop    */
+            m_running = false;
+            for (size_t i = 0; i < m_connections.size(); ++i)
+            {
+                closeConnection(m_connections[i]);
+            }
+            while ((submission = m_queue.pop()) != NULL)
+            {
+                finish(submission, false);
+            }
+            break;
+        }
+
+        unsigned int head = *m_ring->cqHead;
+        unsigned int tail = __atomic_load_n(m_ring->cqTail, __ATOMIC_ACQUIRE);
+        while (head != tail)
+        {
+            struct io_uring_cqe* cqe = &m_ring->cqes[head & *m_ring->cqMask];
+            uint64_t userData = cqe->user_data;
+            int res = cqe->res;
+            unsigned int flags = cqe->flags;
+            __atomic_store_n(m_ring->cqHead, ++head, __ATOMIC_RELEASE);
+
+            int op = (int)((userData >> 24) & 0xff);
+            int index = (int)(userData & 0xffffff);
+            uint32_t generation = (uint32_t)(userData >> 32);
+            if (op == OP_WAKEUP)
+            {
+                m_wakeupArmed = false;
+                armWakeup();
+                continue;
+            }
+            if (op == OP_CONNECT_TIMEOUT)
+            {
+                continue;
+            }
+
+            SSDBUringConnection* connection = m_connections[index];
+            bool stale = connection->generation != generation || connection->fd == SOCKET_ERROR;
+            if (op == OP_CONNECT)
+            {
+                if (!stale)
+                {
+                    onConnect(connection, res);
+                }
+            }
+            else if (op == OP_RECV)
+            {
+                if (!stale)
+                {
+                    onRecv(connection, res, flags);
+                }
+                else if (flags & IORING_CQE_F_BUFFER)
+                {
+                    recycle(flags >> IORING_CQE_BUFFER_SHIFT);
+                }
+            }
+            else if (op == OP_SEND)
+            {
+                /*  零拷贝发送先产生结果事件(带F_MORE), 内核不再引用缓冲区后再产生通知事件   */
+                if (flags & IORING_CQE_F_NOTIF)
+                {
+                    --connection->zerocopyPending;
+                }
+                else
+                {
+                    if (flags & IORING_CQE_F_MORE)
+                    {
+                        ++connection->zerocopyPending;
+                    }
+                    if (!stale)
+                    {
+                        onSend(connection, res);
+                    }
+                }
+            }
+
+            if (head == tail)
+            {
+                tail = __atomic_load_n(m_ring->cqTail, __ATOMIC_ACQUIRE);
+            }
+        }
+    }
+}
+
+#else
+
+/*  不支持io_uring的平台   */
+
+struct SSDBUringRing
+{
+};
+
+SSDBUringTransport::SSDBUringTransport()
+{
+    m_ring = NULL;
+    m_cpu = -1;
+    m_running = false;
+    m_sleeping = false;
+    m_connected = 0;
+    m_pending = 0;
+    m_wakeupFd = -1;
+    m_wakeupValue = 0;
+    m_wakeupArmed = false;
+    m_lastReconnect = 0;
+    m_sendBuffers = NULL;
+    m_recvBuffers = NULL;
+    m_bufRing = NULL;
+    m_bufTail = 0;
+    m_zerocopy = false;
+    m_port = 0;
+    m_timeout = 5;
+}
+
+SSDBUringTransport::~SSDBUringTransport()
+{
+}
+
+bool SSDBUringTransport::available()
+{
+    return false;
+}
+
+bool SSDBUringTransport::start(const char* ip, int port, int connections, uint32_t timeoutSec, int cpu)
+{
+    return false;
+}
+
+void SSDBUringTransport::stop()
+{
+}
+
+void SSDBUringTransport::post(SSDBSubmission* submission)
+{
+    submission->complete(false);
+}
+
+int SSDBUringTransport::pending() const
+{
+    return 0;
+}
+
+bool SSDBUringTransport::request(const char* buffer, int len, int count, SSDBReplyBuffer& reply)
+{
+    return false;
+}
+
+bool SSDBUringTransport::isconnected() const
+{
+    return false;
+}
+
+#endif
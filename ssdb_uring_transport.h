@@ -0,0 +1,110 @@
+#ifndef __SSDB_URING_TRANSPORT_H__
+#define __SSDB_URING_TRANSPORT_H__
+
+#include <string>
+#include <vector>
+#include <thread>
+#include <atomic>
+
+#include "ssdb_client.h"
+#include "ssdb_transport.h"
+#include "ssdb_reactor.h"
+
+/*  基于Linux io_uring的transport(需要6.0以上内核, 其他平台start返回false)
+    与SSDBSharedTransport相同: 任意线程提交请求节点到无锁MPSC队列, 唯一的I/O线程负责收发, 按FIFO匹配response.
+    区别在于I/O不再逐个调用send/recv/poll:
+    -   所有连接的发送请求填入SQ后由一次io_uring_enter提交, 同时等待完成事件
+    -   请求拷贝到每个连接预先注册(IORING_REGISTER_BUFFERS)的发送缓冲区, 较大的批次以SEND_ZC直接从中零拷贝发送
+    -   每个连接只提交一次multishot recv, 数据由内核直接写入共享的provided buffer ring
+    -   完整的response直接在provided buffer中解析, 只有跨buffer的残余数据才拷贝到连接的接收缓冲区
+
+    SSDBUringTransport transport;
+    if (!transport.start("127.0.0.1", 8888, 4))
+    {
+        // 内核不支持时改用SSDBSharedTransport
+    }
+    SSDBClient client(&transport);      // 每个线程一个   */
+
+struct SSDBUringRing;
+struct SSDBUringConnection;
+
+class SSDBUringTransport : public SSDBTransport
+{
+public:
+    SSDBUringTransport();
+    ~SSDBUringTransport();
+
+    /*  当前内核是否支持io_uring, provided buffer ring与multishot recv  */
+    static bool             available();
+
+    /*  (阻塞)建立connections个连接并启动I/O线程, cpu>=0时把线程绑定到该cpu.
+        内核不支持或没有任何连接成功时返回false   */
+    bool                    start(const char* ip, int port, int connections = 1, uint32_t timeoutSec = 5, int cpu = -1);
+    /*  停止I/O线程并断开所有连接, 未完成的请求以失败完成, 不能与post并发调用  */
+    void                    stop();
+
+    /*  线程安全, submission在complete之前必须保持有效  */
+    void                    post(SSDBSubmission* submission);
+    /*  已提交但尚未完成的请求数  */
+    int                     pending() const;
+
+    virtual bool            request(const char* buffer, int len, int count, SSDBReplyBuffer& reply);
+    virtual bool            isconnected() const;
+
+private:
+    SSDBUringTransport(const SSDBUringTransport&);
+    void operator=(const SSDBUringTransport&);
+
+    bool                    setup(int connections);
+    void                    teardown();
+    void                    loop();
+    void                    wakeup();
+    void                    finish(SSDBSubmission* submission, bool success);
+    void                    assign(SSDBSubmission* submission);
+    /*  选择要分配请求的连接, 没有可用连接时返回NULL  */
+    SSDBUringConnection*    select();
+    /*  发起非阻塞重连, 连接过程由ring完成(onConnect)  */
+    bool                    reconnect(SSDBUringConnection* connection);
+    void                    onConnect(SSDBUringConnection* connection, int res);
+    bool                    attach(SSDBUringConnection* connection, int fd);
+    void                    closeConnection(SSDBUringConnection* connection);
+    void                    armWakeup();
+    void                    armRecv(SSDBUringConnection* connection);
+    void                    flush(SSDBUringConnection* connection);
+    void                    submitSend(SSDBUringConnection* connection);
+    void                    onSend(SSDBUringConnection* connection, int res);
+    void                    onRecv(SSDBUringConnection* connection, int res, unsigned int flags);
+    bool                    consume(SSDBUringConnection* connection, const char* data, int len);
+    /*  按FIFO把data中的完整response匹配给请求, 返回消耗的字节数, 协议错乱时返回-1  */
+    int                     dispatch(SSDBUringConnection* connection, const char* data, int len);
+    void                    recycle(unsigned int bid);
+
+private:
+    SSDBUringRing*                      m_ring;
+    MpscQueue<SSDBSubmission>           m_queue;
+    std::vector<SSDBUringConnection*>   m_connections;
+    std::thread                         m_thread;
+    int                                 m_cpu;
+
+    std::atomic<bool>                   m_running;
+    std::atomic<bool>                   m_sleeping;
+    std::atomic<int>                    m_connected;
+    std::atomic<int>                    m_pending;
+    int                                 m_wakeupFd;
+    uint64_t                            m_wakeupValue;
+    bool                                m_wakeupArmed;
+    int64_t                             m_lastReconnect;
+
+    /*  注册的发送缓冲区(每个连接一块)与provided buffer ring   */
+    char*                               m_sendBuffers;
+    char*                               m_recvBuffers;
+    void*                               m_bufRing;
+    unsigned short                      m_bufTail;
+    bool                                m_zerocopy;
+
+    std::string                         m_ip;
+    int                                 m_port;
+    uint32_t                            m_timeout;
+};
+
+#endif
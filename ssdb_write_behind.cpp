@@ -0,0 +1,159 @@
+#include "socketlibfunction.h"
+#include "ssdb_write_behind.h"
+
+SSDBWriteBehind::SSDBWriteBehind(SSDBClient* client, const SSDBWriteBehindOptions& options) : m_client(client), m_options(options)
+{
+    m_entries = 0;
+    m_bytes = 0;
+    m_oldest = 0;
+}
+
+SSDBWriteBehind::~SSDBWriteBehind()
+{
+    flush();
+}
+
+Status SSDBWriteBehind::set(const std::string& key, const std::string& val)
+{
+    Status status = reserve();
+    if (!status.ok())
+    {
+        return status;
+    }
+
+    std::pair<StringMap::iterator, bool> result = m_kvs.insert(std::make_pair(key, std::string()));
+    size_t removed = result.second ? 0 : result.first->second.size();
+    result.first->second = val;
+    return written(result.second, (result.second ? key.size() : 0) + val.size(), removed);
+}
+
+Status SSDBWriteBehind::hset(const std::string& name, const std::string& key, const std::string& val)
+{
+    Status status = reserve();
+    if (!status.ok())
+    {
+        return status;
+    }
+
+    std::pair<StringMap::iterator, bool> result = m_hashes[name].insert(std::make_pair(key, std::string()));
+    size_t removed = result.second ? 0 : result.first->second.size();
+    result.first->second = val;
+    return written(result.second, (result.second ? name.size() + key.size() : 0) + val.size(), removed);
+}
+
+Status SSDBWriteBehind::zset(const std::string& name, const std::string& key, int64_t score)
+{
+    Status status = reserve();
+    if (!status.ok())
+    {
+        return status;
+    }
+
+    std::pair<ScoreMap::iterator, bool> result = m_zsets[name].insert(std::make_pair(key, score));
+    result.first->second = score;
+    return written(result.second, result.second ? name.size() + key.size() + sizeof(score) : 0, 0);
+}
+
+Status SSDBWriteBehind::flush()
+{
+    Status status("ok");
+    if (!m_kvs.empty())
+    {
+        status = m_client->multi_set(m_kvs);
+        if (status.ok())
+        {
+            m_kvs.clear();
+        }
+    }
+
+    for (std::map<std::string, StringMap>::iterator iter = m_hashes.begin(); status.ok() && iter != m_hashes.end();)
+    {
+        status = m_client->multi_hset(iter->first, iter->second);
+        if (status.ok())
+        {
+            m_hashes.erase(iter++);
+        }
+    }
+
+    for (std::map<std::string, ScoreMap>::iterator iter = m_zsets.begin(); status.ok() && iter != m_zsets.end();)
+    {
+        status = m_client->multi_zset(iter->first, iter->second);
+        if (status.ok())
+        {
+            m_zsets.erase(iter++);
+        }
+    }
+
+    if (status.ok())
+    {
+        m_entries = 0;
+        m_bytes = 0;
+        m_oldest = 0;
+        return status;
+    }
+
+    /*  失败的批次及之后的写入仍在缓冲中, 重新统计  */
+    m_entries = m_kvs.size();
+    m_bytes = 0;
+    for (StringMap::const_iterator iter = m_kvs.begin(); iter != m_kvs.end(); ++iter)
+    {
+        m_bytes += iter->first.size() + iter->second.size();
+    }
+    for (std::map<std::string, StringMap>::const_iterator hash = m_hashes.begin(); hash != m_hashes.end(); ++hash)
+    {
+        m_entries += hash->second.size();
+        for (StringMap::const_iterator iter = hash->second.begin(); iter != hash->second.end(); ++iter)
+        {
+            m_bytes += hash->first.size() + iter->first.size() + iter->second.size();
+        }
+    }
+    for (std::map<std::string, ScoreMap>::const_iterator zset = m_zsets.begin(); zset != m_zsets.end(); ++zset)
+    {
+        m_entries += zset->second.size();
+        for (ScoreMap::const_iterator iter = zset->second.begin(); iter != zset->second.end(); ++iter)
+        {
+            m_bytes += zset->first.size() + iter->first.size() + sizeof(iter->second);
+        }
+    }
+
+    return status;
+}
+
+Status SSDBWriteBehind::poll()
+{
+    if (m_oldest != 0 && ox_now_ms() - m_oldest >= m_options.maxDelayMs)
+    {
+        return flush();
+    }
+    return Status("ok");
+}
+
+size_t SSDBWriteBehind::pendingEntries() const
+{
+    return m_entries;
+}
+
+size_t SSDBWriteBehind::pendingBytes() const
+{
+    return m_bytes;
+}
+
+Status SSDBWriteBehind::reserve()
+{
+    if (m_entries >= m_options.maxEntries || m_bytes >= m_options.maxBytes)
+    {
+        return flush();
+    }
+    return Status("ok");
+}
+
+Status SSDBWriteBehind::written(bool inserted, size_t added, size_t removed)
+{
+    m_entries += inserted ? 1 : 0;
+    m_bytes = m_bytes + added - removed;
+    if (m_oldest == 0)
+    {
+        m_oldest = ox_now_ms();
+    }
+    return poll();
+}
@@ -0,0 +1,77 @@
+#ifndef __SSDB_WRITE_BEHIND_H__
+#define __SSDB_WRITE_BEHIND_H__
+
+#include <string>
+#include <map>
+
+#include "ssdb_client.h"
+
+/*  写缓冲(write-behind): set/hset/zset先写入本地map, 同一个key的多次写入只保留最后一次,
+    缓冲的条目数或字节数达到上限, 或最早的未发送写入超过maxDelayMs时, 以multi_set/multi_hset/multi_zset批量发送.
+    -   与client一样不是线程安全的, 没有后台线程: 时间触发在每次写入与poll()时检查
+    -   缓冲中的写入对通过client的读取不可见, 需要读自己的写入时先flush()
+    -   析构时flush
+
+    SSDBWriteBehind writer(&client);
+    writer.set("k", "v1");
+    writer.set("k", "v2");      // 只发送v2
+    writer.flush();     */
+
+struct SSDBWriteBehindOptions
+{
+    SSDBWriteBehindOptions() : maxEntries(10000), maxBytes(4 * 1024 * 1024), maxDelayMs(50)
+    {
+    }
+
+    /*  缓冲的key个数与key+value字节数上限, 达到时先flush再写入   */
+    size_t                  maxEntries;
+    size_t                  maxBytes;
+    int64_t                 maxDelayMs;
+};
+
+class SSDBWriteBehind
+{
+public:
+    explicit SSDBWriteBehind(SSDBClient* client, const SSDBWriteBehindOptions& options = SSDBWriteBehindOptions());
+    ~SSDBWriteBehind();
+
+    /*  返回写入触发的flush的状态; 缓冲已满且flush失败时本次写入不会被缓冲  */
+    Status                  set(const std::string& key, const std::string& val);
+    Status                  hset(const std::string& name, const std::string& key, const std::string& val);
+    Status                  zset(const std::string& name, const std::string& key, int64_t score);
+
+    /*  发送所有缓冲的写入, 返回第一个失败的状态, 失败的批次及之后的写入保留在缓冲中  */
+    Status                  flush();
+    /*  最早的未发送写入超过maxDelayMs时flush, 写入空闲时由调用方周期性调用   */
+    Status                  poll();
+
+    size_t                  pendingEntries() const;
+    size_t                  pendingBytes() const;
+
+private:
+    SSDBWriteBehind(const SSDBWriteBehind&);
+    void operator=(const SSDBWriteBehind&);
+
+    /*  写入前检查容量, 已满时先flush   */
+    Status                  reserve();
+    /*  写入后更新统计并检查时间触发  */
+    Status                  written(bool inserted, size_t added, size_t removed);
+
+private:
+    typedef std::map<std::string, std::string>  StringMap;
+    typedef std::map<std::string, int64_t>      ScoreMap;
+
+    SSDBClient*                         m_client;
+    SSDBWriteBehindOptions              m_options;
+
+    StringMap                           m_kvs;
+    std::map<std::string, StringMap>    m_hashes;
+    std::map<std::string, ScoreMap>     m_zsets;
+
+    size_t                              m_entries;
+    size_t                              m_bytes;
+    /*  最早的未发送写入的时间(steady clock毫秒), 0表示缓冲为空    */
+    int64_t                             m_oldest;
+};
+
+#endif
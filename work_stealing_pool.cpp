@@ -0,0 +1,144 @@
+#include "work_stealing_pool.h"
+
+/*  当前线程所属的线程池以及worker序号   */
+static thread_local WorkStealingPool* t_pool = NULL;
+static thread_local int t_index = -1;
+
+WorkStealingPool::WorkStealingPool()
+{
+    m_running = false;
+    m_pending = 0;
+    m_sleepers = 0;
+    m_next = 0;
+}
+
+WorkStealingPool::~WorkStealingPool()
+{
+    stop();
+}
+
+void WorkStealingPool::start(int threads)
+{
+    if (m_running.exchange(true))
+    {
+        return;
+    }
+
+    for (int i = 0; i < threads; ++i)
+    {
+        m_workers.push_back(new Worker);
+    }
+    for (int i = 0; i < threads; ++i)
+    {
+        m_workers[i]->thread = std::thread(&WorkStealingPool::run, this, i);
+    }
+}
+
+void WorkStealingPool::stop()
+{
+    if (!m_running.exchange(false))
+    {
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(m_sleepMutex);
+        m_sleepCond.notify_all();
+    }
+    for (size_t i = 0; i < m_workers.size(); ++i)
+    {
+        m_workers[i]->thread.join();
+    }
+    for (size_t i = 0; i < m_workers.size(); ++i)
+    {
+        delete m_workers[i];
+    }
+    m_workers.clear();
+}
+
+void WorkStealingPool::post(Task task)
+{
+    if (m_workers.empty())
+    {
+        task();
+        return;
+    }
+
+    int index = (t_pool == this) ? t_index : (int)(m_next++ % m_workers.size());
+    {
+        Worker* worker = m_workers[index];
+        std::lock_guard<std::mutex> lock(worker->mutex);
+        worker->tasks.push_back(std::move(task));
+    }
+
+    ++m_pending;
+    if (m_sleepers.load() > 0)
+    {
+        std::lock_guard<std::mutex> lock(m_sleepMutex);
+        m_sleepCond.notify_one();
+    }
+}
+
+bool WorkStealingPool::take(int index, Task& task)
+{
+    /*  先从自己队列尾部取 */
+    {
+        Worker* worker = m_workers[index];
+        std::lock_guard<std::mutex> lock(worker->mutex);
+        if (!worker->tasks.empty())
+        {
+            task = std::move(worker->tasks.back());
+            worker->tasks.pop_back();
+            --m_pending;
+            return true;
+        }
+    }
+
+    /*  再从其他worker队列头部窃取   */
+    for (size_t i = 1; i < m_workers.size(); ++i)
+    {
+        Worker* victim = m_workers[(index + i) % m_workers.size()];
+        std::unique_lock<std::mutex> lock(victim->mutex, std::try_to_lock);
+        if (lock.owns_lock() && !victim->tasks.empty())
+        {
+            task = std::move(victim->tasks.front());
+            victim->tasks.pop_front();
+            --m_pending;
+            return true;
+        }
+    }
+
+    return false;
+}
+
+void WorkStealingPool::run(int index)
+{
+    t_pool = this;
+    t_index = index;
+
+    Task task;
+    while (true)
+    {
+        if (take(index, task))
+        {
+            task();
+            task = Task();
+            continue;
+        }
+
+        if (!m_running && m_pending.load() == 0)
+        {
+            break;
+        }
+
+        std::unique_lock<std::mutex> lock(m_sleepMutex);
+        ++m_sleepers;
+        m_sleepCond.wait(lock, [this]() {
+            return m_pending.load() > 0 || !m_running;
+        });
+        --m_sleepers;
+    }
+
+    t_pool = NULL;
+    t_index = -1;
+}
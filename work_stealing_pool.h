@@ -0,0 +1,56 @@
+#ifndef _WORK_STEALING_POOL_H_INCLUDED_
+#define _WORK_STEALING_POOL_H_INCLUDED_
+
+#include <deque>
+#include <vector>
+#include <mutex>
+#include <thread>
+#include <atomic>
+#include <functional>
+#include <condition_variable>
+
+/*  work-stealing线程池
+    每个worker有自己的任务队列: worker线程内post的任务放入自己队列尾部(LIFO执行, 缓存友好),
+    外部线程post的任务轮流分配给各worker; worker自己的队列为空时从其他worker队列头部窃取任务,
+    单个慢任务不会阻塞其他任务的执行.  */
+
+class WorkStealingPool
+{
+public:
+    typedef std::function<void()> Task;
+
+    WorkStealingPool();
+    ~WorkStealingPool();
+
+    void                    start(int threads);
+    /*  执行完所有已提交的任务后停止  */
+    void                    stop();
+
+    /*  线程安全    */
+    void                    post(Task task);
+
+private:
+    WorkStealingPool(const WorkStealingPool&);
+    void operator=(const WorkStealingPool&);
+
+    struct Worker
+    {
+        std::mutex          mutex;
+        std::deque<Task>    tasks;
+        std::thread         thread;
+    };
+
+    void                    run(int index);
+    bool                    take(int index, Task& task);
+
+private:
+    std::vector<Worker*>    m_workers;
+    std::atomic<bool>       m_running;
+    std::atomic<int>        m_pending;
+    std::atomic<int>        m_sleepers;
+    std::atomic<unsigned>   m_next;
+    std::mutex              m_sleepMutex;
+    std::condition_variable m_sleepCond;
+};
+
+#endif